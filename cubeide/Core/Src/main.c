@@ -26,6 +26,7 @@
 #include "../fs2011pro/events.h"
 #include "../fs2011pro/game.h"
 #include "../fs2011pro/keyboard.h"
+#include "../fs2011pro/logger.h"
 #include "../fs2011pro/measurements.h"
 #include "../fs2011pro/power.h"
 #include "../fs2011pro/settings.h"
@@ -93,7 +94,9 @@ void HAL_IncTick(void)
 
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
-  triggerPulse();
+  // Key interrupts only wake the MCU
+  if (GPIO_Pin == GM_DET_Pin)
+    triggerPulse();
 }
 
 void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
@@ -151,8 +154,12 @@ int main(void)
 
   if (crc != validCRC)
   {
-    drawSelfTestError(crc);
-    updateDisplay();
+    firstDisplayPage();
+    do
+    {
+      clearDisplay();
+      drawSelfTestError(crc);
+    } while (nextDisplayPage());
 
     powerDown(5000);
   }
@@ -161,6 +168,7 @@ int main(void)
 
   initEvents();
   initMeasurements();
+  initLogger();
   initMenus();
 
   /* USER CODE END 2 */
@@ -169,7 +177,7 @@ int main(void)
   /* USER CODE BEGIN WHILE */
   while (1)
   {
-    waitForInterrupt();
+    sleepEvents();
 
     updateGame();
     updateUI();
@@ -23,6 +23,7 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "../fs2011pro/buzzer.h"
+#include "../fs2011pro/display.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -151,6 +152,8 @@ void EXTI4_15_IRQHandler(void)
   /* USER CODE END EXTI4_15_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(GM_DET_Pin);
   /* USER CODE BEGIN EXTI4_15_IRQn 1 */
+  HAL_GPIO_EXTI_IRQHandler(KEY_UP_Pin);
+  HAL_GPIO_EXTI_IRQHandler(KEY_POWER_Pin);
 
   /* USER CODE END EXTI4_15_IRQn 1 */
 }
@@ -170,5 +173,31 @@ void TIM6_DAC_IRQHandler(void)
 }
 
 /* USER CODE BEGIN 1 */
+/**
+  * @brief This function handles EXTI line 0 and 1 interrupts (tickless key wake-up).
+  */
+void EXTI0_1_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(KEY_DOWN_Pin);
+  HAL_GPIO_EXTI_IRQHandler(KEY_SELECT_Pin);
+}
+
+/**
+  * @brief This function handles EXTI line 2 and 3 interrupts (tickless key wake-up).
+  */
+void EXTI2_3_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(KEY_BACK_Pin);
+}
+
+#ifdef LCD_DMA
+/**
+  * @brief This function handles DMA1 channel 2 and 3 interrupts (LCD DMA transfer complete).
+  */
+void DMA1_Channel2_3_IRQHandler(void)
+{
+  onDisplayDMA();
+}
+#endif
 
 /* USER CODE END 1 */
@@ -0,0 +1,291 @@
+/*
+ * FS2011 Pro
+ * Flash checkpoint ring
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "checkpoint.h"
+#include "settings.h"
+
+// The checkpoint pages are split into banks. A bank starts with a
+// header and a snapshot record, followed by a journal of incremental
+// records. When a bank is full, the next bank is erased and a new
+// snapshot is written there, so all pages wear evenly.
+//
+// Bank header: magic, sequence number
+// Record: type << 12 | argument, data size, data, checksum
+
+#define CHECKPOINT_PAGE_START 0x30
+#define CHECKPOINT_PAGE_END 0x38
+#define CHECKPOINT_BANK_PAGES 4
+#define CHECKPOINT_BANK_NUM ((CHECKPOINT_PAGE_END - CHECKPOINT_PAGE_START) / CHECKPOINT_BANK_PAGES)
+#define CHECKPOINT_BANK_SIZE (CHECKPOINT_BANK_PAGES * SETTINGS_PAGE_SIZE)
+
+#define CHECKPOINT_MAGIC 0x4b43
+#define CHECKPOINT_HEADER_SIZE 4
+#define CHECKPOINT_RECORD_HEADER_SIZE 4
+#define CHECKPOINT_EMPTY 0xffff
+
+// Halfwords are staged and programmed this many bytes at a time, each
+// program unlocks the flash and traces a start and end event
+#define CHECKPOINT_BUFFER_SIZE 128
+
+struct Checkpoint
+{
+    int bank;
+    unsigned short sequence;
+
+    unsigned int writeOffset;
+    bool isFull;
+    unsigned short checksum;
+    bool isBytePending;
+    unsigned char pendingByte;
+
+    unsigned char buffer[CHECKPOINT_BUFFER_SIZE];
+    unsigned int bufferSize;
+
+    unsigned int readOffset;
+    unsigned int dataOffset;
+} checkpoint;
+
+unsigned char *getCheckpointAddress(int bank, unsigned int offset)
+{
+    return getSettingsAddress(CHECKPOINT_PAGE_START, 0) +
+           CHECKPOINT_BANK_SIZE * bank +
+           offset;
+}
+
+unsigned short readCheckpointHalfword(int bank, unsigned int offset)
+{
+    return *((unsigned short *)getCheckpointAddress(bank, offset));
+}
+
+unsigned int getCheckpointRecordSize(unsigned int size)
+{
+    return CHECKPOINT_RECORD_HEADER_SIZE + ((size + 1) & ~1) + 2;
+}
+
+// Returns the record size, or 0 if there is no valid record at offset
+unsigned int validateCheckpointRecord(int bank, unsigned int offset)
+{
+    if ((offset + CHECKPOINT_RECORD_HEADER_SIZE) > CHECKPOINT_BANK_SIZE)
+        return 0;
+
+    if (readCheckpointHalfword(bank, offset) == CHECKPOINT_EMPTY)
+        return 0;
+
+    unsigned int recordSize =
+        getCheckpointRecordSize(readCheckpointHalfword(bank, offset + 2));
+    if ((offset + recordSize) > CHECKPOINT_BANK_SIZE)
+        return 0;
+
+    unsigned short checksum = 0;
+    for (unsigned int i = 0; i < (recordSize - 2); i += 2)
+        checksum += readCheckpointHalfword(bank, offset + i);
+
+    if (readCheckpointHalfword(bank, offset + recordSize - 2) != (unsigned short)~checksum)
+        return 0;
+
+    return recordSize;
+}
+
+void initCheckpoint()
+{
+    checkpoint.bank = -1;
+    checkpoint.sequence = 0;
+
+    for (int bank = 0; bank < CHECKPOINT_BANK_NUM; bank++)
+    {
+        if (readCheckpointHalfword(bank, 0) != CHECKPOINT_MAGIC)
+            continue;
+
+        unsigned short sequence = readCheckpointHalfword(bank, 2);
+        if (!validateCheckpointRecord(bank, CHECKPOINT_HEADER_SIZE))
+            continue;
+
+        if ((checkpoint.bank < 0) ||
+            ((short)(sequence - checkpoint.sequence) > 0))
+        {
+            checkpoint.bank = bank;
+            checkpoint.sequence = sequence;
+        }
+    }
+
+    // Find the end of the journal
+    checkpoint.writeOffset = CHECKPOINT_HEADER_SIZE;
+    checkpoint.isFull = true;
+    checkpoint.bufferSize = 0;
+
+    if (checkpoint.bank >= 0)
+    {
+        unsigned int recordSize;
+        while ((recordSize = validateCheckpointRecord(checkpoint.bank, checkpoint.writeOffset)))
+            checkpoint.writeOffset += recordSize;
+
+        // A torn record ends the journal
+        checkpoint.isFull =
+            (checkpoint.writeOffset >= CHECKPOINT_BANK_SIZE) ||
+            (readCheckpointHalfword(checkpoint.bank, checkpoint.writeOffset) != CHECKPOINT_EMPTY);
+    }
+
+    rewindCheckpoint();
+}
+
+// Returns whether the checkpoint pages hold banks, valid or torn: a bank
+// is started with CHECKPOINT_MAGIC right after its erase
+bool isCheckpointFlash()
+{
+    for (int bank = 0; bank < CHECKPOINT_BANK_NUM; bank++)
+    {
+        if (readCheckpointHalfword(bank, 0) == CHECKPOINT_MAGIC)
+            return true;
+    }
+
+    return false;
+}
+
+// Writing
+
+bool eraseCheckpointBank(int bank)
+{
+    bool success = true;
+
+    for (int i = 0; i < CHECKPOINT_BANK_PAGES; i++)
+        success &= eraseSettingsPage(CHECKPOINT_PAGE_START + CHECKPOINT_BANK_PAGES * bank + i);
+
+    return success;
+}
+
+// Programs the staged halfwords. A failed erase or program leaves the bank
+// full, so nothing more is written to it and the next checkpoint starts a
+// new snapshot
+bool flushCheckpoint()
+{
+    bool success = !checkpoint.isFull &&
+                   writeSettingsData(getCheckpointAddress(checkpoint.bank,
+                                                          checkpoint.writeOffset - checkpoint.bufferSize),
+                                     checkpoint.buffer, checkpoint.bufferSize);
+
+    checkpoint.bufferSize = 0;
+    if (!success)
+        checkpoint.isFull = true;
+
+    return success;
+}
+
+void programCheckpointHalfword(unsigned short value)
+{
+    checkpoint.buffer[checkpoint.bufferSize++] = value & 0xff;
+    checkpoint.buffer[checkpoint.bufferSize++] = value >> 8;
+
+    checkpoint.checksum += value;
+    checkpoint.writeOffset += 2;
+
+    if (checkpoint.bufferSize == CHECKPOINT_BUFFER_SIZE)
+        flushCheckpoint();
+}
+
+// Erases the next bank and starts its snapshot record
+bool startCheckpointSnapshot(unsigned int type, unsigned int argument, unsigned int size)
+{
+    if ((CHECKPOINT_HEADER_SIZE + getCheckpointRecordSize(size)) > CHECKPOINT_BANK_SIZE)
+        return false;
+
+    checkpoint.bank = (checkpoint.bank + 1) % CHECKPOINT_BANK_NUM;
+    checkpoint.sequence++;
+
+    checkpoint.writeOffset = 0;
+    checkpoint.isFull = !eraseCheckpointBank(checkpoint.bank);
+    checkpoint.bufferSize = 0;
+    programCheckpointHalfword(CHECKPOINT_MAGIC);
+    programCheckpointHalfword(checkpoint.sequence);
+
+    return startCheckpointRecord(type, argument, size);
+}
+
+// Starts a journal record, returns false if the bank is full
+bool startCheckpointRecord(unsigned int type, unsigned int argument, unsigned int size)
+{
+    if ((checkpoint.bank < 0) || checkpoint.isFull)
+        return false;
+
+    if ((checkpoint.writeOffset + getCheckpointRecordSize(size)) > CHECKPOINT_BANK_SIZE)
+    {
+        checkpoint.isFull = true;
+
+        return false;
+    }
+
+    checkpoint.checksum = 0;
+    checkpoint.isBytePending = false;
+    programCheckpointHalfword((type << 12) | argument);
+    programCheckpointHalfword(size);
+
+    return true;
+}
+
+void writeCheckpointData(const void *data, unsigned int size)
+{
+    const unsigned char *source = data;
+
+    for (unsigned int i = 0; i < size; i++)
+    {
+        if (checkpoint.isBytePending)
+            programCheckpointHalfword(checkpoint.pendingByte | (source[i] << 8));
+        else
+            checkpoint.pendingByte = source[i];
+
+        checkpoint.isBytePending = !checkpoint.isBytePending;
+    }
+}
+
+// Returns false if the record could not be programmed
+bool endCheckpointRecord()
+{
+    if (checkpoint.isBytePending)
+        programCheckpointHalfword(checkpoint.pendingByte | 0xff00);
+
+    programCheckpointHalfword(~checkpoint.checksum);
+
+    return flushCheckpoint();
+}
+
+// Reading
+
+void rewindCheckpoint()
+{
+    checkpoint.readOffset = CHECKPOINT_HEADER_SIZE;
+}
+
+bool readCheckpointRecord(unsigned int *type, unsigned int *argument, unsigned int *size)
+{
+    if (checkpoint.bank < 0)
+        return false;
+
+    unsigned int recordSize = validateCheckpointRecord(checkpoint.bank, checkpoint.readOffset);
+    if (!recordSize)
+        return false;
+
+    unsigned short header = readCheckpointHalfword(checkpoint.bank, checkpoint.readOffset);
+    *type = header >> 12;
+    *argument = header & (CHECKPOINT_ARGUMENT_NUM - 1);
+    *size = readCheckpointHalfword(checkpoint.bank, checkpoint.readOffset + 2);
+
+    checkpoint.dataOffset = checkpoint.readOffset + CHECKPOINT_RECORD_HEADER_SIZE;
+    checkpoint.readOffset += recordSize;
+
+    return true;
+}
+
+void readCheckpointData(void *data, unsigned int size)
+{
+    memcpy(data, getCheckpointAddress(checkpoint.bank, checkpoint.dataOffset), size);
+
+    checkpoint.dataOffset += size;
+}
@@ -0,0 +1,30 @@
+/*
+ * FS2011 Pro
+ * Flash checkpoint ring
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+
+#define CHECKPOINT_TYPE_NUM 15
+#define CHECKPOINT_ARGUMENT_NUM 0x1000
+
+void initCheckpoint();
+bool isCheckpointFlash();
+
+bool startCheckpointSnapshot(unsigned int type, unsigned int argument, unsigned int size);
+bool startCheckpointRecord(unsigned int type, unsigned int argument, unsigned int size);
+void writeCheckpointData(const void *data, unsigned int size);
+bool endCheckpointRecord();
+
+void rewindCheckpoint();
+bool readCheckpointRecord(unsigned int *type, unsigned int *argument, unsigned int *size);
+void readCheckpointData(void *data, unsigned int size);
+
+#endif
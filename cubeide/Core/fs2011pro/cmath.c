@@ -8,7 +8,7 @@
  */
 
 #include <limits.h>
-#include <stdio.h>
+#include <math.h>
 
 #include "cmath.h"
 
@@ -23,46 +23,86 @@ void addClamped(unsigned int *x, unsigned int y)
         *x = result;
 }
 
+// Powers of ten, correctly rounded, over the range of positive floats
+#define POWER_OF_TEN_MIN -45
+#define POWER_OF_TEN_MAX 38
+
+const float powersOfTen[] = {
+    1E-45F, 1E-44F, 1E-43F, 1E-42F, 1E-41F, 1E-40F,
+    1E-39F, 1E-38F, 1E-37F, 1E-36F, 1E-35F, 1E-34F,
+    1E-33F, 1E-32F, 1E-31F, 1E-30F, 1E-29F, 1E-28F,
+    1E-27F, 1E-26F, 1E-25F, 1E-24F, 1E-23F, 1E-22F,
+    1E-21F, 1E-20F, 1E-19F, 1E-18F, 1E-17F, 1E-16F,
+    1E-15F, 1E-14F, 1E-13F, 1E-12F, 1E-11F, 1E-10F,
+    1E-9F, 1E-8F, 1E-7F, 1E-6F, 1E-5F, 1E-4F,
+    1E-3F, 1E-2F, 1E-1F, 1E0F, 1E1F, 1E2F,
+    1E3F, 1E4F, 1E5F, 1E6F, 1E7F, 1E8F,
+    1E9F, 1E10F, 1E11F, 1E12F, 1E13F, 1E14F,
+    1E15F, 1E16F, 1E17F, 1E18F, 1E19F, 1E20F,
+    1E21F, 1E22F, 1E23F, 1E24F, 1E25F, 1E26F,
+    1E27F, 1E28F, 1E29F, 1E30F, 1E31F, 1E32F,
+    1E33F, 1E34F, 1E35F, 1E36F, 1E37F, 1E38F};
+
+// Bit i is set if powersOfTen[i] is rounded down, so it is below the
+// decade boundary
+const unsigned int powersOfTenRoundedDown[] = {0x974841b6, 0xd7000bb7, 0x000ed359};
+
+unsigned int getFloatBits(float value)
+{
+    union
+    {
+        float value;
+        unsigned int bits;
+    } floatBits;
+
+    floatBits.value = value;
+
+    return floatBits.bits;
+}
+
+// Positive floats compare as their bits
+bool isAtLeastPowerOfTen(unsigned int bits, int power)
+{
+    unsigned int index = power - POWER_OF_TEN_MIN;
+    unsigned int isRoundedDown = (powersOfTenRoundedDown[index / 32] >> (index % 32)) & 1;
+
+    return bits >= (getFloatBits(powersOfTen[index]) + isRoundedDown);
+}
+
+// Returns floor(log10(value)), exact for all positive floats
 int getExponent(float value)
 {
     if (value <= 0)
         return -38;
 
-    // return (int)floorf(log10f(value));
+    unsigned int bits = getFloatBits(value);
 
-    int power = 0;
+    // Estimate from the binary exponent, log10(2) ~ 1233 / 4096
+    int binaryExponent = (int)(bits >> 23) - 127;
+    int power = (binaryExponent * 1233) >> 12;
 
-    while (value >= 10)
-    {
+    if (power < POWER_OF_TEN_MIN)
+        power = POWER_OF_TEN_MIN;
+    else if (power > POWER_OF_TEN_MAX)
+        power = POWER_OF_TEN_MAX;
+
+    // The estimate is off by one at most, except for subnormals
+    while ((power < POWER_OF_TEN_MAX) && isAtLeastPowerOfTen(bits, power + 1))
         power++;
-        value /= 9.999999F;
-    }
-    while (value < 1)
-    {
+    while ((power > POWER_OF_TEN_MIN) && !isAtLeastPowerOfTen(bits, power))
         power--;
-        value *= 10.000001F;
-    }
 
     return power;
 }
 
 float getPowerOfTen(int value)
 {
-    // return powf(10.F, (float)value);
+    if (value < POWER_OF_TEN_MIN)
+        return 0;
+    else if (value > POWER_OF_TEN_MAX)
+        return HUGE_VALF;
 
-    float power = 1;
-    if (value > 0)
-    {
-        for (int i = 0; i < value; i++)
-            power *= 10.000001F;
-    }
-    else if (value < 0)
-    {
-        for (int i = 0; i > value; i--)
-            power /= 9.999999F;
-    }
-
-    return power;
+    return powersOfTen[value - POWER_OF_TEN_MIN];
 }
 
 int divideDown(int x, int y)
@@ -79,3 +119,183 @@ int remainderDown(int x, int y)
 
     return (remainder < 0) ? (remainder + y) : remainder;
 }
+
+// Fixed point
+
+// log2(1 + i / 16) (Q16.16)
+const unsigned int fixedLog2Table[] = {
+    0, 5732, 11136, 16248, 21098, 25711, 30109, 34312, 38336,
+    42196, 45904, 49472, 52911, 56229, 59434, 62534, 65536};
+
+// Returns log2(value) (Q16.16), value > 0
+int getFixedLog2(unsigned long long value)
+{
+    int exponent = 63;
+    while (!(value >> 63))
+    {
+        exponent--;
+        value <<= 1;
+    }
+
+    unsigned int index = (value >> 59) & 0xf;
+    unsigned int fraction = (value >> 43) & 0xffff;
+
+    int lower = fixedLog2Table[index];
+    int upper = fixedLog2Table[index + 1];
+
+    return (exponent << FIXED_SHIFT) +
+           lower + (int)(((upper - lower) * fraction) >> 16);
+}
+
+// Returns floor(sqrt(value)), bit by bit as there is no divider
+unsigned int getFixedSqrt(unsigned int value)
+{
+    unsigned int root = 0;
+    unsigned int bit = 1U << 30;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit)
+    {
+        if (value >= (root + bit))
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+// 10^i and the largest value that can be multiplied by it
+const struct
+{
+    unsigned long long power;
+    unsigned long long limit;
+} fixedPowersOfTen[] = {
+#define FIXED_POWER_OF_TEN(x) {x, ULLONG_MAX / x}
+    FIXED_POWER_OF_TEN(1ULL),
+    FIXED_POWER_OF_TEN(10ULL),
+    FIXED_POWER_OF_TEN(100ULL),
+    FIXED_POWER_OF_TEN(1000ULL),
+    FIXED_POWER_OF_TEN(10000ULL),
+    FIXED_POWER_OF_TEN(100000ULL),
+    FIXED_POWER_OF_TEN(1000000ULL),
+    FIXED_POWER_OF_TEN(10000000ULL),
+    FIXED_POWER_OF_TEN(100000000ULL),
+    FIXED_POWER_OF_TEN(1000000000ULL),
+    FIXED_POWER_OF_TEN(10000000000ULL),
+    FIXED_POWER_OF_TEN(100000000000ULL),
+    FIXED_POWER_OF_TEN(1000000000000ULL),
+    FIXED_POWER_OF_TEN(10000000000000ULL),
+    FIXED_POWER_OF_TEN(100000000000000ULL),
+    FIXED_POWER_OF_TEN(1000000000000000ULL),
+    FIXED_POWER_OF_TEN(10000000000000000ULL),
+    FIXED_POWER_OF_TEN(100000000000000000ULL),
+    FIXED_POWER_OF_TEN(1000000000000000000ULL),
+    FIXED_POWER_OF_TEN(10000000000000000000ULL),
+#undef FIXED_POWER_OF_TEN
+};
+
+#define FIXED_POWER_OF_TEN_MAX 19
+
+// Returns floor(log10(product / 2^shift)), product > 0, shift < 64
+int getFixedExponent(unsigned long long product, int shift)
+{
+    unsigned long long integer = product >> shift;
+    int lower;
+    int upper;
+
+    if (integer)
+    {
+        // Largest i with integer >= 10^i
+        lower = 0;
+        upper = FIXED_POWER_OF_TEN_MAX;
+        while (lower < upper)
+        {
+            int i = (lower + upper + 1) / 2;
+            if (integer >= fixedPowersOfTen[i].power)
+                lower = i;
+            else
+                upper = i - 1;
+        }
+
+        return lower;
+    }
+    else
+    {
+        // Smallest i with product * 10^i >= 2^shift
+        lower = 1;
+        upper = FIXED_POWER_OF_TEN_MAX;
+        while (lower < upper)
+        {
+            int i = (lower + upper) / 2;
+            if ((product > fixedPowersOfTen[i].limit) ||
+                ((product * fixedPowersOfTen[i].power) >> shift))
+                upper = i;
+            else
+                lower = i + 1;
+        }
+
+        return -lower;
+    }
+}
+
+// Returns product / 2^shift * 10^power, truncated or rounded.
+// The caller chooses power so that the result does not overflow
+unsigned long long getFixedDecimal(unsigned long long product, int shift,
+                                   int power, bool isRounded)
+{
+    if (power > FIXED_POWER_OF_TEN_MAX)
+        product = 0;
+    else if (power > 0)
+        product *= fixedPowersOfTen[power].power;
+    else if (power < -FIXED_POWER_OF_TEN_MAX)
+        product = 0;
+    else if (power < 0)
+        product /= fixedPowersOfTen[-power].power;
+
+    if (isRounded && shift)
+        product += 1ULL << (shift - 1);
+
+    return product >> shift;
+}
+
+// Returns value * 10^power, truncated or rounded, exactly for power <= 9
+// (the smallest unit prefix is micro). The value and the result must fit in
+// 63 bits
+unsigned long long getFloatDecimal(float value, int power, bool isRounded)
+{
+    unsigned int bits = getFloatBits(value);
+    if ((int)bits <= 0)
+        return 0;
+
+    // value = product / 2^shift
+    int biasedExponent = bits >> 23;
+    unsigned long long product = bits & 0x7fffff;
+    if (biasedExponent)
+        product |= 0x800000;
+    else
+        biasedExponent = 1;
+
+    int shift = 150 - biasedExponent;
+
+    // Rounding in getFixedDecimal() needs a shift
+    if (shift < 1)
+    {
+        product <<= 1 - shift;
+        shift = 1;
+    }
+    else if (shift > 63)
+    {
+        product >>= shift - 63;
+        shift = 63;
+    }
+
+    return getFixedDecimal(product, shift, power, isRounded);
+}
@@ -10,10 +10,33 @@
 #ifndef CMATH_H
 #define CMATH_H
 
+#include <stdbool.h>
+
+// Fixed-point measurement, formatting and alarm code instead of soft-float:
+// #define FIXED_POINT
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED(x) ((unsigned int)((x) * (double)FIXED_ONE + 0.5))
+
+// Rates (cps): Q16.16 with FIXED_POINT, float otherwise
+#ifdef FIXED_POINT
+typedef unsigned int Rate;
+#else
+typedef float Rate;
+#endif
+
 void addClamped(unsigned int *x, unsigned int y);
 int getExponent(float value);
 float getPowerOfTen(int value);
+unsigned long long getFloatDecimal(float value, int power, bool isRounded);
 int divideDown(int x, int y);
 int remainderDown(int x, int y);
 
+int getFixedLog2(unsigned long long value);
+unsigned int getFixedSqrt(unsigned int value);
+int getFixedExponent(unsigned long long product, int shift);
+unsigned long long getFixedDecimal(unsigned long long product, int shift,
+                                   int power, bool isRounded);
+
 #endif
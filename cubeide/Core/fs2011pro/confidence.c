@@ -7,148 +7,82 @@
  * License: MIT
  */
 
+#include "cmath.h"
 #include "confidence.h"
+#include "settings.h"
 
-typedef const struct
+// The rate is measured from the time of n pulses, which has a gamma
+// distribution, so the true rate is within the measured one times
+// [2n / chi2(1 - alpha / 2, 2n), 2n / chi2(alpha / 2, 2n)]. Small counts
+// use exact tables (tools/mkconfidence.py). Larger counts use the
+// Wilson-Hilferty approximation, chi2(p, k) = k * c^3 with
+// c = 1 - 2 / 9k + z(p) * sqrt(2 / 9k), computed in Q30.
+
+#define CONFIDENCE_SHIFT 30
+#define CONFIDENCE_ONE (1LL << CONFIDENCE_SHIFT)
+
+#include "resources/confidence_table.h"
+
+// Returns x (Q30) in tenths of a percent, rounded to whole percents
+// from 10% up
+int getConfidenceTenths(long long x)
+{
+    int tenths = (int)((x * 1000 + (CONFIDENCE_ONE >> 1)) >> CONFIDENCE_SHIFT);
+    if (tenths < 100)
+        return tenths;
+
+    return 10 * (int)((x * 100 + (CONFIDENCE_ONE >> 1)) >> CONFIDENCE_SHIFT);
+}
+
+long long multiplyConfidence(long long x, long long y)
+{
+    return (x * y) >> CONFIDENCE_SHIFT;
+}
+
+long long getConfidenceCube(long long x)
 {
-    unsigned short sampleNum;
-    unsigned char lowerInterval;
-    unsigned short upperInterval;
-} ConfidenceInterval;
-
-ConfidenceInterval confidenceIntervals[] = {
-    {1, 73, 3850},
-    {2, 65, 726},
-    {3, 59, 385},
-    {4, 55, 268},
-    {5, 52, 208},
-    {6, 49, 173},
-    {7, 47, 149},
-    {8, 45, 132},
-    {9, 43, 119},
-    {10, 42, 109},
-    {11, 41, 101},
-    {12, 40, 94},
-    {13, 38, 88},
-    {14, 38, 83},
-    {15, 37, 79},
-    {16, 36, 75},
-    {17, 35, 72},
-    {18, 34, 69},
-    {19, 34, 67},
-    {20, 33, 64},
-    {21, 33, 62},
-    {22, 32, 60},
-    {23, 31, 58},
-    {24, 31, 57},
-    {25, 30, 55},
-    {26, 30, 54},
-    {27, 30, 52},
-    {28, 29, 51},
-    {29, 29, 50},
-    {30, 28, 49},
-    {31, 28, 48},
-    {32, 28, 47},
-    {33, 27, 46},
-    {34, 27, 45},
-    {35, 27, 44},
-    {36, 27, 43},
-    {37, 26, 43},
-    {38, 26, 42},
-    {39, 26, 41},
-    {40, 25, 40},
-    {42, 25, 39},
-    {44, 25, 38},
-    {45, 24, 38},
-    {46, 24, 37},
-    {48, 24, 36},
-    {50, 23, 35},
-    {52, 23, 34},
-    {55, 22, 33},
-    {58, 22, 32},
-    {61, 22, 31},
-    {62, 21, 31},
-    {64, 21, 30},
-    {68, 21, 29},
-    {69, 20, 29},
-    {72, 20, 28},
-    {76, 20, 27},
-    {78, 19, 27},
-    {81, 19, 26},
-    {87, 19, 25},
-    {88, 18, 25},
-    {93, 18, 24},
-    {100, 18, 23},
-    {101, 17, 23},
-    {108, 17, 22},
-    {116, 16, 22},
-    {117, 16, 21},
-    {127, 16, 20},
-    {134, 15, 20},
-    {139, 15, 19},
-    {153, 15, 18},
-    {157, 14, 18},
-    {169, 14, 17},
-    {185, 13, 17},
-    {188, 13, 16},
-    {211, 13, 15},
-    {221, 12, 15},
-    {239, 12, 14},
-    {267, 11, 14},
-    {274, 11, 13},
-    {317, 11, 12},
-    {328, 10, 12},
-    {372, 10, 11},
-    {412, 9, 11},
-    {444, 9, 10},
-    {530, 8, 10},
-    {541, 8, 9},
-    {675, 8, 8},
-    {703, 7, 8},
-    {869, 7, 7},
-    {973, 6, 7},
-    {1166, 6, 6},
-    {1423, 5, 6},
-    {1654, 5, 5},
-    {2258, 4, 5},
-    {2548, 4, 4},
-    {4077, 3, 4},
-    {4463, 3, 3},
-    {9316, 2, 3},
-    {9895, 2, 2},
-    {37838, 1, 2},
-    {38995, 1, 1},
-};
-
-#define CONFIDENCE_INTERVALS_SIZE (sizeof(confidenceIntervals) / sizeof(ConfidenceInterval))
+    return multiplyConfidence(multiplyConfidence(x, x), x);
+}
 
 void getConfidenceIntervals(unsigned int sampleNum,
                             int *lowerConfidenceInterval,
                             int *upperConfidenceInterval)
 {
-    int left = 0;
-    int right = CONFIDENCE_INTERVALS_SIZE - 1;
-    int index = -1;
+    unsigned int level = getConfidenceLevel();
 
-    while (left <= right)
+    if (sampleNum <= CONFIDENCE_TABLE_SIZE)
     {
-        int mid = (left + right) / 2;
-        unsigned int confidenceSampleNum = confidenceIntervals[mid].sampleNum;
-
-        if (confidenceSampleNum < sampleNum)
-            left = mid + 1;
-        else if (confidenceSampleNum > sampleNum)
-            right = mid - 1;
-        else
-        {
-            index = mid;
-            break;
-        }
+        const unsigned short *entry = confidenceTable[level][sampleNum ? sampleNum - 1 : 0];
+
+        *lowerConfidenceInterval = 10 * entry[0];
+        *upperConfidenceInterval = 10 * entry[1];
+
+        return;
     }
 
-    if (index == -1)
-        index = right;
+    // With k = 2n: sqrt(2 / 9k) = 1 / (3 sqrt(n)) and 2 / 9k is its square.
+    // sqrt(n) is taken with 16 significant bits
+    unsigned int value = sampleNum;
+    int shift = 0;
+    while (value < (1U << 30))
+    {
+        value <<= 2;
+        shift++;
+    }
+
+    long long root = (1LL << (CONFIDENCE_SHIFT + shift)) / (3 * getFixedSqrt(value));
+    long long square = multiplyConfidence(root, root);
+    long long deviation = multiplyConfidence(confidenceZ[level], root);
+
+    long long upperC = CONFIDENCE_ONE - square + deviation;
+    long long lowerC = CONFIDENCE_ONE - square - deviation;
+
+    // One division gives both inverses: 1 / upperC = lowerC / (upperC * lowerC)
+    long long inverseProduct = (1LL << (2 * CONFIDENCE_SHIFT)) /
+                               multiplyConfidence(upperC, lowerC);
+    long long inverseUpperC = multiplyConfidence(lowerC, inverseProduct);
+    long long inverseLowerC = multiplyConfidence(upperC, inverseProduct);
 
-    *lowerConfidenceInterval = confidenceIntervals[index].lowerInterval;
-    *upperConfidenceInterval = confidenceIntervals[index].upperInterval;
+    *lowerConfidenceInterval = getConfidenceTenths(CONFIDENCE_ONE - getConfidenceCube(inverseUpperC));
+    *upperConfidenceInterval = getConfidenceTenths(getConfidenceCube(inverseLowerC) - CONFIDENCE_ONE);
 }
@@ -10,6 +10,9 @@
 #ifndef CONFIDENCE_H
 #define CONFIDENCE_H
 
+// Returns the intervals of the true rate relative to the measured one at
+// the confidence level of the settings, in tenths of a percent. Values
+// from 10% up are whole percents
 void getConfidenceIntervals(unsigned int sampleNum,
                             int *lowerConfidenceInterval,
                             int *upperConfidenceInterval);
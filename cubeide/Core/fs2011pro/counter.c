@@ -0,0 +1,132 @@
+/*
+ * FS2011 Pro
+ * Hardware pulse counter
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+// GM_DET (PA6) has no timer ETR function on the STM32F051, so pulses are
+// captured with TIM16 input capture, running at COUNTER_FREQUENCY: every
+// capture raises a DMA request that copies the timestamp into a ring buffer,
+// without any interrupt. The DMA transfer counter (CNDTR) is the write index.
+//
+// COUNTER_CAPTURE_NUM or more captures between two reads wrap the ring, and
+// the write index alone cannot tell. The capture read last is then
+// overwritten, so it is kept and compared: a changed value means a full ring
+// of pulses was lost (unless the new capture has the same 16-bit timestamp).
+
+#ifndef SDL_MODE
+#include "main.h"
+#endif
+
+#include "counter.h"
+
+struct Counter
+{
+    volatile unsigned short captures[COUNTER_CAPTURE_NUM];
+    unsigned int captureIndex;
+    unsigned short lastCapture;
+    unsigned int lostPulseCount;
+
+#ifdef SDL_MODE
+    volatile unsigned int simCaptureIndex;
+#endif
+
+    unsigned short pulseDelays[COUNTER_CAPTURE_NUM];
+} counter;
+
+void initCounter()
+{
+#ifndef SDL_MODE
+    HAL_NVIC_DisableIRQ(GM_DET_EXTI_IRQn);
+
+    __HAL_RCC_TIM16_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    GPIO_InitStruct.Pin = GM_DET_Pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Pull = GPIO_PULLUP;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+    GPIO_InitStruct.Alternate = GPIO_AF5_TIM16;
+    HAL_GPIO_Init(GM_DET_GPIO_Port, &GPIO_InitStruct);
+
+    // DMA1 channel 3: TIM16_CH1 (default mapping)
+    DMA1_Channel3->CCR = 0;
+    DMA1_Channel3->CPAR = (uint32_t)&TIM16->CCR1;
+    DMA1_Channel3->CMAR = (uint32_t)counter.captures;
+    DMA1_Channel3->CNDTR = COUNTER_CAPTURE_NUM;
+    DMA1_Channel3->CCR = DMA_CCR_PSIZE_0 |
+                         DMA_CCR_MSIZE_0 |
+                         DMA_CCR_MINC |
+                         DMA_CCR_CIRC |
+                         DMA_CCR_EN;
+
+    // TIM16: free running, input capture on TI1 falling edge
+    TIM16->PSC = SystemCoreClock / COUNTER_FREQUENCY - 1;
+    TIM16->ARR = 0xffff;
+    TIM16->CCMR1 = TIM_CCMR1_CC1S_0 |
+                   TIM_CCMR1_IC1F_1;
+    TIM16->CCER = TIM_CCER_CC1P |
+                  TIM_CCER_CC1E;
+    TIM16->DIER = TIM_DIER_CC1DE;
+    TIM16->EGR = TIM_EGR_UG;
+    TIM16->CR1 = TIM_CR1_CEN;
+#endif
+}
+
+// Returns the number of pulses since the last call, and prepares their delays
+// (in counter ticks before this call), oldest pulse first
+unsigned int getCounterPulses()
+{
+#ifndef SDL_MODE
+    unsigned int captureIndex = COUNTER_CAPTURE_NUM - DMA1_Channel3->CNDTR;
+    unsigned short now = TIM16->CNT;
+#else
+    unsigned int captureIndex = counter.simCaptureIndex;
+    unsigned short now = 0;
+#endif
+
+    unsigned int pulseCount = (COUNTER_CAPTURE_NUM + captureIndex - counter.captureIndex) %
+                              COUNTER_CAPTURE_NUM;
+
+    unsigned int lastIndex = (counter.captureIndex + COUNTER_CAPTURE_NUM - 1) %
+                             COUNTER_CAPTURE_NUM;
+    counter.lostPulseCount = (counter.captures[lastIndex] != counter.lastCapture)
+                                 ? COUNTER_CAPTURE_NUM
+                                 : 0;
+
+    for (unsigned int i = 0; i < pulseCount; i++)
+    {
+        counter.lastCapture = counter.captures[counter.captureIndex];
+        counter.pulseDelays[i] = now - counter.lastCapture;
+        counter.captureIndex = (counter.captureIndex + 1) % COUNTER_CAPTURE_NUM;
+    }
+
+    if (!pulseCount)
+        counter.lastCapture = counter.captures[lastIndex];
+
+    return pulseCount;
+}
+
+// Returns the pulses lost to a wrap of the ring before the last
+// getCounterPulses() call, at least one full ring, without delays
+unsigned int getCounterLostPulses()
+{
+    return counter.lostPulseCount;
+}
+
+const unsigned short *getCounterPulseDelays()
+{
+    return counter.pulseDelays;
+}
+
+#ifdef SDL_MODE
+void simCounterPulse(unsigned short delay)
+{
+    counter.captures[counter.simCaptureIndex] = -delay;
+    counter.simCaptureIndex = (counter.simCaptureIndex + 1) % COUNTER_CAPTURE_NUM;
+}
+#endif
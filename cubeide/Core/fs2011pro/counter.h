@@ -0,0 +1,26 @@
+/*
+ * FS2011 Pro
+ * Hardware pulse counter
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#define COUNTER_FREQUENCY 1000000
+#define COUNTER_CAPTURE_NUM 64
+
+void initCounter();
+
+unsigned int getCounterPulses();
+const unsigned short *getCounterPulseDelays();
+unsigned int getCounterLostPulses();
+
+#ifdef SDL_MODE
+void simCounterPulse(unsigned short delay);
+#endif
+
+#endif
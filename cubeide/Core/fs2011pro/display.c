@@ -7,7 +7,6 @@
  * License: MIT
  */
 
-#include <stdio.h>
 #include <string.h>
 
 #ifndef SDL_MODE
@@ -17,22 +16,38 @@
 #include "u8g2/u8g2.h"
 
 #include "resources/font_helvR08.h"
-#include "resources/font_helvR24.h"
 #include "resources/font_icons.h"
 #include "resources/font_tiny5.h"
 
-#include "confidence.h"
 #include "display.h"
+#include "events.h"
 #include "format.h"
+#include "logger.h"
 #include "measurements.h"
 #include "power.h"
 #include "settings.h"
 
 #include "resources/dotted4.xbm"
 
+// Glyphs pre-rasterized by fonts/mkpagefont.py
+typedef struct
+{
+    unsigned char advance;
+    signed char x;
+    unsigned char width;
+    signed char page;
+    unsigned char pageNum;
+    unsigned short offset;
+} PageFontGlyph;
+
+#include "resources/font_helvR24_digits.h"
+
 #define LCD_WIDTH 128
 #define LCD_HEIGHT 64
 
+#define LCD_TILE_WIDTH (LCD_WIDTH / 8)
+#define LCD_TILE_HEIGHT DISPLAY_PAGES
+
 #define LCD_CENTER_X (LCD_WIDTH / 2)
 #define LCD_CENTER_Y (LCD_HEIGHT / 2)
 
@@ -43,12 +58,19 @@
 #define MEASUREMENT_VALUE_Y (LCD_CENTER_Y + 24 / 2)
 #define MEASUREMENT_VALUE_SIDE_X (LCD_CENTER_X + 29)
 
+#if (MEASUREMENT_VALUE_Y % 8) != FONT_HELVR24_DIGITS_BASELINE_ROW
+#error "Regenerate font_helvR24_digits.h for MEASUREMENT_VALUE_Y"
+#endif
+
 #define HISTORY_VIEW_X ((LCD_WIDTH - HISTORY_VIEW_WIDTH) / 2)
 #define HISTORY_VIEW_Y_TOP 14
 #define HISTORY_VIEW_Y_BOTTOM (HISTORY_VIEW_Y_TOP + HISTORY_VIEW_HEIGHT)
 
 #define STATS_VIEW_X 66
 #define STATS_VIEW_Y 31
+#define STATS_VIEW_HISTOGRAM_Y 58
+#define STATS_VIEW_HISTOGRAM_HEIGHT 10
+#define STATS_VIEW_HISTOGRAM_BAR_WIDTH 7
 
 #define GAME_VIEW_BOARD_X 0
 #define GAME_VIEW_BOARD_Y 8
@@ -65,15 +87,102 @@
 #define GAME_VIEW_BUTTON_WIDTH 23
 #define GAME_VIEW_BUTTON_HEIGHT 9
 
+// Larger changes may collide, so one tile row is resent every
+// DISPLAY_REFRESH_FRAMES frames
+#define DISPLAY_REFRESH_FRAMES 8
+
 #define MENU_VIEW_Y_TOP 14
 #define MENU_VIEW_LINE_HEIGHT 12
 #define MENU_VIEW_LINE_TEXT_X 6
 
 u8g2_t u8g2;
 
+// Rows from, to of each region
+const unsigned char displayRegionRows[DISPLAY_REGION_NUM][2] = {
+    {0, TITLE_Y - 5},
+    {TITLE_Y - 5, TITLE_Y + 2},
+    {TITLE_Y + 2, SUBTITLE_Y - 6},
+    {SUBTITLE_Y - 6, LCD_HEIGHT},
+};
+
+struct Display
+{
+    // Hashes of the tiles on the LCD, so only changed tiles are sent
+    bool isInvalid;
+    unsigned short tileHashes[LCD_TILE_HEIGHT][LCD_TILE_WIDTH];
+    unsigned char frameIndex;
+
+    // Hashes of the inputs drawn in each region
+    bool isRegionValid[DISPLAY_REGION_NUM];
+    unsigned int regionHashes[DISPLAY_REGION_NUM];
+
+    // Page rendering: tile rows to draw in this frame (bit mask)
+    bool isHashingRegions;
+    unsigned char invalidRows;
+} display;
+
 const char *const firmwareName = "FS2011 Pro";
 const char *const firmwareVersion = "1.0.2";
 
+// LCD bus: D0-D4 and D7 on GPIOA, D5 and D6 on GPIOF
+#define LCD_GPIOA_MASK 0b1001111100000000
+#define LCD_GPIOF_MASK 0b0000000011000000
+
+#define LCD_GPIOA_WORD(value) ((LCD_GPIOA_MASK << 16) | (((value) << 8) & LCD_GPIOA_MASK))
+#define LCD_GPIOF_WORD(value) ((LCD_GPIOF_MASK << 16) | (((value) << 1) & LCD_GPIOF_MASK))
+
+#ifdef LCD_DMA
+// Bytes per DMA transfer: the longest send, a row of tiles. Sends are
+// encoded before the transfer starts, so the interrupt only ends it
+#define LCD_DMA_BUFFER_SIZE LCD_WIDTH
+// Shorter sends (commands) use the CPU
+#define LCD_DMA_SIZE_MIN 8
+// Cycles per byte
+#define LCD_DMA_PERIOD 16
+
+#define LCD_GPIOA_WORDS4(value) LCD_GPIOA_WORD(value), LCD_GPIOA_WORD(value + 1), \
+                                LCD_GPIOA_WORD(value + 2), LCD_GPIOA_WORD(value + 3)
+#define LCD_GPIOA_WORDS16(value) LCD_GPIOA_WORDS4(value), LCD_GPIOA_WORDS4(value + 4), \
+                                 LCD_GPIOA_WORDS4(value + 8), LCD_GPIOA_WORDS4(value + 12)
+#define LCD_GPIOA_WORDS64(value) LCD_GPIOA_WORDS16(value), LCD_GPIOA_WORDS16(value + 16), \
+                                 LCD_GPIOA_WORDS16(value + 32), LCD_GPIOA_WORDS16(value + 48)
+
+const uint32_t lcdGPIOAWords[256] = {
+    LCD_GPIOA_WORDS64(0),
+    LCD_GPIOA_WORDS64(64),
+    LCD_GPIOA_WORDS64(128),
+    LCD_GPIOA_WORDS64(192),
+};
+
+// Indexed by D5 and D6
+const uint32_t lcdGPIOFWords[4] = {
+    LCD_GPIOF_WORD(0 << 5),
+    LCD_GPIOF_WORD(1 << 5),
+    LCD_GPIOF_WORD(2 << 5),
+    LCD_GPIOF_WORD(3 << 5),
+};
+
+struct DisplayDMA
+{
+    uint32_t gpioAWords[LCD_DMA_BUFFER_SIZE];
+    uint32_t gpioFWords[LCD_DMA_BUFFER_SIZE];
+
+    volatile bool isBusy;
+} displayDMA;
+
+void encodeDisplayWords(const uint8_t *data, unsigned int size,
+                        uint32_t *gpioAWords, uint32_t *gpioFWords)
+{
+    for (unsigned int i = 0; i < size; i++)
+    {
+        uint8_t value = data[i];
+
+        gpioAWords[i] = lcdGPIOAWords[value];
+        gpioFWords[i] = lcdGPIOFWords[(value >> 5) & 0b11];
+    }
+}
+#endif
+
 #ifndef SDL_MODE
 uint8_t onDisplayMessage(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
 {
@@ -94,8 +203,129 @@ uint8_t onDisplayMessage(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_p
     return 1;
 }
 
+#ifdef LCD_DMA
+void initDisplayDMA()
+{
+    __HAL_RCC_TIM1_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    // LCD_EN: TIM1_CH3N while transferring
+    LCD_EN_GPIO_Port->AFR[1] = (LCD_EN_GPIO_Port->AFR[1] & ~GPIO_AFRH_AFSEL15) |
+                               (GPIO_AF2_TIM1 << GPIO_AFRH_AFSEL15_Pos);
+
+    // Every period: CC1 and CC4 write the data (DMA1 channels 2 and 4),
+    // CH3N raises LCD_EN from CCR3 to the end of the period
+    TIM1->PSC = 0;
+    TIM1->ARR = LCD_DMA_PERIOD - 1;
+    TIM1->CCR1 = 1;
+    TIM1->CCR3 = LCD_DMA_PERIOD / 2;
+    TIM1->CCR4 = 1;
+    TIM1->CCMR2 = TIM_CCMR2_OC3M_2 | TIM_CCMR2_OC3M_1;
+    TIM1->CCER = TIM_CCER_CC3NE;
+    TIM1->DIER = TIM_DIER_CC1DE | TIM_DIER_CC4DE;
+    TIM1->BDTR = TIM_BDTR_MOE;
+
+    // Below the pulse capture, like the tick
+    HAL_NVIC_SetPriority(DMA1_Channel2_3_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel2_3_IRQn);
+}
+
+void startDisplayDMA(DMA_Channel_TypeDef *channel, volatile uint32_t *dest,
+                     const uint32_t *source, unsigned int size, uint32_t flags)
+{
+    channel->CCR = 0;
+    channel->CPAR = (uint32_t)dest;
+    channel->CMAR = (uint32_t)source;
+    channel->CNDTR = size;
+    channel->CCR = DMA_CCR_PSIZE_1 |
+                   DMA_CCR_MSIZE_1 |
+                   DMA_CCR_MINC |
+                   DMA_CCR_DIR |
+                   flags |
+                   DMA_CCR_EN;
+}
+
+// Starts the transfer of the encoded words
+void startDisplayDMATransfer(unsigned int size)
+{
+    // The channel 2 transfer complete interrupt ends the transfer
+    startDisplayDMA(DMA1_Channel2, &GPIOA->BSRR,
+                    displayDMA.gpioAWords, size, DMA_CCR_TCIE);
+    startDisplayDMA(DMA1_Channel4, &GPIOF->BSRR,
+                    displayDMA.gpioFWords, size, 0);
+
+    // One-pulse mode: the timer stops after RCR + 1 periods
+    TIM1->RCR = size - 1;
+    TIM1->EGR = TIM_EGR_UG;
+    TIM1->CR1 = TIM_CR1_OPM | TIM_CR1_CEN;
+}
+
+// Sleeps until the transfer in progress is done
+void waitDisplayDMA()
+{
+    __disable_irq();
+
+    while (displayDMA.isBusy)
+    {
+        // A pending interrupt ends the sleep, even while disabled
+        __WFI();
+
+        __enable_irq();
+        __disable_irq();
+    }
+
+    __enable_irq();
+}
+
+// Returns once the last transfer is started, the interrupt ends it. The
+// data is encoded first, so it may change right away. Sends longer than
+// the buffer wait for each transfer
+void sendDisplayDMA(const uint8_t *data, unsigned int size)
+{
+    while (size)
+    {
+        unsigned int transferSize = (size < LCD_DMA_BUFFER_SIZE) ? size : LCD_DMA_BUFFER_SIZE;
+
+        waitDisplayDMA();
+        encodeDisplayWords(data, transferSize,
+                           displayDMA.gpioAWords, displayDMA.gpioFWords);
+
+        displayDMA.isBusy = true;
+
+        LCD_EN_GPIO_Port->MODER = (LCD_EN_GPIO_Port->MODER & ~GPIO_MODER_MODER15) |
+                                  GPIO_MODER_MODER15_1;
+
+        startDisplayDMATransfer(transferSize);
+
+        data += transferSize;
+        size -= transferSize;
+    }
+}
+
+// DMA1 channel 2 transfer complete, once per send
+void onDisplayDMA()
+{
+    DMA1->IFCR = DMA_IFCR_CTCIF2;
+
+    // The last byte is written at the start of its period, LCD_EN ends
+    // with it
+    while (TIM1->CR1 & TIM_CR1_CEN)
+        ;
+
+    LCD_EN_GPIO_Port->MODER = (LCD_EN_GPIO_Port->MODER & ~GPIO_MODER_MODER15) |
+                              GPIO_MODER_MODER15_0;
+
+    displayDMA.isBusy = false;
+}
+#endif
+
 uint8_t onDisplayByte(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
 {
+#ifdef LCD_DMA
+    // The bus is busy until the last DMA send is done
+    waitDisplayDMA();
+#endif
+
     switch (msg)
     {
     case U8X8_MSG_BYTE_SET_DC:
@@ -105,13 +335,21 @@ uint8_t onDisplayByte(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
     case U8X8_MSG_BYTE_SEND:
     {
         uint8_t *p = (uint8_t *)arg_ptr;
+
+#ifdef LCD_DMA
+        if (arg_int >= LCD_DMA_SIZE_MIN)
+        {
+            sendDisplayDMA(p, arg_int);
+
+            break;
+        }
+#endif
+
         for (int i = 0; i < arg_int; i++, p++)
         {
             uint8_t value = *p;
-            GPIOA->BSRR = (0b1001111100000000 << 16) |
-                          ((value << 8) & 0b1001111100000000);
-            GPIOF->BSRR = (0b0000000011000000 << 16) |
-                          ((value << 1) & 0b0000000011000000);
+            GPIOA->BSRR = LCD_GPIOA_WORD(value);
+            GPIOF->BSRR = LCD_GPIOF_WORD(value);
 
             asm("nop");
             LCD_EN_GPIO_Port->BSRR = LCD_EN_Pin;
@@ -264,13 +502,31 @@ uint8_t setupU8X8(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
     return 1;
 }
 
+#endif
+
+uint8_t *getDisplayBuffer(uint8_t *tile_buf_height)
+{
+#if DISPLAY_BUFFER_PAGES == 1
+    return u8g2_m_16_8_1(tile_buf_height);
+#elif DISPLAY_BUFFER_PAGES == 2
+    return u8g2_m_16_8_2(tile_buf_height);
+#else
+    return u8g2_m_16_8_f(tile_buf_height);
+#endif
+}
+
+#ifndef SDL_MODE
 void setupU8G2()
 {
     uint8_t tile_buf_height;
     uint8_t *buf;
     u8g2_SetupDisplay(&u8g2, setupU8X8, u8x8_cad_001, onDisplayByte, onDisplayMessage);
-    buf = u8g2_m_16_8_f(&tile_buf_height);
+    buf = getDisplayBuffer(&tile_buf_height);
     u8g2_SetupBuffer(&u8g2, buf, tile_buf_height, u8g2_ll_hvline_vertical_top_lsb, U8G2_R0);
+
+#ifdef LCD_DMA
+    initDisplayDMA();
+#endif
 }
 
 #endif
@@ -278,7 +534,10 @@ void setupU8G2()
 void initDisplay()
 {
 #ifdef SDL_MODE
-    u8g2_SetupBuffer_SDL_128x64(&u8g2, U8G2_R0);
+    uint8_t tile_buf_height;
+    uint8_t *buf = getDisplayBuffer(&tile_buf_height);
+    u8x8_Setup_SDL_128x64(u8g2_GetU8x8(&u8g2));
+    u8g2_SetupBuffer(&u8g2, buf, tile_buf_height, u8g2_ll_hvline_vertical_top_lsb, U8G2_R0);
 #else
     // u8g2_Setup_st7567_enh_dg128064_f(&u8g2, U8G2_R0, onDisplayByte, onDisplayMessage);
     setupU8G2();
@@ -286,11 +545,17 @@ void initDisplay()
 
     u8g2_InitDisplay(&u8g2);
     u8g2_SetPowerSave(&u8g2, 0);
+
+    display.isInvalid = true;
+    display.invalidRows = 0xff;
 }
 
 void setDisplay(bool value)
 {
     u8g2_SetPowerSave(&u8g2, !value);
+
+    if (value)
+        display.isInvalid = true;
 }
 
 void clearDisplay()
@@ -298,9 +563,233 @@ void clearDisplay()
     u8g2_ClearBuffer(&u8g2);
 }
 
+// Regions: a region is redrawn only when the hash of its inputs changes
+
+void invalidateDisplayRegions()
+{
+    for (int i = 0; i < DISPLAY_REGION_NUM; i++)
+        display.isRegionValid[i] = false;
+}
+
+// FNV-1a
+unsigned int hashDisplayInput(unsigned int hash, const void *data, unsigned int size)
+{
+    const unsigned char *bytes = data;
+
+    for (unsigned int i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+// With page rendering, the buffer is cleared for every page, so a view
+// with regions is first drawn with the regions hashed only. Then only the
+// tile rows of the changed regions are drawn and sent
+void startDisplayRegionHashing()
+{
+    display.isHashingRegions = true;
+    display.invalidRows = 0;
+}
+
+void endDisplayRegionHashing()
+{
+    display.isHashingRegions = false;
+}
+
+#if DISPLAY_BUFFER_PAGES == DISPLAY_PAGES
+// Clears pixel rows firstY to lastY - 1 of the full buffer, whole pages
+// at a time, which u8g2_DrawBox() clears pixel by pixel
+void clearDisplayRows(int firstY, int lastY)
+{
+    uint8_t *buffer = u8g2_GetBufferPtr(&u8g2);
+
+    for (int page = firstY / 8; page <= (lastY - 1) / 8; page++)
+    {
+        int pageFirstY = (firstY > 8 * page) ? firstY - 8 * page : 0;
+        int pageLastY = (lastY < 8 * (page + 1)) ? lastY - 8 * page : 8;
+        uint8_t mask = (0xff << pageFirstY) & (0xff >> (8 - pageLastY));
+        uint8_t *row = buffer + page * LCD_WIDTH;
+
+        if (mask == 0xff)
+            memset(row, 0, LCD_WIDTH);
+        else
+        {
+            for (int x = 0; x < LCD_WIDTH; x++)
+                row[x] &= ~mask;
+        }
+    }
+}
+#endif
+
+// Returns false if the region already shows these inputs, otherwise
+// clears the region for drawing
+bool beginDisplayRegion(int region, unsigned int hash)
+{
+#if DISPLAY_BUFFER_PAGES < DISPLAY_PAGES
+    int firstY = displayRegionRows[region][0];
+    int lastY = displayRegionRows[region][1];
+
+    if (display.isHashingRegions)
+    {
+        if (!display.isRegionValid[region] ||
+            (display.regionHashes[region] != hash))
+        {
+            for (int y = firstY / 8; y <= (lastY - 1) / 8; y++)
+                display.invalidRows |= 1 << y;
+        }
+
+        display.isRegionValid[region] = true;
+        display.regionHashes[region] = hash;
+
+        return false;
+    }
+
+    // Every region on the buffer is drawn
+    return (firstY < 8 * (u8g2.tile_curr_row + u8g2.tile_buf_height)) &&
+           (lastY > 8 * u8g2.tile_curr_row);
+#else
+    if (display.isRegionValid[region])
+    {
+        if (display.regionHashes[region] == hash)
+            return false;
+
+        clearDisplayRows(displayRegionRows[region][0], displayRegionRows[region][1]);
+    }
+
+    display.isRegionValid[region] = true;
+    display.regionHashes[region] = hash;
+
+    return true;
+#endif
+}
+
+// CRC-16 (CCITT, reflected): every change of up to three pixels or within
+// 16 consecutive pixels of a tile changes the hash
+unsigned short getDisplayTileHash(const uint8_t *tile)
+{
+    unsigned short hash = 0xffff;
+
+    for (int i = 0; i < 8; i++)
+    {
+        uint8_t value = tile[i] ^ (uint8_t)hash;
+        value ^= value << 4;
+
+        hash = (((unsigned short)value << 8) | (hash >> 8)) ^
+               (uint8_t)(value >> 4) ^
+               ((unsigned short)value << 3);
+    }
+
+    return hash;
+}
+
+// Sends the runs of changed tiles of each tile row in the buffer
 void updateDisplay()
 {
-    u8g2_SendBuffer(&u8g2);
+    uint8_t *buffer = u8g2_GetBufferPtr(&u8g2);
+    int firstRow = u8g2.tile_curr_row;
+    int lastRow = firstRow + u8g2.tile_buf_height;
+
+    for (int y = firstRow; y < lastRow; y++)
+    {
+        uint8_t *row = buffer + (y - firstRow) * LCD_WIDTH;
+        bool isRowInvalid = display.isInvalid ||
+                            (display.frameIndex == y * DISPLAY_REFRESH_FRAMES);
+        int runStart = -1;
+
+        for (int x = 0; x <= LCD_TILE_WIDTH; x++)
+        {
+            bool isChanged = false;
+
+            if (x < LCD_TILE_WIDTH)
+            {
+                unsigned short hash = getDisplayTileHash(row + x * 8);
+
+                isChanged = isRowInvalid ||
+                            (hash != display.tileHashes[y][x]);
+                display.tileHashes[y][x] = hash;
+            }
+
+            if (isChanged && (runStart < 0))
+                runStart = x;
+            else if (!isChanged && (runStart >= 0))
+            {
+                u8x8_DrawTile(u8g2_GetU8x8(&u8g2), runStart, y, x - runStart,
+                              row + runStart * 8);
+
+                runStart = -1;
+            }
+        }
+    }
+
+    if (lastRow >= LCD_TILE_HEIGHT)
+        display.isInvalid = false;
+}
+
+// Returns the first buffer from row on with invalid tile rows
+int getInvalidDisplayRow(int row)
+{
+    unsigned char bufferRows = (1 << u8g2.tile_buf_height) - 1;
+
+    while ((row < LCD_TILE_HEIGHT) &&
+           !(display.invalidRows & (bufferRows << row)))
+        row += u8g2.tile_buf_height;
+
+    return row;
+}
+
+// Views are drawn in a loop until nextDisplayPage() returns false, once
+// per buffer of DISPLAY_BUFFER_PAGES pages. Buffers without invalid tile
+// rows are skipped; firstDisplayPage() returns false if there is none
+bool firstDisplayPage()
+{
+#if defined(LCD_DMA) && !defined(SDL_MODE)
+    // The last page may still be in transfer from the buffer
+    waitDisplayDMA();
+#endif
+
+    display.frameIndex = (display.frameIndex + 1) %
+                         (LCD_TILE_HEIGHT * DISPLAY_REFRESH_FRAMES);
+
+    if (display.isInvalid)
+        display.invalidRows = 0xff;
+    if (!(display.frameIndex % DISPLAY_REFRESH_FRAMES))
+        display.invalidRows |= 1 << (display.frameIndex / DISPLAY_REFRESH_FRAMES);
+
+    int row = getInvalidDisplayRow(0);
+    if (row >= LCD_TILE_HEIGHT)
+    {
+        display.invalidRows = 0xff;
+
+        return false;
+    }
+
+    u8g2_SetBufferCurrTileRow(&u8g2, row);
+
+    return true;
+}
+
+bool nextDisplayPage()
+{
+    updateDisplay();
+
+    int row = getInvalidDisplayRow(u8g2.tile_curr_row + u8g2.tile_buf_height);
+    if (row >= LCD_TILE_HEIGHT)
+    {
+        display.invalidRows = 0xff;
+
+        return false;
+    }
+
+#if defined(LCD_DMA) && !defined(SDL_MODE)
+    waitDisplayDMA();
+#endif
+
+    u8g2_SetBufferCurrTileRow(&u8g2, row);
+
+    return true;
 }
 
 void drawTextLeft(const char *str, int x, int y)
@@ -318,11 +807,51 @@ void drawTextRight(const char *str, int x, int y)
     u8g2_DrawStr(&u8g2, x - u8g2_GetStrWidth(&u8g2, str), y, str);
 }
 
+// Same pixels as u8g2_DrawStr() with the u8g2 font in solid mode, the
+// baseline y must be at FONT_HELVR24_DIGITS_BASELINE_ROW of its page
+void drawPageFontText(const char *str, int x, int y)
+{
+    uint8_t *buffer = u8g2_GetBufferPtr(&u8g2);
+    // Relative to the first page in the buffer
+    int baselinePage = y / 8 - u8g2.tile_curr_row;
+
+    for (; *str; str++)
+    {
+        unsigned int index = (unsigned char)*str - FONT_HELVR24_DIGITS_FIRST;
+        if (index >= FONT_HELVR24_DIGITS_NUM)
+            continue;
+
+        const PageFontGlyph *glyph = &font_helvR24_digits_glyphs[index];
+        const uint8_t *masks = font_helvR24_digits_data + glyph->offset;
+        const uint8_t *columns = masks + glyph->pageNum;
+        int glyphX = x + glyph->x;
+
+        for (int i = 0; i < glyph->pageNum; i++, columns += glyph->width)
+        {
+            int page = baselinePage + glyph->page + i;
+            if ((page < 0) || (page >= u8g2.tile_buf_height))
+                continue;
+
+            uint8_t mask = ~masks[i];
+            uint8_t *dest = buffer + page * LCD_WIDTH;
+
+            for (int j = 0; j < glyph->width; j++)
+            {
+                int columnX = glyphX + j;
+                if ((columnX >= 0) && (columnX < LCD_WIDTH))
+                    dest[columnX] = (dest[columnX] & mask) | columns[j];
+            }
+        }
+
+        x += glyph->advance;
+    }
+}
+
 void drawSelfTestError(unsigned int value)
 {
     char subtitle[32];
-    strcpy(subtitle, "Self-test failed: ");
-    formatHex(value, subtitle + 18);
+    char *buffer = formatString("Self-test failed: ", subtitle);
+    formatHex(value, buffer);
 
     u8g2_SetFont(&u8g2, font_helvR08);
     drawTextCenter(firmwareName, LCD_CENTER_X, LCD_CENTER_Y - 3);
@@ -343,15 +872,24 @@ void drawWelcome()
 void drawStatusBar()
 {
     signed char batteryLevel = getBatteryLevel();
+    bool isAlarmEnabled = settings.rateAlarm || settings.doseAlarm;
+
+    unsigned int hash = hashDisplayInput(DISPLAY_REGION_HASH_INIT, &batteryLevel, sizeof(batteryLevel));
+    hash = hashDisplayInput(hash, &isAlarmEnabled, sizeof(isAlarmEnabled));
+    if (!beginDisplayRegion(DISPLAY_REGION_STATUS_BAR, hash))
+        return;
 
     if (batteryLevel < 0)
         return;
 
     char statusBar[8];
-    char alarmIcon = (settings.rateAlarm || settings.doseAlarm) ? '<' : ' ';
+    char alarmIcon = isAlarmEnabled ? '<' : ' ';
 
     char batteryIcon = (batteryLevel == BATTERY_LEVEL_CHARGING) ? ':' : '0' + batteryLevel;
-    sprintf(statusBar, "%c?%c", alarmIcon, batteryIcon);
+    statusBar[0] = alarmIcon;
+    statusBar[1] = '?';
+    statusBar[2] = batteryIcon;
+    statusBar[3] = '\0';
 
     u8g2_SetFont(&u8g2, font_icons);
 
@@ -373,31 +911,37 @@ void drawSubtitle(const char *subtitle)
 void drawMeasurementValue(const char *mantissa, const char *characteristic)
 {
     // Value
-    u8g2_SetFont(&u8g2, font_helvR24);
-    drawTextLeft(mantissa, MEASUREMENT_VALUE_X, MEASUREMENT_VALUE_Y);
+    drawPageFontText(mantissa, MEASUREMENT_VALUE_X, MEASUREMENT_VALUE_Y);
 
     // Units
     u8g2_SetFont(&u8g2, font_helvR08);
     drawTextLeft(characteristic, MEASUREMENT_VALUE_SIDE_X, MEASUREMENT_VALUE_Y - 16);
 }
 
-void drawConfidenceIntervals(int sampleNum)
+// Intervals are in tenths of a percent, shown with a decimal below 10%
+char *formatConfidenceInterval(char sign, int value, char *buffer)
 {
-    if (sampleNum == 0)
-        return;
+    buffer = formatChar(sign, buffer);
+    buffer = formatInt(value / 10, buffer);
+    if (value < 100)
+    {
+        buffer = formatChar('.', buffer);
+        buffer = formatChar('0' + value % 10, buffer);
+    }
 
-    int lowerConfidenceInterval;
-    int upperConfidenceInterval;
-    getConfidenceIntervals(sampleNum, &lowerConfidenceInterval, &upperConfidenceInterval);
+    return formatChar('%', buffer);
+}
 
+void drawConfidenceIntervals(int lowerConfidenceInterval, int upperConfidenceInterval)
+{
     u8g2_SetFont(&u8g2, font_tiny5);
 
     char confidenceInterval[16];
 
-    sprintf(confidenceInterval, "+%d%%", upperConfidenceInterval);
+    formatConfidenceInterval('+', upperConfidenceInterval, confidenceInterval);
     drawTextLeft(confidenceInterval, MEASUREMENT_VALUE_SIDE_X, MEASUREMENT_VALUE_Y - 7);
 
-    sprintf(confidenceInterval, "-%d%%", lowerConfidenceInterval);
+    formatConfidenceInterval('-', lowerConfidenceInterval, confidenceInterval);
     drawTextLeft(confidenceInterval, MEASUREMENT_VALUE_SIDE_X, MEASUREMENT_VALUE_Y);
 }
 
@@ -413,12 +957,12 @@ void drawHistory(const char *minLabel, const char *maxLabel,
     // uint8_t lastY = data[0];
     for (int i = 0; i < HISTORY_BUFFER_SIZE; i++)
     {
-        int value = getHistoryDataPoint(i);
-        if (value == 0)
+        HistoryDataPoint dataPoint = getHistoryDataPoint(i);
+        if (dataPoint.mean == 0)
             continue;
 
         int x = (LCD_WIDTH - 1) - i * LCD_WIDTH / HISTORY_BUFFER_SIZE;
-        int y = (value + offset) * HISTORY_VALUE_DECADE / HISTORY_VIEW_HEIGHT / range;
+        int y = (dataPoint.mean + offset) * HISTORY_VALUE_DECADE / HISTORY_VIEW_HEIGHT / range;
 
         // Pixel
         // u8g2_DrawPixel(&u8g2, x, HISTORY_VIEW_Y_BOTTOM - y);
@@ -429,6 +973,20 @@ void drawHistory(const char *minLabel, const char *maxLabel,
         //               lastX, HISTORY_VIEW_Y_BOTTOM - lastY);
         // lastX = x;
         // lastY = y;
+
+        // Envelope: dotted up to the maximum, cleared pixel at the minimum
+        int yMin = (dataPoint.min + offset) * HISTORY_VALUE_DECADE / HISTORY_VIEW_HEIGHT / range;
+        int yMax = (dataPoint.max + offset) * HISTORY_VALUE_DECADE / HISTORY_VIEW_HEIGHT / range;
+
+        for (int j = y + 2; j <= yMax; j += 2)
+            u8g2_DrawPixel(&u8g2, x, HISTORY_VIEW_Y_BOTTOM - j);
+
+        if ((yMin > 0) && (yMin < y))
+        {
+            u8g2_SetDrawColor(&u8g2, 0);
+            u8g2_DrawPixel(&u8g2, x, HISTORY_VIEW_Y_BOTTOM - yMin);
+            u8g2_SetDrawColor(&u8g2, 1);
+        }
     }
 
     // Time divisors
@@ -453,20 +1011,54 @@ void drawHistory(const char *minLabel, const char *maxLabel,
     drawTextLeft(maxLabel, 1, HISTORY_VIEW_Y_TOP - 1);
 }
 
+// Bars are log4-scaled, buckets go from <1 us to >=64 us
+void drawStatsHistogram(const char *title, const volatile unsigned int *histogram, int x)
+{
+    drawTextLeft(title, x, STATS_VIEW_HISTOGRAM_Y - STATS_VIEW_HISTOGRAM_HEIGHT - 1);
+
+    for (int i = 0; i < EVENTS_HISTOGRAM_SIZE; i++)
+    {
+        int height = 0;
+        for (unsigned int count = histogram[i]; count; count >>= 2)
+            height++;
+        if (height > STATS_VIEW_HISTOGRAM_HEIGHT)
+            height = STATS_VIEW_HISTOGRAM_HEIGHT;
+
+        u8g2_DrawBox(&u8g2,
+                     x + STATS_VIEW_HISTOGRAM_BAR_WIDTH * i,
+                     STATS_VIEW_HISTOGRAM_Y - height,
+                     STATS_VIEW_HISTOGRAM_BAR_WIDTH - 1,
+                     height);
+    }
+    u8g2_DrawHLine(&u8g2, x, STATS_VIEW_HISTOGRAM_Y,
+                   STATS_VIEW_HISTOGRAM_BAR_WIDTH * EVENTS_HISTOGRAM_SIZE - 1);
+
+    drawTextLeft("0", x, STATS_VIEW_HISTOGRAM_Y + 6);
+    drawTextRight("64us", x + STATS_VIEW_HISTOGRAM_BAR_WIDTH * EVENTS_HISTOGRAM_SIZE - 1,
+                  STATS_VIEW_HISTOGRAM_Y + 6);
+}
+
 void drawStats()
 {
-    char data[32];
     char line[64];
+    char *buffer;
 
     u8g2_SetFont(&u8g2, font_tiny5);
 
-    formatTime(settings.lifeTimer, data);
-    sprintf(line, "Life timer: %s", data);
+    buffer = formatString("Data log: ", line);
+    formatTime(getLoggerTime(), buffer);
+    drawTextCenter(line, LCD_CENTER_X, STATS_VIEW_Y - 7);
+
+    buffer = formatString("Life timer: ", line);
+    formatTime(settings.lifeTimer, buffer);
     drawTextCenter(line, LCD_CENTER_X, STATS_VIEW_Y);
 
-    formatUnsignedLongLong(settings.lifeCounts, data);
-    sprintf(line, "Life counts: %s", data);
+    buffer = formatString("Life counts: ", line);
+    formatUnsignedLongLong(settings.lifeCounts, buffer);
     drawTextCenter(line, LCD_CENTER_X, STATS_VIEW_Y + 7);
+
+    drawStatsHistogram("Tick time", getEventsTickTimeHistogram(), 2);
+    drawStatsHistogram("Tick latency", getEventsTickLatencyHistogram(), STATS_VIEW_X);
 }
 
 void drawGameBoard(const char board[8][9],
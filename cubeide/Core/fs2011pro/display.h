@@ -11,6 +11,25 @@
 #define DRAW_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+// LCD bus transfers by DMA: TIM1 clocks precomputed GPIO set/reset words
+// out to the data pins and strobes LCD_EN (TIM1_CH3N), uses DMA1 channels
+// 2 and 4 and 1 KB of RAM for the words. Experimental: its CPU time
+// against the CPU send has not been measured on the device:
+// #define LCD_DMA
+
+// Display buffer pages: the full buffer (8 pages, 1 KB of RAM), or page
+// rendering, where views are drawn once per buffer of 2 or 1 pages (256
+// or 128 bytes of RAM) and measurement views redraw only the buffers with
+// changed regions:
+#ifndef DISPLAY_BUFFER_PAGES
+#define DISPLAY_BUFFER_PAGES 8
+#endif
+// #define DISPLAY_BUFFER_PAGES 2
+// #define DISPLAY_BUFFER_PAGES 1
+
+#define DISPLAY_PAGES 8
 
 #define HISTORY_VIEW_HEIGHT 40
 
@@ -18,12 +37,40 @@
 
 #define MENU_VIEW_LINE_NUM 4
 
+#define DISPLAY_REGION_HASH_INIT 2166136261U
+
+// Horizontal bands of the measurement views
+enum DisplayRegion
+{
+    DISPLAY_REGION_STATUS_BAR,
+    DISPLAY_REGION_TITLE,
+    DISPLAY_REGION_VALUE,
+    DISPLAY_REGION_SUBTITLE,
+
+    DISPLAY_REGION_NUM,
+};
+
 typedef const char *GetMenuOption(void *userdata, unsigned int index);
 
 void initDisplay();
 void setDisplay(bool value);
 void clearDisplay();
 void updateDisplay();
+bool firstDisplayPage();
+bool nextDisplayPage();
+
+void invalidateDisplayRegions();
+void startDisplayRegionHashing();
+void endDisplayRegionHashing();
+unsigned int hashDisplayInput(unsigned int hash, const void *data, unsigned int size);
+bool beginDisplayRegion(int region, unsigned int hash);
+unsigned short getDisplayTileHash(const uint8_t *tile);
+
+#ifdef LCD_DMA
+void encodeDisplayWords(const uint8_t *data, unsigned int size,
+                        uint32_t *gpioAWords, uint32_t *gpioFWords);
+void onDisplayDMA();
+#endif
 
 void drawSelfTestError(unsigned value);
 
@@ -33,7 +80,7 @@ void drawTitle(const char *title);
 void drawSubtitle(const char *subtitle);
 
 void drawMeasurementValue(const char *mantissa, const char *characteristic);
-void drawConfidenceIntervals(int sampleNum);
+void drawConfidenceIntervals(int lowerConfidenceInterval, int upperConfidenceInterval);
 void drawHistory(const char *minLabel, const char *maxLabel,
                  int offset, int range);
 
@@ -8,16 +8,26 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
+
+#ifndef SDL_MODE
+#include "main.h"
+#else
+#include "SDL.h"
+#endif
 
 #include "backlight.h"
 #include "cmath.h"
+#include "counter.h"
 #include "events.h"
 #include "game.h"
+#include "logger.h"
 #include "keyboard.h"
 #include "measurements.h"
 #include "power.h"
 #include "settings.h"
 #include "buzzer.h"
+#include "trace.h"
 #include "ui.h"
 
 #define PULSE_SOUND_CLICK_TIME 0.0015F
@@ -28,57 +38,325 @@
 #define PULSE_SOUND_LOUD_TICKS (int)(BUZZER_TICK_FREQUENCY * PULSE_SOUND_BEEP_TIME)
 #define ALARM_TICKS (int)(BUZZER_TICK_FREQUENCY * ALARM_TIME)
 
+// Powers of two, at most 256
+#define EVENT_QUEUE_SIZE 16
+#define PULSE_QUEUE_SIZE 32
+#define PULSE_DELAY_QUEUE_SIZE 128
+
+// Longest sleep, well within the watchdog timeout
+#define TICKLESS_TICKS_MAX 250
+#define TICKLESS_TICKS_MIN 2
+
+// The tick interrupt only captures the pulses of each tick into the pulse
+// queue. Everything else runs in the main loop (updateEvents()), which
+// replays the ticks in order: measurement ticks, keyboard polling,
+// backlight timeout and the one-second measurement snapshot. Replayed ticks
+// produce key and one-second events for the event queue.
+
+typedef struct
+{
+    unsigned char type;
+    unsigned char data;
+} Event;
+
+typedef struct
+{
+    unsigned int tick;
+    unsigned short pulseCount;
+    unsigned char delayIndex;
+    bool hasDelays;
+} TickPulses;
+
 struct Events
 {
     bool isInitialized;
     bool isWelcomed;
 
-    unsigned int tick;
+    // Monotonic, does not wrap in practice (5.8e8 years at 1 kHz)
+    volatile unsigned long long tick;
+    // Next tick to replay in the main loop
+    unsigned long long stageTick;
 
     unsigned int pulseCount;
     unsigned int lastPulseCount;
 
     unsigned int keyTimer;
-    volatile unsigned char keyUpdatePush;
-    volatile unsigned char keyUpdatePull;
+    unsigned int keyPollCount;
+    int key;
 
     bool backlightTimerEnabled;
     unsigned int backlightTimer;
 
     unsigned int oneSecondTimer;
-    volatile unsigned char oneSecondPush;
-    volatile unsigned char oneSecondPull;
+
+    // Single-producer, single-consumer rings: only the producer writes
+    // the head, only the consumer the tail
+    Event queue[EVENT_QUEUE_SIZE];
+    volatile unsigned char queueHead;
+    volatile unsigned char queueTail;
+    volatile unsigned int queueOverflowCount[EVENT_NUM];
+
+    // Producer: tick interrupt, consumer: main loop
+    TickPulses pulseQueue[PULSE_QUEUE_SIZE];
+    volatile unsigned char pulseQueueHead;
+    volatile unsigned char pulseQueueTail;
+    volatile unsigned int pulseQueueOverflowCount;
+    // Pulses held back while the pulse queue is full
+    unsigned int heldPulseTick;
+    unsigned int heldPulseCount;
+#ifdef PULSE_COUNTER
+    unsigned short pulseDelayQueue[PULSE_DELAY_QUEUE_SIZE];
+    volatile unsigned char pulseDelayQueueHead;
+    volatile unsigned char pulseDelayQueueTail;
+#endif
+
+    // Tick interrupt duration and latency (us)
+    unsigned char cycleShift;
+    volatile unsigned int tickTimeHistogram[EVENTS_HISTOGRAM_SIZE];
+    volatile unsigned int tickLatencyHistogram[EVENTS_HISTOGRAM_SIZE];
+#ifdef SDL_MODE
+    Uint64 lastTickCounter;
+#else
+    // Stretched tick (cycles)
+    unsigned int stretchTicks;
+    unsigned int stretchRemainingCycles;
+    unsigned int stretchCycles;
+#endif
 } events;
 
 void initEvents()
 {
     events.isInitialized = true;
 
-    events.keyTimer = events.tick + KEY_TICKS;
+    events.stageTick = events.tick;
+    events.keyTimer = (unsigned int)events.tick + KEY_TICKS;
+    events.key = -1;
 
-    events.oneSecondTimer = TICK_FREQUENCY;
+    events.oneSecondTimer = (unsigned int)events.tick + TICK_FREQUENCY;
+
+#ifndef SDL_MODE
+    for (unsigned int cyclesPerMicrosecond = SystemCoreClock / 1000000;
+         cyclesPerMicrosecond > 1;
+         cyclesPerMicrosecond >>= 1)
+        events.cycleShift++;
+#endif
+
+#ifdef PULSE_COUNTER
+    initCounter();
+#endif
 
     setView(VIEW_WELCOME);
 
     triggerBacklight();
 }
 
-unsigned int getEventsTick()
+// The 64-bit tick is read in two halves, so a tick interrupt in between
+// is detected by reading again
+unsigned long long getEventsTick()
 {
-    return events.tick;
+    unsigned long long tick;
+
+    do
+        tick = events.tick;
+    while (tick != events.tick);
+
+    return tick;
 }
 
+// Microseconds, wraps every 71 minutes
+unsigned int getEventsMicroseconds()
+{
+#ifndef SDL_MODE
+    // With interrupts disabled, a pending tick is counted here
+    unsigned int tick = (unsigned int)events.tick;
+    unsigned int cycles = SysTick->LOAD - SysTick->VAL;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        tick++;
+        cycles = SysTick->LOAD - SysTick->VAL;
+    }
+
+    return tick * (1000000 / TICK_FREQUENCY) + (cycles >> events.cycleShift);
+#else
+    Uint64 counterFrequency = SDL_GetPerformanceFrequency();
+    Uint64 counter = SDL_GetPerformanceCounter();
+
+    if (counterFrequency >= 1000000)
+        return (unsigned int)(counter / (counterFrequency / 1000000));
+    else
+        return (unsigned int)(counter * (1000000 / counterFrequency));
+#endif
+}
+
+// Timers are 32-bit and compared modulo 2^32 with the replayed tick
 bool isTimerElapsed(unsigned int tick)
 {
-    int deltaTime = events.tick - tick;
+    int deltaTime = (unsigned int)events.stageTick - tick;
 
     return (deltaTime >= 0);
 }
 
-void triggerPulse()
+// Event queue
+
+bool pushEvent(unsigned char type, unsigned char data)
 {
-    events.pulseCount++;
+    unsigned char head = events.queueHead;
+    if ((unsigned char)(head - events.queueTail) >= EVENT_QUEUE_SIZE)
+    {
+        events.queueOverflowCount[type]++;
 
+        return false;
+    }
+
+    events.queue[head % EVENT_QUEUE_SIZE].type = type;
+    events.queue[head % EVENT_QUEUE_SIZE].data = data;
+
+    // The event is written before it is published
+    __sync_synchronize();
+    events.queueHead = head + 1;
+
+    return true;
+}
+
+bool popEvent(Event *event)
+{
+    unsigned char tail = events.queueTail;
+    if (tail == events.queueHead)
+        return false;
+
+    // The event is read after it is published, and released after it is read
+    __sync_synchronize();
+    *event = events.queue[tail % EVENT_QUEUE_SIZE];
+    __sync_synchronize();
+    events.queueTail = tail + 1;
+
+    return true;
+}
+
+unsigned int getEventsOverflowCount(int type)
+{
+    return events.queueOverflowCount[type];
+}
+
+// Pulse queue
+
+bool isPulseQueueFull(unsigned char head)
+{
+    return (unsigned char)(head - events.pulseQueueTail) >= PULSE_QUEUE_SIZE;
+}
+
+// While the queue is full, pulses are held back, without delays. Once
+// there is room, they are queued at the tick they were first held back.
+void pushPulses(unsigned int pulseCount, const unsigned short *pulseDelays)
+{
+    unsigned char head = events.pulseQueueHead;
+    TickPulses *tickPulses;
+
+    // A record holds at most 0xffff pulses, the rest stays held back
+    while (events.heldPulseCount && !isPulseQueueFull(head))
+    {
+        unsigned int heldPulseCount = events.heldPulseCount;
+        if (heldPulseCount > 0xffff)
+            heldPulseCount = 0xffff;
+
+        tickPulses = &events.pulseQueue[head % PULSE_QUEUE_SIZE];
+        tickPulses->tick = events.heldPulseTick;
+        tickPulses->pulseCount = heldPulseCount;
+        tickPulses->hasDelays = false;
+        head++;
+
+        events.heldPulseCount -= heldPulseCount;
+    }
+
+    if (pulseCount && isPulseQueueFull(head))
+    {
+        if (!events.heldPulseCount)
+            events.heldPulseTick = (unsigned int)events.tick;
+        events.heldPulseCount += pulseCount;
+
+        events.pulseQueueOverflowCount++;
+    }
+    else if (pulseCount)
+    {
+        tickPulses = &events.pulseQueue[head % PULSE_QUEUE_SIZE];
+        tickPulses->tick = (unsigned int)events.tick;
+        tickPulses->pulseCount = pulseCount;
+        tickPulses->hasDelays = false;
+        head++;
+
+#ifdef PULSE_COUNTER
+        unsigned char delayHead = events.pulseDelayQueueHead;
+        if (pulseDelays &&
+            ((unsigned int)(unsigned char)(delayHead - events.pulseDelayQueueTail) + pulseCount <=
+             PULSE_DELAY_QUEUE_SIZE))
+        {
+            for (unsigned int i = 0; i < pulseCount; i++)
+                events.pulseDelayQueue[(unsigned char)(delayHead + i) % PULSE_DELAY_QUEUE_SIZE] =
+                    pulseDelays[i];
+
+            tickPulses->delayIndex = delayHead;
+            tickPulses->hasDelays = true;
+            events.pulseDelayQueueHead = delayHead + pulseCount;
+        }
+#else
+        (void)pulseDelays;
+#endif
+    }
+
+    // The records are written before they are published
+    __sync_synchronize();
+    events.pulseQueueHead = head;
+}
+
+TickPulses *peekPulses()
+{
+    unsigned char tail = events.pulseQueueTail;
+    if (tail == events.pulseQueueHead)
+        return NULL;
+
+    __sync_synchronize();
+
+    return &events.pulseQueue[tail % PULSE_QUEUE_SIZE];
+}
+
+void popPulses()
+{
+    __sync_synchronize();
+    events.pulseQueueTail++;
+}
+
+unsigned int getEventsPulseOverflowCount()
+{
+    return events.pulseQueueOverflowCount;
+}
+
+// Histograms: bucket 0 counts values below 1 us, bucket i values
+// from 2^(i-1) us, the last bucket the rest
+
+void addHistogramValue(volatile unsigned int *histogram, unsigned int value)
+{
+    unsigned int bucket = 0;
+    while (value && (bucket < (EVENTS_HISTOGRAM_SIZE - 1)))
+    {
+        value >>= 1;
+        bucket++;
+    }
+
+    histogram[bucket]++;
+}
+
+const volatile unsigned int *getEventsTickTimeHistogram()
+{
+    return events.tickTimeHistogram;
+}
+
+const volatile unsigned int *getEventsTickLatencyHistogram()
+{
+    return events.tickLatencyHistogram;
+}
+
+void triggerPulseSound()
+{
     switch (settings.pulseSound)
     {
     case PULSE_SOUND_QUIET:
@@ -91,6 +369,13 @@ void triggerPulse()
     }
 }
 
+void triggerPulse()
+{
+    events.pulseCount++;
+
+    triggerPulseSound();
+}
+
 void triggerBacklight()
 {
     if ((settings.backlight == BACKLIGHT_OFF) || (settings.backlight == BACKLIGHT_ON))
@@ -98,37 +383,119 @@ void triggerBacklight()
     else
     {
         events.backlightTimerEnabled = true;
-        events.backlightTimer = getEventsTick() + TICK_FREQUENCY * getBacklightTime(settings.backlight);
+        events.backlightTimer = (unsigned int)events.stageTick +
+                                TICK_FREQUENCY * getBacklightTime(settings.backlight);
     }
 
     setBacklight(settings.backlight != BACKLIGHT_OFF);
 }
 
+// Tick interrupt: captures the pulses of the tick
 void onEventsTick()
 {
     if (!events.isInitialized)
         return;
 
-    // Pulses
+#ifndef SDL_MODE
+    unsigned int entryCycles = SysTick->LOAD - SysTick->VAL;
+#else
+    Uint64 entryCounter = SDL_GetPerformanceCounter();
+#endif
+
+#ifdef PULSE_COUNTER
+    // Pulses lost to a wrap of the capture ring are counted without delays
+    unsigned int newPulses = getCounterPulses();
+    unsigned int lostPulses = getCounterLostPulses();
+    const unsigned short *pulseDelays = lostPulses ? NULL : getCounterPulseDelays();
+    newPulses += lostPulses;
+
+    if (newPulses)
+        triggerPulseSound();
+
+    if (newPulses || events.heldPulseCount)
+        pushPulses(newPulses, pulseDelays);
+#else
     unsigned int pulseCount = events.pulseCount;
     unsigned int newPulses = pulseCount - events.lastPulseCount;
     events.lastPulseCount = pulseCount;
 
-    onMeasurementTick(newPulses);
+    if (newPulses || events.heldPulseCount)
+        pushPulses(newPulses, NULL);
+#endif
+
+    if (newPulses)
+        traceEvent(TRACE_PULSES, (newPulses > 0xff) ? 0xff : newPulses);
+
+    events.tick++;
+
+#ifndef SDL_MODE
+    unsigned int exitCycles = SysTick->LOAD - SysTick->VAL;
+
+    addHistogramValue(events.tickLatencyHistogram, entryCycles >> events.cycleShift);
+    addHistogramValue(events.tickTimeHistogram, (exitCycles - entryCycles) >> events.cycleShift);
+#else
+    // The SDL tick runs late when the main loop is busy
+    Uint64 counterFrequency = SDL_GetPerformanceFrequency();
+    Uint64 exitCounter = SDL_GetPerformanceCounter();
+    Uint64 tickPeriod = counterFrequency / TICK_FREQUENCY;
+    Uint64 tickDelay = entryCounter - events.lastTickCounter;
+    events.lastTickCounter = entryCounter;
+
+    addHistogramValue(events.tickLatencyHistogram,
+                      (tickDelay > tickPeriod) ? (tickDelay - tickPeriod) * 1000000 / counterFrequency : 0);
+    addHistogramValue(events.tickTimeHistogram,
+                      (exitCounter - entryCounter) * 1000000 / counterFrequency);
+#endif
+}
+
+// Replays the tick at events.stageTick
+void onEventsStageTick(const TickPulses *tickPulses)
+{
+    // Pulses
+    if (tickPulses)
+    {
+        unsigned int pulseCount = tickPulses->pulseCount;
+        const unsigned short *pulseDelays = NULL;
+
+#ifdef PULSE_COUNTER
+        unsigned short delays[PULSE_DELAY_QUEUE_SIZE];
+        if (tickPulses->hasDelays)
+        {
+            for (unsigned int i = 0; i < pulseCount; i++)
+                delays[i] = events.pulseDelayQueue[(unsigned char)(tickPulses->delayIndex + i) %
+                                                   PULSE_DELAY_QUEUE_SIZE];
+            pulseDelays = delays;
+
+            events.pulseDelayQueueTail = tickPulses->delayIndex + pulseCount;
+        }
+#endif
 
-    settings.lifeCounts += newPulses;
+        onMeasurementTick(pulseCount, pulseDelays);
 
-    // Keyboard
+        settings.lifeCounts += pulseCount;
+    }
+    else
+        skipMeasurementTicks(1);
+
+    // Keyboard: polls the replay is behind on would all read the current
+    // keys, so they are collapsed into the latest due poll
     if (isTimerElapsed(events.keyTimer))
     {
         events.keyTimer += KEY_TICKS;
+        events.keyPollCount++;
 
-        int key = getKeyboardKey();
-        if (key >= 0)
+        if ((int)((unsigned int)getEventsTick() - events.keyTimer) <= 0)
         {
-            events.keyUpdatePush = ((events.keyUpdatePush & ~0xf) + 0x10) | key;
+            int key = getKeyboardKey(events.keyPollCount);
+            events.keyPollCount = 0;
+
+            if (key >= 0)
+            {
+                traceEvent(TRACE_KEY, key);
+                pushEvent(EVENT_KEY, key);
 
-            triggerBacklight();
+                triggerBacklight();
+            }
         }
     }
 
@@ -143,52 +510,299 @@ void onEventsTick()
     if (isTimerElapsed(events.oneSecondTimer))
     {
         events.oneSecondTimer += TICK_FREQUENCY;
-        events.oneSecondPush++;
+        pushEvent(EVENT_ONE_SECOND, 0);
 
         if (isInstantaneousRateAlarm() || isDoseAlarm())
+        {
+            traceEvent(TRACE_ALARM, 0);
             triggerBuzzer(ALARM_TICKS);
+        }
 
         onMeasurementOneSecond();
     }
 
-    events.tick++;
+    events.stageTick++;
 }
 
-void updateEvents()
+// Returns the number of ticks from events.stageTick that would do nothing
+// but count, as no deadline is due
+unsigned int getEventsIdleTicks(bool isKeyboardPolled)
 {
-    unsigned char oneSecondPush = events.oneSecondPush;
-    if (events.oneSecondPull != oneSecondPush)
-    {
-        events.oneSecondPull = oneSecondPush;
+    unsigned int tick = (unsigned int)events.stageTick;
+    unsigned int idleTicks = TICKLESS_TICKS_MAX;
+
+    if (isKeyboardPolled &&
+        ((events.keyTimer - tick) < idleTicks))
+        idleTicks = events.keyTimer - tick;
 
-        updateMeasurements();
+    if ((events.oneSecondTimer - tick) < idleTicks)
+        idleTicks = events.oneSecondTimer - tick;
 
-        updateBattery();
+    if (events.backlightTimerEnabled &&
+        ((events.backlightTimer - tick) < idleTicks))
+        idleTicks = events.backlightTimer - tick;
 
-        updateGameTimer();
+    return idleTicks;
+}
 
-        if (!events.isWelcomed)
+// Equivalent to replaying idle ticks
+void skipEventsTicks(unsigned int ticks)
+{
+    if (!ticks)
+        return;
+
+    skipMeasurementTicks(ticks);
+
+    events.stageTick += ticks;
+
+    // The keyboard poll keeps its phase
+    int keyDelay = (unsigned int)events.stageTick - events.keyTimer;
+    if (keyDelay > 0)
+        events.keyTimer += (keyDelay + KEY_TICKS - 1) / KEY_TICKS * KEY_TICKS;
+}
+
+// Replays captured ticks until an event is produced or the replay is
+// up to date. Returns false when there is nothing left to replay.
+bool updateEventsStage()
+{
+    unsigned long long tick = getEventsTick();
+    unsigned char queueHead = events.queueHead;
+
+    while (events.stageTick != tick)
+    {
+        // Idle ticks up to the next pulse or deadline are skipped. Held
+        // back pulses may be queued after their tick was replayed, and are
+        // then replayed at once.
+        TickPulses *tickPulses = peekPulses();
+        unsigned long long ticks = tick - events.stageTick;
+        if (tickPulses)
         {
-            events.isWelcomed = true;
+            int pulseTicks = tickPulses->tick - (unsigned int)events.stageTick;
+            if (pulseTicks <= 0)
+                ticks = 0;
+            else if ((unsigned int)pulseTicks < ticks)
+                ticks = pulseTicks;
+        }
+
+        unsigned int idleTicks = getEventsIdleTicks(true);
+        skipEventsTicks((ticks < idleTicks) ? (unsigned int)ticks : idleTicks);
+
+        if (events.stageTick == tick)
+            break;
 
-            setView(VIEW_INSTANTANEOUS_RATE);
+        if (tickPulses &&
+            ((int)(tickPulses->tick - (unsigned int)events.stageTick) <= 0))
+        {
+            onEventsStageTick(tickPulses);
+            popPulses();
         }
+        else
+            onEventsStageTick(NULL);
+
+        if (events.queueHead != queueHead)
+            return true;
+    }
+
+    return false;
+}
+
+bool isEventsStageIdle()
+{
+    return events.isInitialized &&
+           (events.stageTick == events.tick) &&
+           (events.pulseQueueHead == events.pulseQueueTail) &&
+           !events.heldPulseCount &&
+           (events.queueHead == events.queueTail) &&
+           (events.pulseCount == events.lastPulseCount);
+}
+
+// Returns the number of ticks SysTick may be stretched over, 0 if the
+// MCU sleeps until the next tick. While the keyboard is idle, a key press
+// wakes the MCU.
+unsigned int getEventsSleepTicks()
+{
+#ifdef TICKLESS
+    if (!isEventsStageIdle() || !isKeyboardIdle())
+        return 0;
+
+    unsigned int idleTicks = getEventsIdleTicks(false);
+
+    return (idleTicks >= TICKLESS_TICKS_MIN) ? idleTicks : 0;
+#else
+    return 0;
+#endif
+}
 
-        updateView();
+#ifdef SDL_MODE
+// Counts ticks slept without a tick interrupt, as endEventsTickStretch()
+// does
+void skipEventsSleepTicks(unsigned int ticks)
+{
+    events.tick += ticks;
+}
+#endif
+
+// Sleeps until the next interrupt. With TICKLESS, SysTick is stretched
+// over the idle ticks, which the replay then skips.
+void sleepEvents()
+{
+#ifndef SDL_MODE
+    __disable_irq();
 
-        addClamped(&settings.lifeTimer, 1);
+    if (!isEventsStageIdle())
+    {
+        __enable_irq();
+
+        return;
     }
+
+#ifdef TICKLESS
+    unsigned int sleepTicks = getEventsSleepTicks();
+
+    if (sleepTicks &&
+        stretchEventsTick(sleepTicks))
+    {
+        __WFI();
+
+        endEventsTickStretch();
+    }
+    else
+        __WFI();
+#else
+    __WFI();
+#endif
+
+    __enable_irq();
+#endif
 }
 
-int getEventsKey()
+#ifndef SDL_MODE
+// Stretches the current tick over the given number of ticks, so ticks
+// without a tick interrupt (tickless sleep, flash erase stalls) are still
+// counted. Call with interrupts disabled; returns false if the tick is due.
+bool stretchEventsTick(unsigned int ticks)
+{
+    unsigned int tickCycles = SystemCoreClock / TICK_FREQUENCY;
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    unsigned int remainingCycles = SysTick->VAL;
+
+    if (!remainingCycles ||
+        (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk))
+    {
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+        return false;
+    }
+
+    // Until the tick after the stretched ticks
+    events.stretchTicks = ticks;
+    events.stretchRemainingCycles = remainingCycles;
+    events.stretchCycles = remainingCycles + ticks * tickCycles;
+    SysTick->LOAD = events.stretchCycles - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    return true;
+}
+
+// Counts the ticks elapsed since stretchEventsTick() and restores the tick
+// phase. Call with interrupts disabled.
+void endEventsTickStretch()
+{
+    unsigned int tickCycles = SystemCoreClock / TICK_FREQUENCY;
+    unsigned int remainingCycles = events.stretchRemainingCycles;
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+    // Skipped ticks and cycles to the next tick
+    unsigned int skippedTicks;
+    unsigned int nextCycles;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        skippedTicks = events.stretchTicks;
+        nextCycles = tickCycles;
+    }
+    else
+    {
+        unsigned int elapsedCycles = events.stretchCycles - SysTick->VAL;
+        if (elapsedCycles < remainingCycles)
+        {
+            skippedTicks = 0;
+            nextCycles = remainingCycles - elapsedCycles;
+        }
+        else
+        {
+            elapsedCycles -= remainingCycles;
+            skippedTicks = 1 + elapsedCycles / tickCycles;
+            nextCycles = tickCycles - elapsedCycles % tickCycles;
+        }
+    }
+
+    SysTick->LOAD = nextCycles - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = tickCycles - 1;
+
+    events.tick += skippedTicks;
+    uwTick += skippedTicks * uwTickFreq;
+}
+#endif
+
+void onEventsOneSecond()
+{
+    updateMeasurements();
+
+    updateLogger();
+
+    updateBattery();
+
+    updateGameTimer();
+
+    if (!events.isWelcomed)
+    {
+        events.isWelcomed = true;
+
+        setView(VIEW_INSTANTANEOUS_RATE);
+    }
+
+    updateView();
+
+    addClamped(&settings.lifeTimer, 1);
+}
+
+// Stops at a key event, so getEventsKey() returns every key
+void updateEvents()
 {
-    unsigned char keyUpdatePush = events.keyUpdatePush;
-    if (events.keyUpdatePull != keyUpdatePush)
+    Event event;
+
+    while (events.key < 0)
     {
-        events.keyUpdatePull = keyUpdatePush;
+        if (!popEvent(&event))
+        {
+            if (updateEventsStage())
+                continue;
 
-        return (keyUpdatePush & 0xf);
+            break;
+        }
+
+        switch (event.type)
+        {
+        case EVENT_KEY:
+            events.key = event.data;
+            break;
+
+        case EVENT_ONE_SECOND:
+            onEventsOneSecond();
+            break;
+        }
     }
+}
+
+int getEventsKey()
+{
+    int key = events.key;
+    events.key = -1;
 
-    return -1;
+    return key;
 }
@@ -10,17 +10,60 @@
 #ifndef EVENTS_H
 #define EVENTS_H
 
+#include <stdbool.h>
+
+// Pulse acquisition: one EXTI interrupt per pulse, or hardware counting
+// (TIM16 capture + DMA) read once per tick:
+// #define PULSE_COUNTER
+
+// Tickless sleep: the tick is stopped while no deadline is due, and pulses
+// and keys wake the MCU through EXTI:
+// #define TICKLESS
+
+#if defined(TICKLESS) && defined(PULSE_COUNTER)
+#error "TICKLESS requires EXTI pulse acquisition"
+#endif
+
 #define TICK_FREQUENCY 1000
 #define KEY_TICKS ((int)(TICK_FREQUENCY * 0.025F))
 
+#define EVENTS_HISTOGRAM_SIZE 8
+
+enum EventType
+{
+    EVENT_KEY,
+    EVENT_ONE_SECOND,
+
+    EVENT_NUM,
+};
+
 void initEvents();
 
+unsigned long long getEventsTick();
+unsigned int getEventsMicroseconds();
+
 void triggerPulse();
 void triggerBacklight();
 
 void onEventsTick();
+unsigned int getEventsSleepTicks();
+void sleepEvents();
 void updateEvents();
 
+#ifdef SDL_MODE
+void skipEventsSleepTicks(unsigned int ticks);
+#endif
+
+#ifndef SDL_MODE
+bool stretchEventsTick(unsigned int ticks);
+void endEventsTickStretch();
+#endif
+
+const volatile unsigned int *getEventsTickTimeHistogram();
+const volatile unsigned int *getEventsTickLatencyHistogram();
+
 int getEventsKey();
+unsigned int getEventsOverflowCount(int type);
+unsigned int getEventsPulseOverflowCount();
 
 #endif
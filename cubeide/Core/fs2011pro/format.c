@@ -7,8 +7,6 @@
  * License: MIT
  */
 
-#include <stdio.h>
-
 #include "format.h"
 #include "cmath.h"
 #include "settings.h"
@@ -44,9 +42,87 @@ char getMetricPrefix(int exponent)
     }
 }
 
+// The writers return the end of the written string, so strings can be
+// built without sprintf
+
+char *formatString(const char *value, char *buffer)
+{
+    while (*value)
+        *buffer++ = *value++;
+
+    *buffer = '\0';
+
+    return buffer;
+}
+
+char *formatChar(char value, char *buffer)
+{
+    *buffer++ = value;
+    *buffer = '\0';
+
+    return buffer;
+}
+
+const unsigned int formatPowersOfTen[] = {
+    1000000000,
+    100000000,
+    10000000,
+    1000000,
+    100000,
+    10000,
+    1000,
+    100,
+    10,
+    1,
+};
+
+#define FORMAT_DIGITS_MAX (sizeof(formatPowersOfTen) / sizeof(unsigned int))
+
+// Like "%0*d": digits are found by subtraction, as the Cortex-M0 has no
+// divide instruction
+char *formatDigits(int value, int width, char *buffer)
+{
+    unsigned int absValue = value;
+
+    if (value < 0)
+    {
+        *buffer++ = '-';
+        absValue = -absValue;
+        width--;
+    }
+
+    unsigned int i = 0;
+    while ((i < (FORMAT_DIGITS_MAX - 1)) && (absValue < formatPowersOfTen[i]))
+        i++;
+
+    for (int digitNum = FORMAT_DIGITS_MAX - i; width > digitNum; width--)
+        *buffer++ = '0';
+
+    for (; i < FORMAT_DIGITS_MAX; i++)
+    {
+        char digit = '0';
+        while (absValue >= formatPowersOfTen[i])
+        {
+            absValue -= formatPowersOfTen[i];
+            digit++;
+        }
+
+        *buffer++ = digit;
+    }
+
+    *buffer = '\0';
+
+    return buffer;
+}
+
+char *formatInt(int value, char *buffer)
+{
+    return formatDigits(value, 1, buffer);
+}
+
 const char *const formatHexDigit = "0123456789abcdef";
 
-void formatHex(unsigned int value, char *buffer)
+char *formatHex(unsigned int value, char *buffer)
 {
     for (int i = 7; i >= 0; i--)
     {
@@ -55,41 +131,84 @@ void formatHex(unsigned int value, char *buffer)
     }
 
     buffer[8] = '\0';
+
+    return buffer + 8;
 }
 
-void formatUnsignedLongLong(unsigned long long value, char *buffer)
+// 10^19 to 10^9
+const unsigned long long formatLongPowersOfTen[] = {
+    10000000000000000000ULL,
+    1000000000000000000ULL,
+    100000000000000000ULL,
+    10000000000000000ULL,
+    1000000000000000ULL,
+    100000000000000ULL,
+    10000000000000ULL,
+    1000000000000ULL,
+    100000000000ULL,
+    10000000000ULL,
+    1000000000ULL,
+};
+
+#define FORMAT_LONG_DIGITS_MAX (sizeof(formatLongPowersOfTen) / sizeof(unsigned long long))
+
+// Like "%llu": digits are found by subtraction too, the lower 9 by
+// formatDigits()
+char *formatUnsignedLongLong(unsigned long long value, char *buffer)
 {
-    unsigned long long shiftRegister = value;
-
-    do
-    {
-        buffer++;
-        shiftRegister /= 10;
-    } while (shiftRegister);
+    unsigned int i = 0;
+    while ((i < FORMAT_LONG_DIGITS_MAX) && (value < formatLongPowersOfTen[i]))
+        i++;
 
-    *buffer = '\0';
+    int width = (i < FORMAT_LONG_DIGITS_MAX) ? 9 : 1;
 
-    do
+    for (; i < FORMAT_LONG_DIGITS_MAX; i++)
     {
-        *--buffer = '0' + (value % 10);
-        value /= 10;
-    } while (value);
+        char digit = '0';
+        while (value >= formatLongPowersOfTen[i])
+        {
+            value -= formatLongPowersOfTen[i];
+            digit++;
+        }
+
+        *buffer++ = digit;
+    }
+
+    return formatDigits((int)value, width, buffer);
 }
 
-void formatUnits(const char *unitName, int exponent,
-                 char *characteristic)
+char *formatUnits(const char *unitName, int exponent,
+                  char *characteristic)
 {
     char metricPrefix = getMetricPrefix(exponent);
 
-    if (metricPrefix == ' ')
-        sprintf(characteristic, "%s", unitName);
-    else
-        sprintf(characteristic, "%c%s", metricPrefix, unitName);
+    if (metricPrefix != ' ')
+        characteristic = formatChar(metricPrefix, characteristic);
+
+    return formatString(unitName, characteristic);
 }
 
+// Formats mantissa with 3 - decimalPoint decimals
+void formatMantissa(int mantissa, int decimalPoint, char *mantissaBuffer)
+{
+    char *end = formatDigits(mantissa, 4 - decimalPoint, mantissaBuffer);
+    char *point = end - (3 - decimalPoint);
+
+    for (char *p = end; p >= point; p--)
+        p[1] = p[0];
+
+    *point = '.';
+}
+
+#ifndef FIXED_POINT
 void formatMantissaAndCharacteristic(const char *unitName, float value, int minExponent,
                                      char *mantissaBuffer, char *characteristicBuffer)
 {
+    // Unit scales and their products are rounded, so a value with few
+    // decimals can be a few ulps below them, and would be truncated to the
+    // digit below
+    value *= 1 + 1.0F / (1 << 21);
+
     int exponent = getExponent(value);
 
     if (exponent < minExponent)
@@ -97,45 +216,28 @@ void formatMantissaAndCharacteristic(const char *unitName, float value, int minE
 
     formatUnits(unitName, exponent, characteristicBuffer);
 
-    int mantissa = (int)(value * getPowerOfTen(3 - exponent));
-    int decimalPoint = remainderDown(exponent, 3);
-    switch (decimalPoint)
-    {
-    case 0:
-        sprintf(mantissaBuffer, "%d.%03d",
-                mantissa / 1000, mantissa % 1000);
-        break;
-
-    case 1:
-        sprintf(mantissaBuffer, "%d.%02d",
-                mantissa / 100, mantissa % 100);
-        break;
-
-    case 2:
-        sprintf(mantissaBuffer, "%d.%01d",
-                mantissa / 10, mantissa % 10);
-        break;
-    }
+    int mantissa = (int)getFloatDecimal(value, 3 - exponent, false);
+    formatMantissa(mantissa, remainderDown(exponent, 3), mantissaBuffer);
 }
 
-void formatValue(const char *unitName, float value, int minExponent,
+void formatValue(const char *unitName, float value,
                  char *buffer)
 {
     int exponent = getExponent(value);
 
-    char characteristicBuffer[16];
-    formatUnits(unitName, exponent, characteristicBuffer);
-
     int decimalPoint = remainderDown(exponent, 3);
-    sprintf(buffer, "%d %s", (int)(value * getPowerOfTen(decimalPoint - exponent)), characteristicBuffer);
-}
+    int integer = (int)getFloatDecimal(value, decimalPoint - exponent, true);
 
-void formatMultiplier(const char *unitName, int exponent, int minExponent,
-                      char *buffer)
-{
-    float value = getPowerOfTen(exponent);
+    // Rounding can carry into the next metric prefix
+    if (integer >= 1000)
+    {
+        integer = 1;
+        exponent++;
+    }
 
-    formatValue(unitName, value, minExponent, buffer);
+    buffer = formatInt(integer, buffer);
+    buffer = formatChar(' ', buffer);
+    formatUnits(unitName, exponent, buffer);
 }
 
 void formatRate(float rate,
@@ -150,10 +252,10 @@ void formatRate(float rate,
                                     characteristic);
 
     if (rate == 0)
-        sprintf(mantissa, "-.---");
+        formatString("-.---", mantissa);
 }
 
-void formatDose(unsigned int count,
+void formatDose(unsigned long long count,
                 char *mantissa, char *characteristic)
 {
     Unit *unit = &units[settings.units].dose;
@@ -163,16 +265,171 @@ void formatDose(unsigned int count,
                                     unit->minExponent,
                                     mantissa, characteristic);
 }
+#else
+// Fixed-point values are product / 2^shift * 10^exponent
+
+void formatFixedMantissaAndCharacteristic(const char *unitName,
+                                          unsigned long long product, int shift, int exponent,
+                                          int minExponent,
+                                          char *mantissaBuffer, char *characteristicBuffer)
+{
+    int valueExponent = product ? getFixedExponent(product, shift) + exponent : minExponent;
+
+    if (valueExponent < minExponent)
+        valueExponent = minExponent;
+
+    formatUnits(unitName, valueExponent, characteristicBuffer);
+
+    int mantissa = (int)getFixedDecimal(product, shift, 3 - valueExponent + exponent, false);
+    formatMantissa(mantissa, remainderDown(valueExponent, 3), mantissaBuffer);
+}
+
+void formatFixedValue(const char *unitName,
+                      unsigned long long product, int shift, int exponent,
+                      char *buffer)
+{
+    int valueExponent = product ? getFixedExponent(product, shift) + exponent : 0;
+
+    int decimalPoint = remainderDown(valueExponent, 3);
+    int value = (int)getFixedDecimal(product, shift, decimalPoint - valueExponent + exponent, true);
+
+    // Rounding can carry into the next metric prefix
+    if (value >= 1000)
+    {
+        value = 1;
+        valueExponent++;
+    }
+
+    buffer = formatInt(value, buffer);
+    buffer = formatChar(' ', buffer);
+    formatUnits(unitName, valueExponent, buffer);
+}
+
+void formatRate(Rate rate,
+                char *mantissa, char *characteristic)
+{
+    Unit *unit = &units[settings.units].rate;
+
+    formatFixedMantissaAndCharacteristic(unit->name,
+                                         (unsigned long long)unit->scaleMantissa * rate,
+                                         FIXED_SHIFT + UNIT_SCALE_SHIFT,
+                                         unit->scaleExponent,
+                                         unit->minExponent,
+                                         mantissa,
+                                         characteristic);
+
+    if (rate == 0)
+        formatString("-.---", mantissa);
+}
+
+// Drops low count bits so the product fits in 64 bits
+unsigned long long getFixedDoseProduct(Unit *unit, unsigned long long count, int *shift)
+{
+    *shift = UNIT_SCALE_SHIFT;
+    while ((count >> 32) && *shift)
+    {
+        count >>= 1;
+        (*shift)--;
+    }
+
+    return unit->scaleMantissa * count;
+}
+
+void formatDose(unsigned long long count,
+                char *mantissa, char *characteristic)
+{
+    Unit *unit = &units[settings.units].dose;
+
+    int shift;
+    unsigned long long product = getFixedDoseProduct(unit, count, &shift);
+
+    formatFixedMantissaAndCharacteristic(unit->name,
+                                         product,
+                                         shift,
+                                         unit->scaleExponent,
+                                         unit->minExponent,
+                                         mantissa, characteristic);
+}
+
+void formatRateValue(Rate rate, char *buffer)
+{
+    Unit *unit = &units[settings.units].rate;
+
+    formatFixedValue(unit->name,
+                     (unsigned long long)unit->scaleMantissa * rate,
+                     FIXED_SHIFT + UNIT_SCALE_SHIFT,
+                     unit->scaleExponent,
+                     buffer);
+}
+
+void formatDoseValue(unsigned long long count, char *buffer)
+{
+    Unit *unit = &units[settings.units].dose;
+
+    int shift;
+    unsigned long long product = getFixedDoseProduct(unit, count, &shift);
+
+    formatFixedValue(unit->name,
+                     product,
+                     shift,
+                     unit->scaleExponent,
+                     buffer);
+}
+#endif
 
-void formatTime(unsigned int time,
-                char *buffer)
+// Formats 10^exponent as 1, 10 or 100 with a metric prefix
+void formatMultiplier(const char *unitName, int exponent,
+                      char *buffer)
+{
+    buffer = formatChar('1', buffer);
+    for (int i = remainderDown(exponent, 3); i > 0; i--)
+        buffer = formatChar('0', buffer);
+    buffer = formatChar(' ', buffer);
+    formatUnits(unitName, exponent, buffer);
+}
+
+// 3600 * 10^i, so hours are found by subtraction too
+const unsigned int formatHourPowersOfTen[] = {
+    3600000000,
+    360000000,
+    36000000,
+    3600000,
+    360000,
+    36000,
+    3600,
+};
+
+#define FORMAT_HOUR_DIGITS_MAX (sizeof(formatHourPowersOfTen) / sizeof(unsigned int))
+
+char *formatTime(unsigned int time,
+                 char *buffer)
 {
-    unsigned int secs = time % 60;
-    unsigned int mins = (time / 60) % 60;
-    unsigned int hours = time / 3600;
+    unsigned int hours = 0;
+    for (unsigned int i = 0; i < FORMAT_HOUR_DIGITS_MAX; i++)
+    {
+        unsigned int powerOfTen = formatPowersOfTen[FORMAT_DIGITS_MAX - FORMAT_HOUR_DIGITS_MAX + i];
+
+        while (time >= formatHourPowersOfTen[i])
+        {
+            time -= formatHourPowersOfTen[i];
+            hours += powerOfTen;
+        }
+    }
+
+    unsigned int mins = 0;
+    for (; time >= 600; time -= 600)
+        mins += 10;
+    for (; time >= 60; time -= 60)
+        mins++;
+
+    if (hours != 0)
+    {
+        buffer = formatInt(hours, buffer);
+        buffer = formatChar(':', buffer);
+    }
+
+    buffer = formatDigits(mins, 2, buffer);
+    buffer = formatChar(':', buffer);
 
-    if (hours == 0)
-        sprintf(buffer, "%02d:%02d", mins, secs);
-    else
-        sprintf(buffer, "%d:%02d:%02d", hours, mins, secs);
+    return formatDigits(time, 2, buffer);
 }
@@ -10,19 +10,30 @@
 #ifndef FORMAT_H
 #define FORMAT_H
 
-void formatHex(unsigned int value, char *buffer);
-void formatUnsignedLongLong(unsigned long long value, char *buffer);
+#include "cmath.h"
+
+char *formatString(const char *value, char *buffer);
+char *formatChar(char value, char *buffer);
+char *formatDigits(int value, int width, char *buffer);
+char *formatInt(int value, char *buffer);
+char *formatHex(unsigned int value, char *buffer);
+char *formatUnsignedLongLong(unsigned long long value, char *buffer);
+#ifndef FIXED_POINT
 void formatMantissaAndCharacteristic(const char *unitName, float value, int minExponent,
                                      char *mantissaBuffer, char *characteristicBuffer);
-void formatValue(const char *unitName, float value, int minExponent,
+void formatValue(const char *unitName, float value,
                  char *buffer);
-void formatMultiplier(const char *unitName, int exponent, int minExponent,
+#else
+void formatRateValue(Rate rate, char *buffer);
+void formatDoseValue(unsigned long long count, char *buffer);
+#endif
+void formatMultiplier(const char *unitName, int exponent,
                       char *buffer);
-void formatRate(float rate,
+void formatRate(Rate rate,
                 char *mantissa, char *characteristic);
-void formatDose(unsigned int count,
+void formatDose(unsigned long long count,
                 char *mantissa, char *characteristic);
-void formatTime(unsigned int time,
-                char *buffer);
+char *formatTime(unsigned int time,
+                 char *buffer);
 
 #endif
@@ -8,7 +8,6 @@
  */
 
 #include <stdbool.h>
-#include <stdio.h>
 #include <string.h>
 
 #include "display.h"
@@ -16,6 +15,7 @@
 #include "keyboard.h"
 #include "menus.h"
 #include "settings.h"
+#include "trace.h"
 #include "ui.h"
 
 #include "mcu-max/mcu-max.h"
@@ -201,7 +201,12 @@ void updateGame()
 
         if (!isGamePlayerMove())
         {
-            if (!mcumax_play_best_move(gameSkillToNodesCount[settings.gameSkillLevel], &game.move))
+            traceEvent(TRACE_GAME_SEARCH_START, settings.gameSkillLevel);
+            bool isMoveFound = mcumax_play_best_move(gameSkillToNodesCount[settings.gameSkillLevel],
+                                                     &game.move);
+            traceEvent(TRACE_GAME_SEARCH_END, settings.gameSkillLevel);
+
+            if (!isMoveFound)
             {
                 game.state = GAME_SELECT_FIRST_MOVE;
 
@@ -245,11 +250,12 @@ void updateGameTimer()
 
 void formatGameMove(mcumax_move move, char *buffer)
 {
-    sprintf(buffer, "%c%c-%c%c",
-            'a' + (move.from & 0x7),
-            '1' + 7 - ((move.from & 0x70) >> 4),
-            'a' + (move.to & 0x7),
-            '1' + 7 - ((move.to & 0x70) >> 4));
+    buffer[0] = 'a' + (move.from & 0x7);
+    buffer[1] = '1' + 7 - ((move.from & 0x70) >> 4);
+    buffer[2] = '-';
+    buffer[3] = 'a' + (move.to & 0x7);
+    buffer[4] = '1' + 7 - ((move.to & 0x70) >> 4);
+    buffer[5] = '\0';
 }
 
 void drawGameView()
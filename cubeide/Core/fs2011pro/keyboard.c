@@ -46,9 +46,41 @@ void initKeyboard()
     keyboard.wasKeyDown[KEY_POWER] = 1;
 
     keyboard.pressedKey = -1;
+
+#if defined(TICKLESS) && !defined(SDL_MODE)
+    // Key presses wake the MCU from tickless sleep
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+    GPIO_InitStruct.Pull = GPIO_PULLUP;
+
+    GPIO_InitStruct.Pin = KEY_UP_Pin;
+    HAL_GPIO_Init(KEY_UP_GPIO_Port, &GPIO_InitStruct);
+
+    GPIO_InitStruct.Pin = KEY_DOWN_Pin | KEY_SELECT_Pin | KEY_BACK_Pin | KEY_POWER_Pin;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+    HAL_NVIC_SetPriority(EXTI0_1_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(EXTI0_1_IRQn);
+    HAL_NVIC_SetPriority(EXTI2_3_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(EXTI2_3_IRQn);
+#endif
+}
+
+// True when no key is down, so polling can stop until a key press
+bool isKeyboardIdle()
+{
+    if (keyboard.pressedKey >= 0)
+        return false;
+
+    for (int i = 0; i < KEY_NUM; i++)
+        if (keyboard.wasKeyDown[i])
+            return false;
+
+    return true;
 }
 
-int getKeyboardKey()
+// Polls the keys, counting them as held for the given number of polls
+int getKeyboardKey(unsigned int pollCount)
 {
     bool isKeyDown[KEY_NUM];
     int key = -1;
@@ -97,11 +129,14 @@ int getKeyboardKey()
 
     if (keyboard.pressedKey >= 0)
     {
-        keyboard.pressedTicks++;
+        // A key pressed since the last poll is held for one poll
+        unsigned int pressedPolls = keyboard.pressedTicks ? pollCount : 1;
+        unsigned int lastPressedTicks = keyboard.pressedTicks;
+        keyboard.pressedTicks += pressedPolls;
 
         if (keyboard.pressedTicks >= KEY_PRESSED_TICKS)
         {
-            keyboard.pressedRepeatTicks++;
+            keyboard.pressedRepeatTicks += pressedPolls;
 
             if (keyboard.pressedRepeatTicks >= KEY_PRESSED_REPEAT_TICKS)
             {
@@ -112,7 +147,8 @@ int getKeyboardKey()
             }
         }
 
-        if (keyboard.pressedTicks == KEY_LONGPRESS_TICKS)
+        if ((lastPressedTicks < KEY_LONGPRESS_TICKS) &&
+            (keyboard.pressedTicks >= KEY_LONGPRESS_TICKS))
         {
             switch (keyboard.pressedKey)
             {
@@ -10,6 +10,8 @@
 #ifndef KEYBOARD_H
 #define KEYBOARD_H
 
+#include <stdbool.h>
+
 enum Keys
 {
     KEY_POWER,
@@ -26,6 +28,7 @@ enum Keys
 };
 
 void initKeyboard();
-int getKeyboardKey();
+int getKeyboardKey(unsigned int pollCount);
+bool isKeyboardIdle();
 
 #endif
@@ -0,0 +1,342 @@
+/*
+ * FS2011 Pro
+ * Data logger
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+
+#ifndef SDL_MODE
+#include "main.h"
+#endif
+
+#include "logger.h"
+#include "settings.h"
+
+// The pulse count of every minute is logged to the free flash pages
+// between the firmware image and the checkpoint pages, the .logger
+// section of the linker script. Pages are used
+// as a ring. Each page starts with a header (magic, sequence number),
+// so the newest page is found from the page headers alone and only
+// that page is scanned at boot.
+//
+// Records are buffered in RAM and written as blocks: record number << 8 |
+// data size, life timer at the first record (2 halfwords), zigzag varint
+// encoded count deltas, checksum. A block with a bad checksum (power
+// loss while writing) ends its page.
+
+#ifndef SDL_MODE
+extern const unsigned char _slogger[];
+extern const unsigned char _elogger[];
+
+#define LOGGER_PAGE_START (((unsigned int)_slogger - FLASH_BASE) / SETTINGS_PAGE_SIZE)
+#define LOGGER_PAGE_END (((unsigned int)_elogger - FLASH_BASE) / SETTINGS_PAGE_SIZE)
+#else
+#define LOGGER_PAGE_START 0x20
+#define LOGGER_PAGE_END 0x30
+#endif
+
+#define LOGGER_MAGIC 0x474c
+#define LOGGER_PAGE_HEADER_SIZE 4
+#define LOGGER_BLOCK_HEADER_SIZE 6
+#define LOGGER_BLOCK_RECORD_NUM 32
+#define LOGGER_BLOCK_DATA_SIZE 64
+#define LOGGER_BLOCK_SIZE_MAX (LOGGER_BLOCK_HEADER_SIZE + LOGGER_BLOCK_DATA_SIZE + 2)
+#define LOGGER_EMPTY 0xffff
+
+struct Logger
+{
+    int pageStart;
+    int page;
+    unsigned short sequence;
+    unsigned int writeOffset;
+
+    unsigned int recordTime;
+    unsigned long long lastLifeCounts;
+
+    unsigned int blockTime;
+    unsigned int blockRecordNum;
+    unsigned int blockDataSize;
+    unsigned int blockLastCount;
+    unsigned char blockData[LOGGER_BLOCK_DATA_SIZE];
+
+    int readPage;
+    unsigned int readPageNum;
+    unsigned int readOffset;
+    unsigned int readTime;
+    unsigned int readRecordNum;
+    unsigned int readLastCount;
+    const unsigned char *readData;
+} logger;
+
+unsigned short readLoggerHalfword(int page, unsigned int offset)
+{
+    return *((unsigned short *)getSettingsAddress(page, 0) + offset / 2);
+}
+
+int getNextLoggerPage(int page)
+{
+    page++;
+
+    return (page >= LOGGER_PAGE_END) ? logger.pageStart : page;
+}
+
+unsigned int getLoggerBlockSize(unsigned int dataSize)
+{
+    return LOGGER_BLOCK_HEADER_SIZE + ((dataSize + 1) & ~1) + 2;
+}
+
+// Returns the block size, or 0 if there is no valid block at offset
+unsigned int validateLoggerBlock(int page, unsigned int offset)
+{
+    if ((offset + LOGGER_BLOCK_HEADER_SIZE) > SETTINGS_PAGE_SIZE)
+        return 0;
+
+    unsigned short header = readLoggerHalfword(page, offset);
+    if ((header == LOGGER_EMPTY) ||
+        ((header & 0xff) > LOGGER_BLOCK_DATA_SIZE))
+        return 0;
+
+    unsigned int blockSize = getLoggerBlockSize(header & 0xff);
+    if ((offset + blockSize) > SETTINGS_PAGE_SIZE)
+        return 0;
+
+    unsigned short checksum = 0;
+    for (unsigned int i = 0; i < (blockSize - 2); i += 2)
+        checksum += readLoggerHalfword(page, offset + i);
+
+    if (readLoggerHalfword(page, offset + blockSize - 2) != (unsigned short)~checksum)
+        return 0;
+
+    return blockSize;
+}
+
+void initLogger()
+{
+    logger.pageStart = LOGGER_PAGE_START;
+    logger.page = -1;
+    logger.sequence = 0;
+
+    // A ring needs two pages at least
+    if ((LOGGER_PAGE_END - logger.pageStart) < 2)
+        logger.pageStart = LOGGER_PAGE_END;
+
+    for (int page = logger.pageStart; page < LOGGER_PAGE_END; page++)
+    {
+        if (readLoggerHalfword(page, 0) != LOGGER_MAGIC)
+            continue;
+
+        unsigned short sequence = readLoggerHalfword(page, 2);
+        if ((logger.page < 0) ||
+            ((short)(sequence - logger.sequence) > 0))
+        {
+            logger.page = page;
+            logger.sequence = sequence;
+        }
+    }
+
+    logger.writeOffset = SETTINGS_PAGE_SIZE;
+    if (logger.page >= 0)
+    {
+        unsigned int offset = LOGGER_PAGE_HEADER_SIZE;
+        unsigned int blockSize;
+        while ((blockSize = validateLoggerBlock(logger.page, offset)))
+            offset += blockSize;
+
+        if ((offset + 2) <= SETTINGS_PAGE_SIZE &&
+            (readLoggerHalfword(logger.page, offset) == LOGGER_EMPTY))
+            logger.writeOffset = offset;
+    }
+
+    logger.recordTime = 0;
+    logger.lastLifeCounts = settings.lifeCounts;
+    logger.blockRecordNum = 0;
+    logger.blockDataSize = 0;
+}
+
+// Writing
+
+void startLoggerPage()
+{
+    logger.page = (logger.page < 0) ? logger.pageStart : getNextLoggerPage(logger.page);
+    logger.sequence++;
+
+    eraseSettingsPage(logger.page);
+
+    unsigned short header[] = {LOGGER_MAGIC, logger.sequence};
+    writeSettingsData(getSettingsAddress(logger.page, 0), header, sizeof(header));
+
+    logger.writeOffset = LOGGER_PAGE_HEADER_SIZE;
+}
+
+// Writes the buffered records
+void writeLogger()
+{
+    if (!logger.blockRecordNum)
+        return;
+
+    unsigned int blockSize = getLoggerBlockSize(logger.blockDataSize);
+    if ((logger.writeOffset + blockSize) > SETTINGS_PAGE_SIZE)
+        startLoggerPage();
+
+    unsigned short block[LOGGER_BLOCK_SIZE_MAX / 2];
+    unsigned int blockIndex = 0;
+    block[blockIndex++] = (logger.blockRecordNum << 8) | logger.blockDataSize;
+    block[blockIndex++] = logger.blockTime & 0xffff;
+    block[blockIndex++] = logger.blockTime >> 16;
+    for (unsigned int i = 0; i < logger.blockDataSize; i += 2)
+    {
+        unsigned char high = ((i + 1) < logger.blockDataSize) ? logger.blockData[i + 1] : 0xff;
+        block[blockIndex++] = logger.blockData[i] | (high << 8);
+    }
+
+    unsigned short checksum = 0;
+    for (unsigned int i = 0; i < blockIndex; i++)
+        checksum += block[i];
+    block[blockIndex++] = ~checksum;
+
+    writeSettingsData(getSettingsAddress(logger.page, 0) + logger.writeOffset,
+                      block, blockSize);
+
+    logger.writeOffset += blockSize;
+    logger.blockRecordNum = 0;
+    logger.blockDataSize = 0;
+}
+
+void addLoggerRecord(unsigned int count)
+{
+    // Zigzag encoding maps small deltas of either sign to small values
+    unsigned int lastCount = logger.blockRecordNum ? logger.blockLastCount : 0;
+    int delta = (int)(count - lastCount);
+    unsigned int value = ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+
+    unsigned char data[5];
+    unsigned int dataSize = 0;
+    do
+    {
+        data[dataSize] = value & 0x7f;
+        value >>= 7;
+        if (value)
+            data[dataSize] |= 0x80;
+        dataSize++;
+    } while (value);
+
+    if ((logger.blockDataSize + dataSize) > LOGGER_BLOCK_DATA_SIZE)
+    {
+        writeLogger();
+        addLoggerRecord(count);
+
+        return;
+    }
+
+    if (!logger.blockRecordNum)
+        logger.blockTime = settings.lifeTimer;
+
+    for (unsigned int i = 0; i < dataSize; i++)
+        logger.blockData[logger.blockDataSize++] = data[i];
+    logger.blockRecordNum++;
+    logger.blockLastCount = count;
+
+    if (logger.blockRecordNum >= LOGGER_BLOCK_RECORD_NUM)
+        writeLogger();
+}
+
+void updateLogger()
+{
+    if (logger.pageStart >= LOGGER_PAGE_END)
+        return;
+
+    logger.recordTime++;
+    if (logger.recordTime < LOGGER_RECORD_TIME)
+        return;
+    logger.recordTime = 0;
+
+    unsigned long long lifeCounts = settings.lifeCounts;
+    unsigned long long count = lifeCounts - logger.lastLifeCounts;
+    logger.lastLifeCounts = lifeCounts;
+
+    addLoggerRecord((count > UINT_MAX) ? UINT_MAX : (unsigned int)count);
+}
+
+// Reading, from the oldest to the newest record in flash
+
+void rewindLogger()
+{
+    logger.readPage = (logger.page < 0) ? -1 : getNextLoggerPage(logger.page);
+    logger.readPageNum = 0;
+    logger.readOffset = SETTINGS_PAGE_SIZE;
+    logger.readRecordNum = 0;
+}
+
+bool readLoggerRecord(unsigned int *time, unsigned int *count)
+{
+    if (logger.readPage < 0)
+        return false;
+
+    while (!logger.readRecordNum)
+    {
+        unsigned int blockSize = validateLoggerBlock(logger.readPage, logger.readOffset);
+        if (!blockSize)
+        {
+            // Next page
+            if (logger.readPageNum >= (unsigned int)(LOGGER_PAGE_END - logger.pageStart))
+                return false;
+
+            if (logger.readPageNum)
+                logger.readPage = getNextLoggerPage(logger.readPage);
+            logger.readPageNum++;
+
+            logger.readOffset = (readLoggerHalfword(logger.readPage, 0) == LOGGER_MAGIC)
+                                    ? LOGGER_PAGE_HEADER_SIZE
+                                    : SETTINGS_PAGE_SIZE;
+
+            continue;
+        }
+
+        logger.readRecordNum = readLoggerHalfword(logger.readPage, logger.readOffset) >> 8;
+        logger.readTime = readLoggerHalfword(logger.readPage, logger.readOffset + 2) |
+                          (readLoggerHalfword(logger.readPage, logger.readOffset + 4) << 16);
+        logger.readLastCount = 0;
+        logger.readData = getSettingsAddress(logger.readPage, 0) +
+                          logger.readOffset + LOGGER_BLOCK_HEADER_SIZE;
+
+        logger.readOffset += blockSize;
+    }
+
+    unsigned int value = 0;
+    unsigned int shift = 0;
+    unsigned char data;
+    do
+    {
+        data = *logger.readData++;
+        value |= (data & 0x7f) << shift;
+        shift += 7;
+    } while ((data & 0x80) && (shift < 32));
+
+    logger.readLastCount += (value >> 1) ^ -(value & 1);
+
+    *time = logger.readTime;
+    *count = logger.readLastCount;
+
+    logger.readTime += LOGGER_RECORD_TIME;
+    logger.readRecordNum--;
+
+    return true;
+}
+
+// Returns the time from the oldest record in flash to now (s)
+unsigned int getLoggerTime()
+{
+    unsigned int time;
+    unsigned int count;
+
+    rewindLogger();
+    if (!readLoggerRecord(&time, &count))
+        return 0;
+
+    return settings.lifeTimer - time;
+}
@@ -0,0 +1,25 @@
+/*
+ * FS2011 Pro
+ * Data logger
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdbool.h>
+
+#define LOGGER_RECORD_TIME 60
+
+void initLogger();
+void updateLogger();
+void writeLogger();
+
+void rewindLogger();
+bool readLoggerRecord(unsigned int *time, unsigned int *count);
+unsigned int getLoggerTime();
+
+#endif
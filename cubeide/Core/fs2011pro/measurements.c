@@ -9,8 +9,11 @@
 
 #include <limits.h>
 #include <math.h>
-#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
 
+#include "checkpoint.h"
+#include "confidence.h"
 #include "display.h"
 #include "format.h"
 #include "keyboard.h"
@@ -20,354 +23,808 @@
 #include "settings.h"
 #include "ui.h"
 
-#define OVERLOAD_RATE 500
-#define TIME_MAX (ULONG_MAX / TICK_FREQUENCY)
+// Overload when a quarter of the time is dead time
+#ifdef FIXED_POINT
+#define OVERLOAD_RATE FIXED(0.25F / DEAD_TIME)
+#else
+#define OVERLOAD_RATE (0.25F / DEAD_TIME)
+#endif
+#define DEAD_TIME_ITERATIONS 5
+#define DEAD_TIME_Q32 ((unsigned long long)(DEAD_TIME * 4294967296.0 + 0.5))
 
-#define INSTANTANEOUS_RATE_HISTORY_STATS_NUM 5
-#define INSTANTANEOUS_RATE_PULSE_NUM (10 + 1)
-
-typedef struct
-{
-    unsigned int firstPulseTick;
-    unsigned int pulseCount;
-} PeriodStats;
-
-struct InstantaneousRate
-{
-    unsigned int tick;
-    unsigned int lastPulseTick;
-
-    PeriodStats current;
-    PeriodStats history[INSTANTANEOUS_RATE_HISTORY_STATS_NUM];
-
-    unsigned int pulseTicksCount;
-    unsigned int pulseTicksIndex;
-    unsigned int pulseTicks[INSTANTANEOUS_RATE_PULSE_NUM];
-
-    unsigned int snapshotTime;
-    unsigned int snapshotCount;
-    unsigned int snapshotTicks;
-    float snapshotValue;
-    float snapshotMaxValue;
-
-    bool isHold;
-    unsigned int holdTime;
-    unsigned int holdCount;
-    float holdValue;
-} instantaneousRate;
-
-struct AverageRate
-{
-    unsigned int tick;
-    unsigned int lastPulseTick;
-    unsigned int firstPulseTick;
-    unsigned int pulseCount;
-
-    unsigned int snapshotTime;
-    unsigned int snapshotCount;
-    unsigned int snapshotTicks;
-    float snapshotValue;
-
-    bool isHold;
-    unsigned int holdTime;
-    unsigned int holdCount;
-    float holdValue;
-} averageRate;
-
-struct Dose
-{
-    unsigned int pulseCount;
-
-    unsigned int snapshotTime;
-    unsigned int snapshotValue;
-
-    bool isHold;
-    unsigned int holdTime;
-    unsigned int holdValue;
-} dose;
+// Pulse timestamps (us)
+#define PULSE_TIME_FREQUENCY 1000000
+#define PULSE_TIME_PER_TICK (PULSE_TIME_FREQUENCY / TICK_FREQUENCY)
 
+// Each history is decimated from the one before it
 typedef const struct
 {
     char *const name;
-    unsigned int samplesPerDataPoint;
+    unsigned int decimationFactor;
 } History;
 
-typedef struct
-{
-    float sampleSum;
-    unsigned int sampleNum;
-
-    unsigned char bufferIndex;
-    unsigned char buffer[HISTORY_BUFFER_SIZE];
-} HistoryState;
-
 History histories[HISTORY_NUM] = {
     {"History (2m)", 1},
     {"History (10m)", 5},
-    {"History (1h)", 30},
-    {"History (6h)", 180},
-    {"History (24h)", 720},
+    {"History (1h)", 6},
+    {"History (6h)", 6},
+    {"History (24h)", 4},
+};
+
+MeasurementContext measurementContext;
+
+// Histories from CHECKPOINT_HISTORY_FIRST on are kept across power cycles,
+// their completed data points are written in batches (s)
+#define CHECKPOINT_HISTORY_FIRST HISTORY_1H
+#define CHECKPOINT_HISTORY_NUM (HISTORY_NUM - CHECKPOINT_HISTORY_FIRST)
+#define CHECKPOINT_HISTORY_PERIOD (3 * 60)
+// Accumulators are checkpointed on power off, at the latest every
+// CHECKPOINT_STATE_PERIOD (s), and once the dose pulses since the last
+// write reach both CHECKPOINT_STATE_PULSES_MIN and 1/64 of the dose, but
+// not within CHECKPOINT_STATE_PERIOD_MIN (s) of the last write. A power
+// loss then loses at most 1/64 of the dose, 64 pulses, or the pulses of
+// the last minute, while the writes grow with the log of the dose
+#define CHECKPOINT_STATE_PERIOD (30 * 60)
+#define CHECKPOINT_STATE_PERIOD_MIN 60
+#define CHECKPOINT_STATE_PULSES_MIN 64
+#define CHECKPOINT_STATE_PULSES_SHIFT 6
+
+#define CHECKPOINT_STATE_SIZE (sizeof(AverageRate) +    \
+                               sizeof(Dose) +           \
+                               CHECKPOINT_HISTORY_NUM * \
+                                   offsetof(HistoryState, buffer))
+#define CHECKPOINT_SNAPSHOT_SIZE (CHECKPOINT_STATE_SIZE + \
+                                  CHECKPOINT_HISTORY_NUM * HISTORY_BUFFER_SIZE * sizeof(HistoryDataPoint))
+
+enum CheckpointType
+{
+    CHECKPOINT_SNAPSHOT,
+    CHECKPOINT_STATE,
+    CHECKPOINT_HISTORY_DATA_POINTS,
 };
-HistoryState historyStates[HISTORY_NUM];
-unsigned int historySampleIndex;
+
+struct MeasurementCheckpoint
+{
+    bool isSnapshotPending;
+    unsigned int historyTime;
+    unsigned int stateTime;
+    unsigned int statePulseCount;
+    unsigned char bufferIndex[HISTORY_NUM];
+} measurementCheckpoint;
 
 // Reset
 
 void initMeasurements()
 {
-    resetInstantaneousRate();
-    resetAverageRate();
-    resetDose();
-    resetHistory();
+    resetMeasurementContext(&measurementContext);
+    measurementCheckpoint.isSnapshotPending = true;
+
+    initCheckpoint();
+    readMeasurementCheckpoint();
 }
 
 void resetPeriodStats(PeriodStats *periodStats)
 {
-    periodStats->firstPulseTick = 0;
+    periodStats->firstPulseTime = 0;
     periodStats->pulseCount = 0;
 }
 
-void resetInstantaneousRate()
+void resetInstantaneousRateContext(MeasurementContext *context)
 {
-    instantaneousRate.tick = 0;
-    instantaneousRate.lastPulseTick = 0;
-    resetPeriodStats(&instantaneousRate.current);
+    InstantaneousRate *instantaneousRate = &context->instantaneousRate;
+
+    instantaneousRate->tick = 0;
+    instantaneousRate->lastPulseTime = 0;
+    resetPeriodStats(&instantaneousRate->current);
     for (unsigned int i = 0; i < INSTANTANEOUS_RATE_HISTORY_STATS_NUM; i++)
-        resetPeriodStats(&instantaneousRate.history[i]);
+        resetPeriodStats(&instantaneousRate->history[i]);
 
-    instantaneousRate.pulseTicksCount = 0;
-    instantaneousRate.pulseTicksIndex = 0;
+    instantaneousRate->pulseTimesCount = 0;
+    instantaneousRate->pulseTimesIndex = 0;
     for (unsigned int i = 0; i < INSTANTANEOUS_RATE_PULSE_NUM; i++)
-        instantaneousRate.pulseTicks[i] = 0;
-
-    instantaneousRate.snapshotTime = 0;
-    instantaneousRate.snapshotCount = 0;
-    instantaneousRate.snapshotValue = 0;
-    instantaneousRate.snapshotMaxValue = 0;
-
-    instantaneousRate.isHold = false;
-    instantaneousRate.holdCount = 0;
-    instantaneousRate.holdValue = 0;
-    instantaneousRate.holdTime = 0;
+        instantaneousRate->pulseTimes[i] = 0;
+
+    instantaneousRate->snapshotTime = 0;
+    instantaneousRate->snapshotCount = 0;
+    instantaneousRate->snapshotValue = 0;
+    instantaneousRate->snapshotMaxValue = 0;
+    instantaneousRate->isOverload = false;
+
+    instantaneousRate->isHold = false;
+    instantaneousRate->holdCount = 0;
+    instantaneousRate->holdValue = 0;
+    instantaneousRate->holdTime = 0;
 }
 
-void resetAverageRate()
+void resetAverageRateContext(MeasurementContext *context)
 {
-    averageRate.tick = 0;
-    averageRate.firstPulseTick = 0;
-    averageRate.lastPulseTick = 0;
-    averageRate.pulseCount = 0;
+    AverageRate *averageRate = &context->averageRate;
+
+    averageRate->tick = 0;
+    averageRate->firstPulseTime = 0;
+    averageRate->lastPulseTime = 0;
+    averageRate->pulseCount = 0;
 
-    averageRate.snapshotTime = 0;
-    averageRate.snapshotCount = 0;
-    averageRate.snapshotValue = 0;
+    averageRate->snapshotTime = 0;
+    averageRate->snapshotCount = 0;
+    averageRate->snapshotValue = 0;
+    averageRate->isOverload = false;
 }
 
-void resetDose()
+void resetDoseContext(MeasurementContext *context)
 {
-    dose.pulseCount = 0;
+    Dose *dose = &context->dose;
+
+    dose->pulseCount = 0;
 
-    dose.snapshotTime = 0;
-    dose.snapshotValue = 0;
+    dose->snapshotTime = 0;
+    dose->snapshotValue = 0;
+
+    dose->lastSnapshotTime = 0;
+    dose->lastSnapshotValue = 0;
+    dose->deadTimeValue = 0;
+    dose->correctedValue = 0;
 }
 
-void resetHistory()
+void resetHistoryContext(MeasurementContext *context)
 {
+    HistoryState *historyStates = context->historyStates;
+
     for (unsigned int i = 0; i < HISTORY_NUM; i++)
     {
         HistoryState *historyState = &historyStates[i];
 
         historyState->sampleSum = 0;
+        historyState->sampleMin = 0;
+        historyState->sampleMax = 0;
         historyState->sampleNum = 0;
 
         historyState->bufferIndex = 0;
         for (unsigned int i = 0; i < HISTORY_BUFFER_SIZE; i++)
-            historyState->buffer[i] = 0;
+        {
+            historyState->buffer[i].mean = 0;
+            historyState->buffer[i].min = 0;
+            historyState->buffer[i].max = 0;
+        }
     }
+}
+
+void resetMeasurementContext(MeasurementContext *context)
+{
+    resetInstantaneousRateContext(context);
+    resetAverageRateContext(context);
+    resetDoseContext(context);
+    resetHistoryContext(context);
+}
 
-    historySampleIndex = 0;
+void resetInstantaneousRate()
+{
+    resetInstantaneousRateContext(&measurementContext);
+}
+
+void resetAverageRate()
+{
+    resetAverageRateContext(&measurementContext);
+
+    measurementCheckpoint.isSnapshotPending = true;
+}
+
+void resetDose()
+{
+    resetDoseContext(&measurementContext);
+
+    measurementCheckpoint.isSnapshotPending = true;
+}
+
+void resetHistory()
+{
+    resetHistoryContext(&measurementContext);
+
+    measurementCheckpoint.isSnapshotPending = true;
 }
 
 // Callbacks
 
-void onMeasurementTick(unsigned int pulseCount)
+// Pulse time within the current tick: without pulse delays, pulses are
+// quantized to the start of the tick
+unsigned int getPulseTickOffset(const unsigned short *pulseDelays, unsigned int index)
+{
+    if (!pulseDelays)
+        return 0;
+
+    unsigned int pulseDelay = pulseDelays[index];
+
+    return (pulseDelay < PULSE_TIME_PER_TICK) ? (PULSE_TIME_PER_TICK - pulseDelay) : 0;
+}
+
+void onMeasurementContextTick(MeasurementContext *context,
+                              unsigned int pulseCount, const unsigned short *pulseDelays)
 {
+    InstantaneousRate *instantaneousRate = &context->instantaneousRate;
+    AverageRate *averageRate = &context->averageRate;
+    Dose *dose = &context->dose;
+
     if (pulseCount)
     {
+        unsigned int firstPulseOffset = getPulseTickOffset(pulseDelays, 0);
+        unsigned int lastPulseOffset = getPulseTickOffset(pulseDelays, pulseCount - 1);
+
         // Instantaneous rate
-        if (!instantaneousRate.current.pulseCount)
-            instantaneousRate.current.firstPulseTick = instantaneousRate.tick;
-        addClamped(&instantaneousRate.current.pulseCount, pulseCount);
-
-        instantaneousRate.pulseTicksCount =
-            instantaneousRate.pulseTicksCount + pulseCount;
-        if (instantaneousRate.pulseTicksCount > INSTANTANEOUS_RATE_PULSE_NUM)
-            instantaneousRate.pulseTicksCount = INSTANTANEOUS_RATE_PULSE_NUM;
+        unsigned int tickTime = PULSE_TIME_PER_TICK * instantaneousRate->tick;
+
+        if (!instantaneousRate->current.pulseCount)
+            instantaneousRate->current.firstPulseTime = tickTime + firstPulseOffset;
+        addClamped(&instantaneousRate->current.pulseCount, pulseCount);
+
+        instantaneousRate->pulseTimesCount =
+            instantaneousRate->pulseTimesCount + pulseCount;
+        if (instantaneousRate->pulseTimesCount > INSTANTANEOUS_RATE_PULSE_NUM)
+            instantaneousRate->pulseTimesCount = INSTANTANEOUS_RATE_PULSE_NUM;
         for (unsigned int i = 0; i < pulseCount; i++)
         {
-            instantaneousRate.pulseTicks[instantaneousRate.pulseTicksIndex] =
-                instantaneousRate.tick;
-            instantaneousRate.pulseTicksIndex =
-                (instantaneousRate.pulseTicksIndex + 1) % INSTANTANEOUS_RATE_PULSE_NUM;
+            instantaneousRate->pulseTimes[instantaneousRate->pulseTimesIndex] =
+                tickTime + getPulseTickOffset(pulseDelays, i);
+            instantaneousRate->pulseTimesIndex =
+                (instantaneousRate->pulseTimesIndex + 1) % INSTANTANEOUS_RATE_PULSE_NUM;
         }
 
-        instantaneousRate.lastPulseTick = instantaneousRate.tick;
+        instantaneousRate->lastPulseTime = tickTime + lastPulseOffset;
 
         // Average rate
-        if (averageRate.tick < ULONG_MAX)
-        {
-            if (!averageRate.pulseCount)
-                averageRate.firstPulseTick = averageRate.tick;
-            addClamped(&averageRate.pulseCount, pulseCount);
+        unsigned long long averageTickTime = PULSE_TIME_PER_TICK * averageRate->tick;
 
-            averageRate.lastPulseTick = averageRate.tick;
-        }
+        if (!averageRate->pulseCount)
+            averageRate->firstPulseTime = averageTickTime + firstPulseOffset;
+        averageRate->pulseCount += pulseCount;
+
+        averageRate->lastPulseTime = averageTickTime + lastPulseOffset;
 
         // Dose
-        if (dose.snapshotTime < TIME_MAX)
-            addClamped(&dose.pulseCount, pulseCount);
+        dose->pulseCount += pulseCount;
     }
 
-    instantaneousRate.tick++;
+    instantaneousRate->tick++;
+    averageRate->tick++;
+}
+
+// Equivalent to calling onMeasurementContextTick() for ticks without pulses
+void skipMeasurementContextTicks(MeasurementContext *context, unsigned int ticks)
+{
+    InstantaneousRate *instantaneousRate = &context->instantaneousRate;
+    AverageRate *averageRate = &context->averageRate;
 
-    if ((averageRate.tick < ULONG_MAX) && (averageRate.pulseCount < ULONG_MAX))
-        averageRate.tick++;
+    instantaneousRate->tick += ticks;
+    averageRate->tick += ticks;
 }
 
-void onMeasurementOneSecond()
+void onMeasurementContextOneSecond(MeasurementContext *context)
 {
-    unsigned int firstPulseTick;
+    InstantaneousRate *instantaneousRate = &context->instantaneousRate;
+    AverageRate *averageRate = &context->averageRate;
+    Dose *dose = &context->dose;
+
+    unsigned int firstPulseTime;
     unsigned int pulseCount;
-    unsigned int ticks;
+    unsigned int period;
 
     // Instantaneous rate
     for (unsigned int i = INSTANTANEOUS_RATE_HISTORY_STATS_NUM - 1; i > 0; i--)
-        instantaneousRate.history[i] = instantaneousRate.history[i - 1];
-    instantaneousRate.history[0] = instantaneousRate.current;
-    resetPeriodStats(&instantaneousRate.current);
+        instantaneousRate->history[i] = instantaneousRate->history[i - 1];
+    instantaneousRate->history[0] = instantaneousRate->current;
+    resetPeriodStats(&instantaneousRate->current);
 
-    firstPulseTick = 0;
+    firstPulseTime = 0;
     pulseCount = 0;
     for (unsigned int i = 0; i < INSTANTANEOUS_RATE_HISTORY_STATS_NUM; i++)
     {
-        if (instantaneousRate.history[i].pulseCount)
+        if (instantaneousRate->history[i].pulseCount)
         {
-            firstPulseTick = instantaneousRate.history[i].firstPulseTick;
-            pulseCount += instantaneousRate.history[i].pulseCount;
+            firstPulseTime = instantaneousRate->history[i].firstPulseTime;
+            pulseCount += instantaneousRate->history[i].pulseCount;
         }
     }
 
     if (pulseCount < INSTANTANEOUS_RATE_PULSE_NUM)
     {
-        unsigned int pulseTicksIndex = (INSTANTANEOUS_RATE_PULSE_NUM +
-                                        instantaneousRate.pulseTicksIndex -
-                                        instantaneousRate.pulseTicksCount) %
+        unsigned int pulseTimesIndex = (INSTANTANEOUS_RATE_PULSE_NUM +
+                                        instantaneousRate->pulseTimesIndex -
+                                        instantaneousRate->pulseTimesCount) %
                                        INSTANTANEOUS_RATE_PULSE_NUM;
-        firstPulseTick = instantaneousRate.pulseTicks[pulseTicksIndex];
-        pulseCount = instantaneousRate.pulseTicksCount;
+        firstPulseTime = instantaneousRate->pulseTimes[pulseTimesIndex];
+        pulseCount = instantaneousRate->pulseTimesCount;
     }
 
-    if (instantaneousRate.pulseTicksCount < INSTANTANEOUS_RATE_PULSE_NUM)
-        instantaneousRate.snapshotTime++;
+    if (instantaneousRate->pulseTimesCount < INSTANTANEOUS_RATE_PULSE_NUM)
+        instantaneousRate->snapshotTime++;
     else
-        instantaneousRate.snapshotTime =
-            (instantaneousRate.tick + TICK_FREQUENCY - 1 - firstPulseTick) / TICK_FREQUENCY;
-    ticks = instantaneousRate.lastPulseTick - firstPulseTick;
-    if (ticks && (pulseCount > 1))
+        instantaneousRate->snapshotTime =
+            (PULSE_TIME_PER_TICK * instantaneousRate->tick - firstPulseTime + PULSE_TIME_FREQUENCY - 1) /
+            PULSE_TIME_FREQUENCY;
+    period = instantaneousRate->lastPulseTime - firstPulseTime;
+    if (period && (pulseCount > 1))
     {
-        instantaneousRate.snapshotCount = pulseCount - 1;
-        instantaneousRate.snapshotTicks = ticks;
+        instantaneousRate->snapshotCount = pulseCount - 1;
+        instantaneousRate->snapshotPeriod = period;
     }
     else
     {
-        instantaneousRate.snapshotCount = 0;
-        instantaneousRate.snapshotTicks = 1;
+        instantaneousRate->snapshotCount = 0;
+        instantaneousRate->snapshotPeriod = 1;
     }
 
     // Average rate
-    pulseCount = averageRate.pulseCount;
-    ticks = averageRate.lastPulseTick - averageRate.firstPulseTick;
+    unsigned long long averagePulseCount = averageRate->pulseCount;
+    unsigned long long averagePeriod = averageRate->lastPulseTime - averageRate->firstPulseTime;
 
-    if ((averageRate.snapshotTime < ULONG_MAX) && (averageRate.pulseCount < ULONG_MAX))
-        averageRate.snapshotTime++;
-    if (ticks && (pulseCount > 1))
+    averageRate->snapshotTime++;
+    if (averagePeriod && (averagePulseCount > 1))
     {
-        averageRate.snapshotCount = pulseCount - 1;
-        averageRate.snapshotTicks = ticks;
+        averageRate->snapshotCount = averagePulseCount - 1;
+        averageRate->snapshotPeriod = averagePeriod;
     }
     else
     {
-        averageRate.snapshotCount = 0;
-        averageRate.snapshotTicks = 1;
+        averageRate->snapshotCount = 0;
+        averageRate->snapshotPeriod = 1;
     }
 
     // Dose
-    if ((dose.snapshotTime < TIME_MAX) && (dose.pulseCount < ULONG_MAX))
-        dose.snapshotTime++;
-    dose.snapshotValue = dose.pulseCount;
+    dose->snapshotTime++;
+    dose->snapshotValue = dose->pulseCount;
 }
 
-void updateMeasurements()
+void onMeasurementTick(unsigned int pulseCount, const unsigned short *pulseDelays)
 {
-    // Instantaneous rate
-    instantaneousRate.snapshotValue = (float)instantaneousRate.snapshotCount *
-                                      TICK_FREQUENCY / instantaneousRate.snapshotTicks;
+    onMeasurementContextTick(&measurementContext, pulseCount, pulseDelays);
+}
 
-    if ((instantaneousRate.pulseTicksCount == INSTANTANEOUS_RATE_PULSE_NUM) &&
-        (instantaneousRate.snapshotValue > instantaneousRate.snapshotMaxValue))
-        instantaneousRate.snapshotMaxValue = instantaneousRate.snapshotValue;
+void skipMeasurementTicks(unsigned int ticks)
+{
+    skipMeasurementContextTicks(&measurementContext, ticks);
+}
 
-    // Average rate
-    averageRate.snapshotValue = (float)averageRate.snapshotCount *
-                                TICK_FREQUENCY / averageRate.snapshotTicks;
+void onMeasurementOneSecond()
+{
+    onMeasurementContextOneSecond(&measurementContext);
+}
 
-    // History
-    historySampleIndex =
-        (historySampleIndex + 1) % histories[HISTORY_LAST].samplesPerDataPoint;
-    for (unsigned int i = 0; i < HISTORY_NUM; i++)
+#ifndef FIXED_POINT
+// Returns the true rate from the measured rate (cps)
+float correctDeadTime(float rate)
+{
+#if DEAD_TIME_MODEL == DEAD_TIME_PARALYZABLE
+    // Solves rate = n * exp(-n * DEAD_TIME) with Newton's method
+    float n = rate;
+    for (int i = 0; i < DEAD_TIME_ITERATIONS; i++)
     {
-        History *history = &histories[i];
-        HistoryState *historyState = &historyStates[i];
+        float deadTimeFraction = n * DEAD_TIME;
+        if (deadTimeFraction >= 1)
+            break;
 
-        historyState->sampleSum += instantaneousRate.snapshotValue;
-        historyState->sampleNum++;
+        float survivalFraction = expf(-deadTimeFraction);
+        n -= (n * survivalFraction - rate) /
+             (survivalFraction * (1 - deadTimeFraction));
+    }
 
-        if ((historySampleIndex % history->samplesPerDataPoint) == 0)
-        {
-            float average = historyState->sampleSum / historyState->sampleNum;
-            int value = (int)(HISTORY_VALUE_DECADE * log10f(average / HISTORY_CPS_MIN));
-            value = (value < 0) ? 0 : (value > UCHAR_MAX) ? UCHAR_MAX
-                                                          : value;
-            historyState->buffer[historyState->bufferIndex] = (unsigned char)value;
+    return n;
+#else
+    float liveTimeFraction = 1 - rate * DEAD_TIME;
+    if (liveTimeFraction <= 0)
+        return rate;
 
-            historyState->sampleSum = 0;
-            historyState->sampleNum = 0;
+    return rate / liveTimeFraction;
+#endif
+}
 
-            historyState->bufferIndex = (historyState->bufferIndex + 1) % HISTORY_BUFFER_SIZE;
-        }
-    }
+Rate getRate(unsigned long long count, unsigned long long period)
+{
+    return (float)count * PULSE_TIME_FREQUENCY / period;
+}
+
+int getHistoryValue(Rate average)
+{
+    return (int)(HISTORY_VALUE_DECADE * log10f(average / HISTORY_CPS_MIN));
 }
 
 bool isInstantaneousRateAlarm()
 {
+    InstantaneousRate *instantaneousRate = &measurementContext.instantaneousRate;
+
     if (!settings.rateAlarm)
         return false;
 
-    float rateSvH = units[UNITS_SIEVERTS].rate.scale * instantaneousRate.snapshotValue;
+    float rateSvH = units[UNITS_SIEVERTS].rate.scale * instantaneousRate->snapshotValue;
     return rateSvH >= getRateAlarmSvH(settings.rateAlarm);
 }
 
 bool isDoseAlarm()
 {
+    Dose *dose = &measurementContext.dose;
+
     if (!settings.doseAlarm)
         return false;
 
-    float doseSv = units[UNITS_SIEVERTS].dose.scale * dose.snapshotValue;
+    float doseSv = units[UNITS_SIEVERTS].dose.scale * dose->correctedValue;
     return doseSv >= getDoseAlarmSv(settings.doseAlarm);
 }
+#else
+#if DEAD_TIME_MODEL == DEAD_TIME_PARALYZABLE
+// Lambert W series coefficients k^(k-1) / k!
+const unsigned int deadTimeSeries[] = {
+    FIXED(1.0),
+    FIXED(1.0),
+    FIXED(9.0 / 6),
+    FIXED(64.0 / 24),
+    FIXED(625.0 / 120),
+    FIXED(7776.0 / 720),
+    FIXED(117649.0 / 5040),
+    FIXED(2097152.0 / 40320),
+    FIXED(43046721.0 / 362880),
+    FIXED(1000000000.0 / 3628800),
+};
+#endif
+
+// Returns the true rate from the measured rate (Q16.16)
+Rate correctDeadTime(Rate rate)
+{
+    // Dead time fraction (Q0.32)
+    unsigned long long deadTimeFraction = (rate * DEAD_TIME_Q32) >> FIXED_SHIFT;
+    if (deadTimeFraction >= (1ULL << 32))
+        return rate;
+
+    unsigned long long n;
+
+#if DEAD_TIME_MODEL == DEAD_TIME_PARALYZABLE
+    // Solves rate = n * exp(-n * DEAD_TIME) with the series
+    // n = rate * sum(k^(k-1) / k! * (rate * DEAD_TIME)^(k-1))
+    unsigned int i = sizeof(deadTimeSeries) / sizeof(deadTimeSeries[0]) - 1;
+    unsigned long long sum = deadTimeSeries[i];
+    while (i--)
+        sum = deadTimeSeries[i] + ((sum * deadTimeFraction) >> 32);
+
+    n = (rate * sum) >> FIXED_SHIFT;
+#else
+    n = ((unsigned long long)rate << 32) / ((1ULL << 32) - deadTimeFraction);
+#endif
+
+    return (n > UINT_MAX) ? UINT_MAX : (Rate)n;
+}
+
+// Returns count / period (Q16.16), saturated
+Rate getRate(unsigned long long count, unsigned long long period)
+{
+    unsigned long long value = count * PULSE_TIME_FREQUENCY;
+    unsigned long long integer = value / period;
+    if (integer >> (32 - FIXED_SHIFT))
+        return UINT_MAX;
+
+    unsigned long long fraction = ((value % period) << FIXED_SHIFT) / period;
+
+    return (Rate)((integer << FIXED_SHIFT) + fraction);
+}
+
+// Returns HISTORY_VALUE_DECADE * log10(value / 2^shift * 10^exponent), truncated
+int getFixedHistoryValue(unsigned long long value, int shift, int exponent)
+{
+    // log10(2) (Q16.16)
+    const long long log10Of2 = FIXED(0.30103);
+
+    if (!value)
+        return INT_MIN;
+
+    long long log2Value = getFixedLog2(value) - (shift << FIXED_SHIFT);
+
+    return (int)((log2Value * HISTORY_VALUE_DECADE * log10Of2 +
+                  ((long long)exponent * HISTORY_VALUE_DECADE << 32)) /
+                 (1LL << 32));
+}
+
+int getHistoryValue(Rate average)
+{
+    return getFixedHistoryValue(average, FIXED_SHIFT, -HISTORY_CPS_MIN_EXPONENT);
+}
+
+bool isInstantaneousRateAlarm()
+{
+    InstantaneousRate *instantaneousRate = &measurementContext.instantaneousRate;
+
+    if (!settings.rateAlarm)
+        return false;
+
+    return instantaneousRate->snapshotValue >= getRateAlarmRate(settings.rateAlarm);
+}
+
+bool isDoseAlarm()
+{
+    Dose *dose = &measurementContext.dose;
+
+    if (!settings.doseAlarm)
+        return false;
+
+    return dose->correctedValue >= getDoseAlarmCount(settings.doseAlarm);
+}
+#endif
+
+unsigned char getHistoryDataPointValue(Rate rate)
+{
+    int value = getHistoryValue(rate);
+
+    return (value < 0) ? 0 : (value > UCHAR_MAX) ? UCHAR_MAX
+                                                 : value;
+}
+
+// Each completed data point is passed on to the next history, so
+// the amortized cost is O(1) per second
+void updateHistoryContext(MeasurementContext *context, Rate rate)
+{
+    HistoryState *historyStates = context->historyStates;
+
+    Rate mean = rate;
+    Rate min = rate;
+    Rate max = rate;
+
+    for (unsigned int i = 0; i < HISTORY_NUM; i++)
+    {
+        History *history = &histories[i];
+        HistoryState *historyState = &historyStates[i];
+
+        if (!historyState->sampleNum || (min < historyState->sampleMin))
+            historyState->sampleMin = min;
+        if (!historyState->sampleNum || (max > historyState->sampleMax))
+            historyState->sampleMax = max;
+        historyState->sampleSum += mean;
+        historyState->sampleNum++;
+
+        if (historyState->sampleNum < history->decimationFactor)
+            break;
+
+        mean = historyState->sampleSum / historyState->sampleNum;
+        min = historyState->sampleMin;
+        max = historyState->sampleMax;
+
+        HistoryDataPoint *dataPoint = &historyState->buffer[historyState->bufferIndex];
+        dataPoint->mean = getHistoryDataPointValue(mean);
+        dataPoint->min = (min == mean) ? dataPoint->mean : getHistoryDataPointValue(min);
+        dataPoint->max = (max == mean) ? dataPoint->mean : getHistoryDataPointValue(max);
+
+        historyState->sampleSum = 0;
+        historyState->sampleNum = 0;
+
+        historyState->bufferIndex = (historyState->bufferIndex + 1) % HISTORY_BUFFER_SIZE;
+    }
+}
+
+void updateMeasurementContext(MeasurementContext *context)
+{
+    InstantaneousRate *instantaneousRate = &context->instantaneousRate;
+    AverageRate *averageRate = &context->averageRate;
+    Dose *dose = &context->dose;
+
+    // Instantaneous rate
+    Rate rate = getRate(instantaneousRate->snapshotCount,
+                        instantaneousRate->snapshotPeriod);
+    instantaneousRate->isOverload = (rate >= OVERLOAD_RATE);
+    instantaneousRate->snapshotValue = correctDeadTime(rate);
+
+    if ((instantaneousRate->pulseTimesCount == INSTANTANEOUS_RATE_PULSE_NUM) &&
+        (instantaneousRate->snapshotValue > instantaneousRate->snapshotMaxValue))
+        instantaneousRate->snapshotMaxValue = instantaneousRate->snapshotValue;
+
+    // Average rate
+    rate = getRate(averageRate->snapshotCount,
+                   averageRate->snapshotPeriod);
+    averageRate->isOverload = (rate >= OVERLOAD_RATE);
+    averageRate->snapshotValue = correctDeadTime(rate);
+
+    // Dose
+    unsigned int doseTime = dose->snapshotTime - dose->lastSnapshotTime;
+    if (doseTime)
+    {
+        rate = getRate(dose->snapshotValue - dose->lastSnapshotValue,
+                       (unsigned long long)PULSE_TIME_FREQUENCY * doseTime);
+#ifdef FIXED_POINT
+        dose->deadTimeValue += (unsigned long long)(correctDeadTime(rate) - rate) * doseTime;
+#else
+        dose->deadTimeValue += (correctDeadTime(rate) - rate) * doseTime;
+#endif
+
+        dose->lastSnapshotTime = dose->snapshotTime;
+        dose->lastSnapshotValue = dose->snapshotValue;
+    }
+#ifdef FIXED_POINT
+    dose->correctedValue = dose->snapshotValue + (dose->deadTimeValue >> FIXED_SHIFT);
+#else
+    dose->correctedValue = dose->snapshotValue + (unsigned long long)dose->deadTimeValue;
+#endif
+
+    // History
+    updateHistoryContext(context, instantaneousRate->snapshotValue);
+}
+
+void updateMeasurements()
+{
+    updateMeasurementContext(&measurementContext);
+
+    // Checkpoint
+    unsigned long long dosePulseCount = measurementContext.dose.pulseCount;
+    unsigned int statePulseCount = (unsigned int)dosePulseCount -
+                                   measurementCheckpoint.statePulseCount;
+
+    measurementCheckpoint.historyTime++;
+    measurementCheckpoint.stateTime++;
+
+    bool isStateWritten =
+        (measurementCheckpoint.stateTime >= CHECKPOINT_STATE_PERIOD) ||
+        ((measurementCheckpoint.stateTime >= CHECKPOINT_STATE_PERIOD_MIN) &&
+         (statePulseCount >= CHECKPOINT_STATE_PULSES_MIN) &&
+         (statePulseCount >= (dosePulseCount >> CHECKPOINT_STATE_PULSES_SHIFT)));
+
+    if (measurementCheckpoint.isSnapshotPending ||
+        (measurementCheckpoint.historyTime >= CHECKPOINT_HISTORY_PERIOD) ||
+        isStateWritten)
+        writeMeasurementCheckpoint(isStateWritten);
+}
+
+// Checkpoints
+
+void writeMeasurementState()
+{
+    HistoryState *historyStates = measurementContext.historyStates;
+
+    writeCheckpointData(&measurementContext.averageRate, sizeof(AverageRate));
+    writeCheckpointData(&measurementContext.dose, sizeof(Dose));
+    for (unsigned int i = CHECKPOINT_HISTORY_FIRST; i < HISTORY_NUM; i++)
+        writeCheckpointData(&historyStates[i], offsetof(HistoryState, buffer));
+}
+
+void readMeasurementState()
+{
+    HistoryState *historyStates = measurementContext.historyStates;
+
+    readCheckpointData(&measurementContext.averageRate, sizeof(AverageRate));
+    readCheckpointData(&measurementContext.dose, sizeof(Dose));
+    for (unsigned int i = CHECKPOINT_HISTORY_FIRST; i < HISTORY_NUM; i++)
+        readCheckpointData(&historyStates[i], offsetof(HistoryState, buffer));
+}
+
+void setMeasurementCheckpointDone()
+{
+    HistoryState *historyStates = measurementContext.historyStates;
+
+    measurementCheckpoint.isSnapshotPending = false;
+    measurementCheckpoint.historyTime = 0;
+    measurementCheckpoint.stateTime = 0;
+    measurementCheckpoint.statePulseCount = (unsigned int)measurementContext.dose.pulseCount;
+    for (unsigned int i = CHECKPOINT_HISTORY_FIRST; i < HISTORY_NUM; i++)
+        measurementCheckpoint.bufferIndex[i] = historyStates[i].bufferIndex;
+}
+
+void writeMeasurementSnapshot()
+{
+    HistoryState *historyStates = measurementContext.historyStates;
+
+    // A failed snapshot leaves the bank full, so it is written again at the
+    // next checkpoint
+    if (startCheckpointSnapshot(CHECKPOINT_SNAPSHOT, 0, CHECKPOINT_SNAPSHOT_SIZE))
+    {
+        writeMeasurementState();
+        for (unsigned int i = CHECKPOINT_HISTORY_FIRST; i < HISTORY_NUM; i++)
+            writeCheckpointData(historyStates[i].buffer, sizeof(historyStates[i].buffer));
+
+        endCheckpointRecord();
+    }
+
+    setMeasurementCheckpointDone();
+}
 
-unsigned char getHistoryDataPoint(int dataIndex)
+// Writes the history data points completed since the last checkpoint, one
+// record per run of the ring buffer, and, optionally, the accumulators. A
+// new snapshot is written when the checkpoint bank is full or a record
+// could not be programmed.
+void writeMeasurementCheckpoint(bool isStateWritten)
 {
+    HistoryState *historyStates = measurementContext.historyStates;
+
+    bool isWritten = !measurementCheckpoint.isSnapshotPending;
+
+    for (unsigned int i = CHECKPOINT_HISTORY_FIRST; isWritten && (i < HISTORY_NUM); i++)
+    {
+        HistoryState *historyState = &historyStates[i];
+        unsigned char *bufferIndex = &measurementCheckpoint.bufferIndex[i];
+
+        while (isWritten && (*bufferIndex != historyState->bufferIndex))
+        {
+            unsigned int endIndex = (historyState->bufferIndex > *bufferIndex)
+                                        ? historyState->bufferIndex
+                                        : HISTORY_BUFFER_SIZE;
+            unsigned int size = (endIndex - *bufferIndex) * sizeof(HistoryDataPoint);
+
+            isWritten = startCheckpointRecord(CHECKPOINT_HISTORY_DATA_POINTS,
+                                              HISTORY_BUFFER_SIZE * i + *bufferIndex,
+                                              size);
+            if (isWritten)
+            {
+                writeCheckpointData(&historyState->buffer[*bufferIndex], size);
+                isWritten = endCheckpointRecord();
+            }
+            if (isWritten)
+                *bufferIndex = endIndex % HISTORY_BUFFER_SIZE;
+        }
+    }
+
+    if (isWritten)
+        measurementCheckpoint.historyTime = 0;
+
+    if (isWritten && isStateWritten)
+    {
+        isWritten = startCheckpointRecord(CHECKPOINT_STATE, 0, CHECKPOINT_STATE_SIZE);
+        if (isWritten)
+        {
+            writeMeasurementState();
+            isWritten = endCheckpointRecord();
+        }
+        if (isWritten)
+        {
+            measurementCheckpoint.stateTime = 0;
+            measurementCheckpoint.statePulseCount = (unsigned int)measurementContext.dose.pulseCount;
+        }
+    }
+
+    if (!isWritten)
+        writeMeasurementSnapshot();
+}
+
+void readMeasurementCheckpoint()
+{
+    AverageRate *averageRate = &measurementContext.averageRate;
+    Dose *dose = &measurementContext.dose;
+    HistoryState *historyStates = measurementContext.historyStates;
+
+    unsigned int type;
+    unsigned int argument;
+    unsigned int size;
+
+    rewindCheckpoint();
+    if (!readCheckpointRecord(&type, &argument, &size) ||
+        (type != CHECKPOINT_SNAPSHOT) ||
+        (size != CHECKPOINT_SNAPSHOT_SIZE))
+        return;
+
+    readMeasurementState();
+    for (unsigned int i = CHECKPOINT_HISTORY_FIRST; i < HISTORY_NUM; i++)
+        readCheckpointData(historyStates[i].buffer, sizeof(historyStates[i].buffer));
+
+    while (readCheckpointRecord(&type, &argument, &size))
+    {
+        if ((type == CHECKPOINT_STATE) &&
+            (size == CHECKPOINT_STATE_SIZE))
+            readMeasurementState();
+        else if ((type == CHECKPOINT_HISTORY_DATA_POINTS) &&
+                 size &&
+                 !(size % sizeof(HistoryDataPoint)) &&
+                 (argument >= (HISTORY_BUFFER_SIZE * CHECKPOINT_HISTORY_FIRST)) &&
+                 (argument < (HISTORY_BUFFER_SIZE * HISTORY_NUM)) &&
+                 ((argument % HISTORY_BUFFER_SIZE + size / sizeof(HistoryDataPoint)) <= HISTORY_BUFFER_SIZE))
+        {
+            HistoryState *historyState = &historyStates[argument / HISTORY_BUFFER_SIZE];
+            unsigned int bufferIndex = argument % HISTORY_BUFFER_SIZE;
+            unsigned int endIndex = bufferIndex + size / sizeof(HistoryDataPoint);
+
+            readCheckpointData(&historyState->buffer[bufferIndex], size);
+            historyState->bufferIndex = endIndex % HISTORY_BUFFER_SIZE;
+        }
+    }
+
+    averageRate->isHold = false;
+    dose->isHold = false;
+
+    setMeasurementCheckpointDone();
+}
+
+HistoryDataPoint getHistoryDataPoint(int dataIndex)
+{
+    HistoryState *historyStates = measurementContext.historyStates;
+
     HistoryState *historyState = &historyStates[settings.history];
 
     int bufferIndex =
@@ -383,139 +840,186 @@ const char *getHistoryName(int historyIndex)
 
 // UI
 
+// The measurement views redraw a region only when its inputs change
+
 void drawTitleWithTime(const char *title, unsigned int time)
 {
-    char timeString[16];
-    formatTime(time, timeString);
+    unsigned int hash = hashDisplayInput(DISPLAY_REGION_HASH_INIT, &title, sizeof(title));
+    hash = hashDisplayInput(hash, &time, sizeof(time));
+    if (!beginDisplayRegion(DISPLAY_REGION_TITLE, hash))
+        return;
 
     char titleString[32];
-    sprintf(titleString, "%s (%s)", title, timeString);
+    char *buffer = formatString(title, titleString);
+    buffer = formatString(" (", buffer);
+    buffer = formatTime(time, buffer);
+    formatChar(')', buffer);
 
     drawTitle(titleString);
 }
 
-void drawRate(float rate, unsigned int rateCount)
+// The value region is hashed once formatted, as the count changes far
+// more often than the displayed confidence intervals
+void drawRate(Rate rate, unsigned long long rateCount)
 {
     char mantissa[32];
     char characteristic[32];
     formatRate(rate, mantissa, characteristic);
 
+    bool isConfidenceIntervals = (rate > 0) && (rateCount > 0);
+    int lowerConfidenceInterval = 0;
+    int upperConfidenceInterval = 0;
+    if (isConfidenceIntervals)
+        getConfidenceIntervals((rateCount > INT_MAX) ? INT_MAX : (int)rateCount,
+                               &lowerConfidenceInterval, &upperConfidenceInterval);
+
+    unsigned int hash = hashDisplayInput(DISPLAY_REGION_HASH_INIT, mantissa, strlen(mantissa));
+    hash = hashDisplayInput(hash, characteristic, strlen(characteristic));
+    hash = hashDisplayInput(hash, &isConfidenceIntervals, sizeof(isConfidenceIntervals));
+    hash = hashDisplayInput(hash, &lowerConfidenceInterval, sizeof(lowerConfidenceInterval));
+    hash = hashDisplayInput(hash, &upperConfidenceInterval, sizeof(upperConfidenceInterval));
+    if (!beginDisplayRegion(DISPLAY_REGION_VALUE, hash))
+        return;
+
     drawMeasurementValue(mantissa, characteristic);
 
-    if (rate > 0)
-        drawConfidenceIntervals(rateCount);
+    if (isConfidenceIntervals)
+        drawConfidenceIntervals(lowerConfidenceInterval, upperConfidenceInterval);
 }
 
-void drawDose(unsigned int dose)
+void drawDose(unsigned long long dose)
 {
     char mantissa[32];
     char characteristic[32];
     formatDose(dose, mantissa, characteristic);
 
+    unsigned int hash = hashDisplayInput(DISPLAY_REGION_HASH_INIT, mantissa, strlen(mantissa));
+    hash = hashDisplayInput(hash, characteristic, strlen(characteristic));
+    if (!beginDisplayRegion(DISPLAY_REGION_VALUE, hash))
+        return;
+
     drawMeasurementValue(mantissa, characteristic);
 }
 
-void drawRateMax(float rateMax)
+// Draws a fixed subtitle, or the maximum rate if subtitle is NULL
+void drawMeasurementSubtitle(const char *subtitle, Rate rateMax)
 {
-    char mantissa[16];
-    char characteristic[16];
-    formatRate(rateMax, mantissa, characteristic);
+    unsigned int hash = hashDisplayInput(DISPLAY_REGION_HASH_INIT, &subtitle, sizeof(subtitle));
+    hash = hashDisplayInput(hash, &rateMax, sizeof(rateMax));
+    if (!beginDisplayRegion(DISPLAY_REGION_SUBTITLE, hash))
+        return;
+
+    if (subtitle)
+        drawSubtitle(subtitle);
+    else if (rateMax > 0)
+    {
+        char mantissa[16];
+        char characteristic[16];
+        formatRate(rateMax, mantissa, characteristic);
 
-    char subtitleString[48];
-    sprintf(subtitleString, "Max: %s %s", mantissa, characteristic);
+        char subtitleString[48];
+        char *buffer = formatString("Max: ", subtitleString);
+        buffer = formatString(mantissa, buffer);
+        buffer = formatChar(' ', buffer);
+        formatString(characteristic, buffer);
 
-    drawSubtitle(subtitleString);
+        drawSubtitle(subtitleString);
+    }
 }
 
 void drawInstantaneousRateView()
 {
+    InstantaneousRate *instantaneousRate = &measurementContext.instantaneousRate;
+
     unsigned int time;
     unsigned int count;
-    float value;
+    Rate value;
 
-    if (!instantaneousRate.isHold)
+    if (!instantaneousRate->isHold)
     {
-        time = instantaneousRate.snapshotTime;
-        count = instantaneousRate.snapshotCount;
-        value = instantaneousRate.snapshotValue;
+        time = instantaneousRate->snapshotTime;
+        count = instantaneousRate->snapshotCount;
+        value = instantaneousRate->snapshotValue;
     }
     else
     {
-        time = instantaneousRate.holdTime;
-        count = instantaneousRate.holdCount;
-        value = instantaneousRate.holdValue;
+        time = instantaneousRate->holdTime;
+        count = instantaneousRate->holdCount;
+        value = instantaneousRate->holdValue;
     }
 
     drawTitleWithTime("Instantaneous", time);
     drawRate(value, count);
 
-    if (instantaneousRate.isHold)
-        drawSubtitle("HOLD");
-    else if (instantaneousRate.snapshotValue >= OVERLOAD_RATE)
-        drawSubtitle("OVERLOAD");
+    if (instantaneousRate->isHold)
+        drawMeasurementSubtitle("HOLD", 0);
+    else if (instantaneousRate->isOverload)
+        drawMeasurementSubtitle("OVERLOAD", 0);
     else if (isInstantaneousRateAlarm())
-        drawSubtitle("RATE ALARM");
-    else if (instantaneousRate.snapshotMaxValue > 0)
-        drawRateMax(instantaneousRate.snapshotMaxValue);
+        drawMeasurementSubtitle("RATE ALARM", 0);
+    else
+        drawMeasurementSubtitle(NULL, instantaneousRate->snapshotMaxValue);
 }
 
 void drawAverageRateView()
 {
+    AverageRate *averageRate = &measurementContext.averageRate;
+
     unsigned int time;
-    unsigned int count;
-    float value;
+    unsigned long long count;
+    Rate value;
 
-    if (!averageRate.isHold)
+    if (!averageRate->isHold)
     {
-        time = averageRate.snapshotTime;
-        count = averageRate.snapshotCount;
-        value = averageRate.snapshotValue;
+        time = averageRate->snapshotTime;
+        count = averageRate->snapshotCount;
+        value = averageRate->snapshotValue;
     }
     else
     {
-        time = averageRate.holdTime;
-        count = averageRate.holdCount;
-        value = averageRate.holdValue;
+        time = averageRate->holdTime;
+        count = averageRate->holdCount;
+        value = averageRate->holdValue;
     }
 
     drawTitleWithTime("Average", time);
     drawRate(value, count);
 
-    if (averageRate.isHold)
-        drawSubtitle("HOLD");
-    else if ((averageRate.snapshotTime >= TIME_MAX) ||
-             (averageRate.snapshotCount >= (ULONG_MAX - 1)))
-        drawSubtitle("OVERFLOW");
-    else if (averageRate.snapshotValue >= OVERLOAD_RATE)
-        drawSubtitle("OVERLOAD");
+    if (averageRate->isHold)
+        drawMeasurementSubtitle("HOLD", 0);
+    else if (averageRate->isOverload)
+        drawMeasurementSubtitle("OVERLOAD", 0);
+    else
+        drawMeasurementSubtitle(NULL, 0);
 }
 
 void drawDoseView()
 {
+    Dose *dose = &measurementContext.dose;
+
     unsigned int time;
-    unsigned int value;
+    unsigned long long value;
 
-    if (!dose.isHold)
+    if (!dose->isHold)
     {
-        time = dose.snapshotTime;
-        value = dose.snapshotValue;
+        time = dose->snapshotTime;
+        value = dose->correctedValue;
     }
     else
     {
-        time = dose.holdTime;
-        value = dose.holdValue;
+        time = dose->holdTime;
+        value = dose->holdValue;
     }
 
     drawTitleWithTime("Dose", time);
     drawDose(value);
 
-    if (dose.isHold)
-        drawSubtitle("HOLD");
-    else if ((dose.snapshotTime >= ULONG_MAX) ||
-             dose.snapshotValue >= ULONG_MAX)
-        drawSubtitle("OVERFLOW");
+    if (dose->isHold)
+        drawMeasurementSubtitle("HOLD", 0);
     else if (isDoseAlarm())
-        drawSubtitle("DOSE ALARM");
+        drawMeasurementSubtitle("DOSE ALARM", 0);
+    else
+        drawMeasurementSubtitle(NULL, 0);
 }
 
 void drawHistoryView()
@@ -535,19 +1039,26 @@ void drawHistoryView()
 
     for (int i = 0; i < HISTORY_BUFFER_SIZE; i++)
     {
-        int value = getHistoryDataPoint(i);
-        if (value > 0)
+        HistoryDataPoint dataPoint = getHistoryDataPoint(i);
+        if (dataPoint.mean > 0)
         {
+            int value = (dataPoint.min > 0) ? dataPoint.min : dataPoint.mean;
             if (value < valueMin)
                 valueMin = value;
-            if (value > valueMax)
-                valueMax = value;
+            if (dataPoint.max > valueMax)
+                valueMax = dataPoint.max;
         }
     }
 
     if (valueMax > 0)
     {
+#ifdef FIXED_POINT
+        int unitScaleValue = getFixedHistoryValue(unit->scaleMantissa,
+                                                  UNIT_SCALE_SHIFT,
+                                                  unit->scaleExponent + HISTORY_CPS_MIN_EXPONENT);
+#else
         int unitScaleValue = (int)(HISTORY_VALUE_DECADE * log10f(unit->scale * HISTORY_CPS_MIN));
+#endif
 
         int exponentMin = divideDown(valueMin + unitScaleValue, HISTORY_VALUE_DECADE);
         int exponentMax = divideDown(valueMax + unitScaleValue, HISTORY_VALUE_DECADE) + 1;
@@ -555,8 +1066,8 @@ void drawHistoryView()
         offset = unitScaleValue - exponentMin * HISTORY_VALUE_DECADE;
         range = exponentMax - exponentMin;
 
-        formatMultiplier(unit->name, exponentMin, unit->minExponent, labelMin);
-        formatMultiplier(unit->name, exponentMax, unit->minExponent, labelMax);
+        formatMultiplier(unit->name, exponentMin, labelMin);
+        formatMultiplier(unit->name, exponentMax, labelMax);
     }
 
     drawTitle(getHistoryName(settings.history));
@@ -566,6 +1077,10 @@ void drawHistoryView()
 
 void onMeasurementViewKey(int key)
 {
+    InstantaneousRate *instantaneousRate = &measurementContext.instantaneousRate;
+    AverageRate *averageRate = &measurementContext.averageRate;
+    Dose *dose = &measurementContext.dose;
+
     switch (key)
     {
     case KEY_UP:
@@ -590,31 +1105,31 @@ void onMeasurementViewKey(int key)
         switch (getView())
         {
         case VIEW_INSTANTANEOUS_RATE:
-            instantaneousRate.isHold = !instantaneousRate.isHold;
-            if (instantaneousRate.isHold)
+            instantaneousRate->isHold = !instantaneousRate->isHold;
+            if (instantaneousRate->isHold)
             {
-                instantaneousRate.holdTime = instantaneousRate.snapshotTime;
-                instantaneousRate.holdCount = instantaneousRate.snapshotCount;
-                instantaneousRate.holdValue = instantaneousRate.snapshotValue;
+                instantaneousRate->holdTime = instantaneousRate->snapshotTime;
+                instantaneousRate->holdCount = instantaneousRate->snapshotCount;
+                instantaneousRate->holdValue = instantaneousRate->snapshotValue;
             }
             break;
 
         case VIEW_AVERAGE_RATE:
-            averageRate.isHold = !averageRate.isHold;
-            if (averageRate.isHold)
+            averageRate->isHold = !averageRate->isHold;
+            if (averageRate->isHold)
             {
-                averageRate.holdTime = averageRate.snapshotTime;
-                averageRate.holdCount = averageRate.snapshotCount;
-                averageRate.holdValue = averageRate.snapshotValue;
+                averageRate->holdTime = averageRate->snapshotTime;
+                averageRate->holdCount = averageRate->snapshotCount;
+                averageRate->holdValue = averageRate->snapshotValue;
             }
             break;
 
         case VIEW_DOSE:
-            dose.isHold = !dose.isHold;
-            if (dose.isHold)
+            dose->isHold = !dose->isHold;
+            if (dose->isHold)
             {
-                dose.holdTime = dose.snapshotTime;
-                dose.holdValue = dose.snapshotValue;
+                dose->holdTime = dose->snapshotTime;
+                dose->holdValue = dose->correctedValue;
             }
             break;
         }
@@ -12,17 +12,161 @@
 
 #include <stdbool.h>
 
+#include "cmath.h"
 #include "events.h"
+#include "settings.h"
 
-// M4011 tube:
-// #define CPM_PER_USVH 153.8F
-// HH614 tube:
+// Tube:
+// #define TUBE_M4011
+#define TUBE_HH614
+
+// Dead time models:
+#define DEAD_TIME_NON_PARALYZABLE 0
+#define DEAD_TIME_PARALYZABLE 1
+
+// Tube parameters:
+// Tube     CPM_PER_USVH    DEAD_TIME   DEAD_TIME_MODEL
+// HH614    60.0            15 us       non-paralyzable (docs/tubes/HH614.md)
+// M4011    153.8           90 us       non-paralyzable (typical, not in datasheet)
+#if defined(TUBE_M4011)
+#define CPM_PER_USVH 153.8F
+#define DEAD_TIME 90E-6F
+#define DEAD_TIME_MODEL DEAD_TIME_NON_PARALYZABLE
+#else
 #define CPM_PER_USVH 60.0F
+#define DEAD_TIME 15E-6F
+#define DEAD_TIME_MODEL DEAD_TIME_NON_PARALYZABLE
+#endif
 
 #define HISTORY_BUFFER_SIZE 120
 #define HISTORY_CPS_MIN 0.01F
+#define HISTORY_CPS_MIN_EXPONENT -2
 #define HISTORY_VALUE_DECADE 40
 
+// Log-compressed rates of a history bucket
+typedef struct
+{
+    unsigned char mean;
+    unsigned char min;
+    unsigned char max;
+} HistoryDataPoint;
+
+#define INSTANTANEOUS_RATE_HISTORY_STATS_NUM 5
+#define INSTANTANEOUS_RATE_PULSE_NUM (10 + 1)
+
+typedef struct
+{
+    unsigned int firstPulseTime;
+    unsigned int pulseCount;
+} PeriodStats;
+
+typedef struct
+{
+    unsigned int tick;
+    unsigned int lastPulseTime;
+
+    PeriodStats current;
+    PeriodStats history[INSTANTANEOUS_RATE_HISTORY_STATS_NUM];
+
+    unsigned int pulseTimesCount;
+    unsigned int pulseTimesIndex;
+    unsigned int pulseTimes[INSTANTANEOUS_RATE_PULSE_NUM];
+
+    unsigned int snapshotTime;
+    unsigned int snapshotCount;
+    unsigned int snapshotPeriod;
+    Rate snapshotValue;
+    Rate snapshotMaxValue;
+    bool isOverload;
+
+    bool isHold;
+    unsigned int holdTime;
+    unsigned int holdCount;
+    Rate holdValue;
+} InstantaneousRate;
+
+// Average rate and dose counters are 64-bit and times are in seconds
+// (32-bit), so they do not overflow for decades
+
+typedef struct
+{
+    unsigned long long tick;
+    unsigned long long lastPulseTime;
+    unsigned long long firstPulseTime;
+    unsigned long long pulseCount;
+
+    unsigned int snapshotTime;
+    unsigned long long snapshotCount;
+    unsigned long long snapshotPeriod;
+    Rate snapshotValue;
+    bool isOverload;
+
+    bool isHold;
+    unsigned int holdTime;
+    unsigned long long holdCount;
+    Rate holdValue;
+} AverageRate;
+
+typedef struct
+{
+    unsigned long long pulseCount;
+
+    unsigned int snapshotTime;
+    unsigned long long snapshotValue;
+
+    unsigned int lastSnapshotTime;
+    unsigned long long lastSnapshotValue;
+#ifdef FIXED_POINT
+    unsigned long long deadTimeValue;
+#else
+    double deadTimeValue;
+#endif
+    unsigned long long correctedValue;
+
+    bool isHold;
+    unsigned int holdTime;
+    unsigned long long holdValue;
+} Dose;
+
+typedef struct
+{
+#ifdef FIXED_POINT
+    unsigned long long sampleSum;
+#else
+    float sampleSum;
+#endif
+    Rate sampleMin;
+    Rate sampleMax;
+    unsigned int sampleNum;
+
+    unsigned char bufferIndex;
+    HistoryDataPoint buffer[HISTORY_BUFFER_SIZE];
+} HistoryState;
+
+// The estimators of one device. The firmware has a single context,
+// measurementContext; host tools can run any number of them
+typedef struct
+{
+    InstantaneousRate instantaneousRate;
+    AverageRate averageRate;
+    Dose dose;
+    HistoryState historyStates[HISTORY_NUM];
+} MeasurementContext;
+
+extern MeasurementContext measurementContext;
+
+void resetMeasurementContext(MeasurementContext *context);
+void resetInstantaneousRateContext(MeasurementContext *context);
+void resetAverageRateContext(MeasurementContext *context);
+void resetDoseContext(MeasurementContext *context);
+void resetHistoryContext(MeasurementContext *context);
+
+void onMeasurementContextTick(MeasurementContext *context,
+                              unsigned int pulseCount, const unsigned short *pulseDelays);
+void skipMeasurementContextTicks(MeasurementContext *context, unsigned int ticks);
+void onMeasurementContextOneSecond(MeasurementContext *context);
+void updateMeasurementContext(MeasurementContext *context);
+
 void initMeasurements();
 
 void resetInstantaneousRate();
@@ -30,14 +174,19 @@ void resetAverageRate();
 void resetDose();
 void resetHistory();
 
-void onMeasurementTick(unsigned int pulseCount);
+void onMeasurementTick(unsigned int pulseCount, const unsigned short *pulseDelays);
+void skipMeasurementTicks(unsigned int ticks);
 void onMeasurementOneSecond();
 void updateMeasurements();
 
+void readMeasurementCheckpoint();
+void writeMeasurementCheckpoint(bool isStateWritten);
+
 bool isInstantaneousRateAlarm();
 bool isDoseAlarm();
 
-unsigned char getHistoryDataPoint(int dataIndex);
+HistoryDataPoint getHistoryDataPoint(int dataIndex);
+const char *getHistoryName(int historyIndex);
 
 void drawInstantaneousRateView();
 void drawAverageRateView();
@@ -89,12 +89,15 @@ const char *getRateAlarmMenuOption(void *userdata, unsigned int index)
     if (index >= RATE_ALARM_NUM)
         return NULL;
 
+#ifdef FIXED_POINT
+    formatRateValue(getRateAlarmRate(index), menus.menuOption);
+#else
     Unit *unit = &units[settings.units].rate;
     float rate = getRateAlarmSvH(index) / units[UNITS_SIEVERTS].rate.scale;
     formatValue(unit->name,
                 unit->scale * rate,
-                unit->minExponent,
                 menus.menuOption);
+#endif
 
     return menus.menuOption;
 }
@@ -116,12 +119,15 @@ const char *getDoseAlarmMenuOption(void *userdata, unsigned int index)
     if (index >= DOSE_ALARM_NUM)
         return NULL;
 
+#ifdef FIXED_POINT
+    formatDoseValue(getDoseAlarmCount(index), menus.menuOption);
+#else
     Unit *unit = &units[settings.units].dose;
     float dose = getDoseAlarmSv(index) / units[UNITS_SIEVERTS].dose.scale;
     formatValue(unit->name,
                 unit->scale * dose,
-                unit->minExponent,
                 menus.menuOption);
+#endif
 
     return menus.menuOption;
 }
@@ -183,6 +189,23 @@ Menu batteryTypeMenu = {
     &batteryTypeMenuState,
 };
 
+const char *const confidenceLevelMenuOptions[] = {
+    "68%",
+    "90%",
+    "95%",
+    "99%",
+    NULL,
+};
+
+MenuState confidenceLevelMenuState;
+
+Menu confidenceLevelMenu = {
+    "Confidence",
+    getMenuOption,
+    confidenceLevelMenuOptions,
+    &confidenceLevelMenuState,
+};
+
 const char *const gameStartMenuOptions[] = {
     "Play white",
     "Play black",
@@ -244,6 +267,7 @@ const char *const settingsMenuOptions[] = {
     "Pulse clicks",
     "Backlight",
     "Battery type",
+    "Confidence",
     "Statistics",
     "Game",
     NULL,
@@ -284,6 +308,7 @@ void initMenus()
     selectMenuIndex(&pulseSoundMenu, settings.pulseSound);
     selectMenuIndex(&backlightMenu, settings.backlight);
     selectMenuIndex(&batteryTypeMenu, settings.batteryType);
+    selectMenuIndex(&confidenceLevelMenu, getConfidenceLevel());
 
     selectMenuIndex(&gameStartMenu, 0);
     selectMenuIndex(&gameContinueMenu, 0);
@@ -365,7 +390,11 @@ void updateMenuOption()
         settings.batteryType = menus.currentMenu->state->selectedIndex;
         break;
 
-    case 8:
+    case 7:
+        setConfidenceLevel(menus.currentMenu->state->selectedIndex);
+        break;
+
+    case 9:
         settings.gameSkillLevel = menus.currentMenu->state->selectedIndex;
         break;
     }
@@ -439,10 +468,14 @@ void onMenuViewKey(int key)
                 break;
 
             case 7:
-                setView(VIEW_STATS);
+                setMenu(&confidenceLevelMenu);
                 break;
 
             case 8:
+                setView(VIEW_STATS);
+                break;
+
+            case 9:
                 openGameMenu();
                 break;
             }
@@ -20,6 +20,7 @@ extern IWDG_HandleTypeDef hiwdg;
 #endif
 
 #include "backlight.h"
+#include "cmath.h"
 #include "display.h"
 #include "power.h"
 #include "settings.h"
@@ -46,7 +47,12 @@ extern IWDG_HandleTypeDef hiwdg;
 
 struct Power
 {
+#ifdef FIXED_POINT
+    // Q16.16
+    unsigned int batteryValue;
+#else
     float batteryValue;
+#endif
 } power;
 
 void setPower(bool value)
@@ -54,7 +60,7 @@ void setPower(bool value)
 #ifndef SDL_MODE
     HAL_GPIO_WritePin(PWR_EN_GPIO_Port, PWR_EN_Pin, value);
 #else
-    printf("Set power: %d\n", value);
+    fprintf(stderr, "Set power: %d\n", value);
 #endif
 }
 
@@ -66,11 +72,11 @@ void setHighVoltageGenerator(bool value)
     else
         HAL_TIM_PWM_Stop(&htim3, TIM_CHANNEL_1);
 #else
-    printf("Set high voltage generator: %d\n", value);
+    fprintf(stderr, "Set high voltage generator: %d\n", value);
 #endif
 }
 
-float getBatteryValue()
+unsigned int getBatteryValue()
 {
 #ifndef SDL_MODE
     HAL_ADC_Start(&hadc);
@@ -91,14 +97,24 @@ void initPower()
     HAL_ADCEx_Calibration_Start(&hadc);
 #endif
 
+#ifdef FIXED_POINT
+    unsigned int batteryValue = 0;
+#else
     float batteryValue = 0;
+#endif
     for (int i = 0; i < 100; i++)
     {
         batteryValue += getBatteryValue();
+#ifndef SDL_MODE
         HAL_Delay(1);
+#endif
     }
 
+#ifdef FIXED_POINT
+    power.batteryValue = (batteryValue << FIXED_SHIFT) / 100;
+#else
     power.batteryValue = batteryValue / 100.0F;
+#endif
 }
 
 void waitForInterrupt()
@@ -141,8 +157,15 @@ void powerDown(int ms)
 
 void updateBattery()
 {
+#ifdef FIXED_POINT
+    power.batteryValue = (FIXED(BATTERY_FILTER_CONSTANT) * (unsigned long long)power.batteryValue +
+                          (FIXED_ONE - FIXED(BATTERY_FILTER_CONSTANT)) *
+                              ((unsigned long long)getBatteryValue() << FIXED_SHIFT)) >>
+                         FIXED_SHIFT;
+#else
     power.batteryValue = (BATTERY_FILTER_CONSTANT * power.batteryValue +
                           (1.0F - BATTERY_FILTER_CONSTANT) * getBatteryValue());
+#endif
 }
 
 signed char getBatteryLevel()
@@ -155,6 +178,17 @@ signed char getBatteryLevel()
     int value;
     switch (settings.batteryType)
     {
+#ifdef FIXED_POINT
+    case BATTERY_NI_MH:
+        value = BATTERY_LEVEL_MAX * ((int)power.batteryValue - (int)FIXED(BATTERY_NI_MH_VALUE_MIN)) /
+                (int)FIXED(BATTERY_NI_MH_VALUE_RANGE);
+        break;
+
+    case BATTERY_ALKALINE:
+        value = BATTERY_LEVEL_MAX * ((int)power.batteryValue - (int)FIXED(BATTERY_ALKALINE_VALUE_MIN)) /
+                (int)FIXED(BATTERY_ALKALINE_VALUE_RANGE);
+        break;
+#else
     case BATTERY_NI_MH:
         value = BATTERY_LEVEL_MAX * (power.batteryValue - BATTERY_NI_MH_VALUE_MIN) /
                 BATTERY_NI_MH_VALUE_RANGE;
@@ -164,6 +198,7 @@ signed char getBatteryLevel()
         value = BATTERY_LEVEL_MAX * (power.batteryValue - BATTERY_ALKALINE_VALUE_MIN) /
                 BATTERY_ALKALINE_VALUE_RANGE;
         break;
+#endif
 
     default:
         value = 0;
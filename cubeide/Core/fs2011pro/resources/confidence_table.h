@@ -0,0 +1,70 @@
+/*
+  Generated by mkconfidence.py
+  Levels: 68%, 90%, 95%, 99%, counts 1-64
+*/
+
+#define CONFIDENCE_TABLE_SIZE 64
+
+// Normal quantiles of the upper tail, Q30
+const unsigned int confidenceZ[4] = {
+    1073741824,
+    1766148134,
+    2104495304,
+    2765775655,
+};
+
+// Lower and upper intervals (%) by level and count
+const unsigned short confidenceTable[4][64][2] = {
+    {
+        {46, 479}, {39, 182}, {35, 119}, {32, 92}, {30, 76}, {28, 66},
+        {27, 58}, {26, 53}, {25, 49}, {24, 45}, {23, 42}, {22, 40},
+        {21, 38}, {21, 36}, {20, 34}, {20, 33}, {19, 32}, {19, 30},
+        {19, 29}, {18, 28}, {18, 28}, {17, 27}, {17, 26}, {17, 25},
+        {17, 25}, {16, 24}, {16, 24}, {16, 23}, {16, 23}, {15, 22},
+        {15, 22}, {15, 21}, {15, 21}, {15, 21}, {14, 20}, {14, 20},
+        {14, 20}, {14, 19}, {14, 19}, {14, 19}, {13, 18}, {13, 18},
+        {13, 18}, {13, 18}, {13, 17}, {13, 17}, {13, 17}, {13, 17},
+        {12, 17}, {12, 16}, {12, 16}, {12, 16}, {12, 16}, {12, 16},
+        {12, 16}, {12, 15}, {12, 15}, {12, 15}, {11, 15}, {11, 15},
+        {11, 15}, {11, 15}, {11, 14}, {11, 14},
+    },
+    {
+        {67, 1850}, {58, 463}, {52, 267}, {48, 193}, {45, 154}, {43, 130},
+        {41, 113}, {39, 101}, {38, 92}, {36, 84}, {35, 78}, {34, 73},
+        {33, 69}, {32, 65}, {31, 62}, {31, 59}, {30, 57}, {29, 55},
+        {29, 53}, {28, 51}, {28, 49}, {27, 48}, {27, 46}, {26, 45},
+        {26, 44}, {26, 43}, {25, 42}, {25, 41}, {24, 40}, {24, 39},
+        {24, 38}, {24, 37}, {23, 37}, {23, 36}, {23, 35}, {22, 35},
+        {22, 34}, {22, 34}, {22, 33}, {21, 32}, {21, 32}, {21, 32},
+        {21, 31}, {21, 31}, {20, 30}, {20, 30}, {20, 29}, {20, 29},
+        {20, 29}, {20, 28}, {19, 28}, {19, 28}, {19, 27}, {19, 27},
+        {19, 27}, {19, 26}, {19, 26}, {18, 26}, {18, 26}, {18, 25},
+        {18, 25}, {18, 25}, {18, 25}, {18, 24},
+    },
+    {
+        {73, 3850}, {64, 726}, {58, 385}, {54, 267}, {51, 208}, {49, 172},
+        {46, 149}, {45, 132}, {43, 119}, {41, 109}, {40, 100}, {39, 94},
+        {38, 88}, {37, 83}, {36, 79}, {35, 75}, {35, 72}, {34, 69},
+        {33, 66}, {33, 64}, {32, 62}, {31, 60}, {31, 58}, {30, 56},
+        {30, 55}, {30, 53}, {29, 52}, {29, 50}, {28, 49}, {28, 48},
+        {28, 47}, {27, 46}, {27, 45}, {27, 44}, {26, 44}, {26, 43},
+        {26, 42}, {25, 41}, {25, 41}, {25, 40}, {25, 39}, {24, 39},
+        {24, 38}, {24, 38}, {24, 37}, {24, 37}, {23, 36}, {23, 36},
+        {23, 35}, {23, 35}, {23, 34}, {22, 34}, {22, 33}, {22, 33},
+        {22, 33}, {22, 32}, {22, 32}, {21, 32}, {21, 31}, {21, 31},
+        {21, 31}, {21, 30}, {21, 30}, {21, 30},
+    },
+    {
+        {81, 19850}, {73, 1832}, {68, 788}, {64, 495}, {60, 364}, {58, 290},
+        {55, 244}, {53, 211}, {52, 187}, {50, 169}, {49, 155}, {47, 143},
+        {46, 133}, {45, 125}, {44, 118}, {43, 111}, {42, 106}, {42, 101},
+        {41, 97}, {40, 93}, {39, 90}, {39, 87}, {38, 84}, {38, 81},
+        {37, 79}, {37, 76}, {36, 74}, {36, 72}, {35, 71}, {35, 69},
+        {34, 67}, {34, 66}, {34, 64}, {33, 63}, {33, 62}, {32, 61},
+        {32, 59}, {32, 58}, {32, 57}, {31, 56}, {31, 55}, {31, 55},
+        {30, 54}, {30, 53}, {30, 52}, {30, 51}, {29, 51}, {29, 50},
+        {29, 49}, {29, 49}, {28, 48}, {28, 47}, {28, 47}, {28, 46},
+        {28, 46}, {27, 45}, {27, 45}, {27, 44}, {27, 44}, {27, 43},
+        {26, 43}, {26, 42}, {26, 42}, {26, 41},
+    },
+};
@@ -0,0 +1,86 @@
+/*
+  Generated by mkpagefont.py from font_helvR24.bdf
+  Glyphs: 45-57, baseline at row 4 of a page
+*/
+
+#define FONT_HELVR24_DIGITS_FIRST 45
+#define FONT_HELVR24_DIGITS_NUM 13
+#define FONT_HELVR24_DIGITS_BASELINE_ROW 4
+
+// Advance, x offset, width, first page from the baseline page, page number,
+// offset of the page masks, followed by the columns of each page
+const PageFontGlyph font_helvR24_digits_glyphs[13] = {
+    {18, 4, 9, -2, 2, 0},
+    {8, 2, 3, 0, 1, 20},
+    {9, 0, 9, -3, 4, 24},
+    {18, 1, 15, -3, 4, 64},
+    {18, 3, 8, -3, 4, 128},
+    {18, 1, 15, -3, 4, 164},
+    {18, 1, 15, -3, 4, 228},
+    {18, 0, 16, -3, 4, 292},
+    {18, 1, 15, -3, 4, 360},
+    {18, 1, 15, -3, 4, 424},
+    {18, 1, 15, -3, 4, 488},
+    {18, 1, 15, -3, 4, 552},
+    {18, 1, 15, -3, 4, 616},
+};
+
+const uint8_t font_helvR24_digits_data[680] = {
+    0xc0, 0x01, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0f, 0x0f, 0x0f, 0x0f,
+    0xf0, 0xff, 0xff, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0xf0,
+    0x70, 0x00, 0x00, 0x00, 0x00, 0xe0, 0xfc, 0x1f, 0x03, 0x00, 0x00, 0x80,
+    0xf0, 0x7e, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0f, 0x03, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xf0, 0xff, 0xff, 0x0f, 0x00, 0x00, 0xc0, 0xe0,
+    0xe0, 0xf0, 0x70, 0x70, 0x70, 0xf0, 0xe0, 0xe0, 0xc0, 0x00, 0x00, 0xf8,
+    0xff, 0xff, 0x07, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x07, 0xff,
+    0xff, 0xf8, 0x1f, 0xff, 0xff, 0xe0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x80, 0xe0, 0xff, 0xff, 0x1f, 0x00, 0x00, 0x03, 0x07, 0x07, 0x0f, 0x0e,
+    0x0e, 0x0e, 0x0f, 0x07, 0x07, 0x03, 0x00, 0x00, 0xf0, 0xff, 0xff, 0x0f,
+    0x00, 0x00, 0x00, 0x00, 0x80, 0xe0, 0xf0, 0xf0, 0x06, 0x06, 0x07, 0x07,
+    0x07, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x0f, 0x0f, 0x0f, 0xf0, 0xff, 0xff, 0x0f,
+    0x00, 0x80, 0xc0, 0xe0, 0xe0, 0x70, 0x70, 0x70, 0x70, 0x70, 0xe0, 0xe0,
+    0xc0, 0x80, 0x00, 0x0e, 0x0f, 0x0f, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x80, 0xc0, 0xe1, 0xff, 0x7f, 0x1e, 0x80, 0xe0, 0xf0, 0x78, 0x38, 0x1c,
+    0x0e, 0x0e, 0x07, 0x07, 0x03, 0x01, 0x00, 0x00, 0x00, 0x0f, 0x0f, 0x0f,
+    0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e,
+    0xf0, 0xff, 0xff, 0x0f, 0x00, 0x00, 0xc0, 0xe0, 0xe0, 0x70, 0x70, 0x70,
+    0x70, 0x70, 0xe0, 0xe0, 0xc0, 0x00, 0x00, 0x00, 0x0f, 0x0f, 0x0f, 0x00,
+    0x00, 0xc0, 0xc0, 0xc0, 0xc0, 0xe0, 0xff, 0x7f, 0x1f, 0x00, 0x70, 0xf0,
+    0xf0, 0x80, 0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x03, 0x87, 0xff, 0xfe,
+    0x7c, 0x00, 0x01, 0x03, 0x07, 0x07, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x07,
+    0x07, 0x03, 0x01, 0x00, 0xf0, 0xff, 0xff, 0x0f, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xc0, 0xe0, 0xf0, 0xf0, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x80, 0xe0, 0xf0, 0x7c, 0x1e, 0x0f, 0x03, 0xff, 0xff,
+    0xff, 0x00, 0x00, 0x00, 0x78, 0x7c, 0x7f, 0x77, 0x73, 0x70, 0x70, 0x70,
+    0x70, 0x70, 0xff, 0xff, 0xff, 0x70, 0x70, 0x70, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0f, 0x0f, 0x0f, 0x00, 0x00, 0x00,
+    0xf0, 0xff, 0xff, 0x0f, 0x00, 0x00, 0xf0, 0xf0, 0xf0, 0x70, 0x70, 0x70,
+    0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x00, 0x00, 0xfc, 0xff, 0xff, 0xe3,
+    0x70, 0x70, 0x70, 0x70, 0xf0, 0xe0, 0xe0, 0xc0, 0x80, 0x00, 0xe0, 0xe1,
+    0xe1, 0x81, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc3, 0xff, 0xff,
+    0x7e, 0x00, 0x03, 0x07, 0x07, 0x0f, 0x0e, 0x0e, 0x0e, 0x0e, 0x07, 0x07,
+    0x07, 0x03, 0x01, 0x00, 0xf0, 0xff, 0xff, 0x0f, 0x00, 0x00, 0x80, 0xc0,
+    0xe0, 0xe0, 0x70, 0x70, 0x70, 0x70, 0xe0, 0xe0, 0xc0, 0x00, 0x00, 0xe0,
+    0xfe, 0xff, 0x8f, 0xc1, 0xc0, 0xe0, 0xe0, 0xe0, 0xe0, 0xc0, 0xc3, 0x83,
+    0x03, 0x00, 0x1f, 0xff, 0xff, 0xc7, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x83, 0xff, 0xff, 0x7c, 0x00, 0x00, 0x03, 0x07, 0x07, 0x0e, 0x0e,
+    0x0e, 0x0e, 0x0e, 0x07, 0x07, 0x03, 0x01, 0x00, 0xf0, 0xff, 0xff, 0x0f,
+    0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x70,
+    0xf0, 0xf0, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0xe0,
+    0xf8, 0x7c, 0x1f, 0x07, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0, 0xf8,
+    0xfe, 0x3f, 0x07, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x0e, 0x0f, 0x0f, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xf0, 0xff, 0xff, 0x0f, 0x00, 0x00, 0xc0, 0xe0, 0xe0, 0x70, 0x70, 0x70,
+    0x70, 0x70, 0xe0, 0xe0, 0xc0, 0x80, 0x00, 0x00, 0x1f, 0x3f, 0x7f, 0xf0,
+    0xe0, 0xc0, 0xc0, 0xc0, 0xe0, 0xf0, 0x7f, 0x3f, 0x1f, 0x00, 0xf8, 0xfe,
+    0xff, 0x87, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x03, 0x87, 0xff, 0xfe,
+    0x78, 0x00, 0x01, 0x03, 0x07, 0x07, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x07,
+    0x07, 0x03, 0x01, 0x00, 0xf0, 0xff, 0xff, 0x0f, 0x00, 0x80, 0xc0, 0xe0,
+    0xe0, 0x70, 0x70, 0x70, 0x70, 0xf0, 0xe0, 0xe0, 0xc0, 0x80, 0x00, 0xfe,
+    0xff, 0xff, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0xc7, 0xff,
+    0xff, 0xfc, 0xc0, 0xc3, 0xc7, 0x87, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e,
+    0x87, 0xe3, 0xff, 0xff, 0x1f, 0x00, 0x01, 0x07, 0x07, 0x0f, 0x0e, 0x0e,
+    0x0e, 0x0e, 0x07, 0x07, 0x03, 0x01, 0x00, 0x00,
+};
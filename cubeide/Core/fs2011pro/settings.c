@@ -9,23 +9,71 @@
 
 #include <limits.h>
 #include <stdbool.h>
+#include <string.h>
 
 #ifndef SDL_MODE
 #include "main.h"
 #endif
 
+#include "checkpoint.h"
+#include "events.h"
 #include "measurements.h"
 #include "settings.h"
+#include "trace.h"
+
+#define SIEVERT_RATE_SCALE ((60 * 1E-6) / CPM_PER_USVH)
+#define SIEVERT_DOSE_SCALE ((60 * 1E-6 / 3600) / CPM_PER_USVH)
+
+// Decimal exponent and mantissa of a unit scale, evaluated at compile time
+#define SCALE_EXPONENT(x)                        \
+    ((x) >= 1E2F     ? 2                         \
+     : (x) >= 1E1F   ? 1                         \
+     : (x) >= 1      ? 0                         \
+     : (x) >= 1E-1F  ? -1                        \
+     : (x) >= 1E-2F  ? -2                        \
+     : (x) >= 1E-3F  ? -3                        \
+     : (x) >= 1E-4F  ? -4                        \
+     : (x) >= 1E-5F  ? -5                        \
+     : (x) >= 1E-6F  ? -6                        \
+     : (x) >= 1E-7F  ? -7                        \
+     : (x) >= 1E-8F  ? -8                        \
+     : (x) >= 1E-9F  ? -9                        \
+     : (x) >= 1E-10F ? -10                       \
+                     : -11)
+#define SCALE_POWER_OF_TEN(x)                    \
+    ((x) >= 1E2F     ? 1E2                       \
+     : (x) >= 1E1F   ? 1E1                       \
+     : (x) >= 1      ? 1                         \
+     : (x) >= 1E-1F  ? 1E-1                      \
+     : (x) >= 1E-2F  ? 1E-2                      \
+     : (x) >= 1E-3F  ? 1E-3                      \
+     : (x) >= 1E-4F  ? 1E-4                      \
+     : (x) >= 1E-5F  ? 1E-5                      \
+     : (x) >= 1E-6F  ? 1E-6                      \
+     : (x) >= 1E-7F  ? 1E-7                      \
+     : (x) >= 1E-8F  ? 1E-8                      \
+     : (x) >= 1E-9F  ? 1E-9                      \
+     : (x) >= 1E-10F ? 1E-10                     \
+                     : 1E-11)
+#define SCALE_MANTISSA_VALUE(x) \
+    ((x) * (double)(1 << UNIT_SCALE_SHIFT) / SCALE_POWER_OF_TEN(x))
+// Rounded up, so values with few decimals are not truncated to the digit
+// below
+#define SCALE_MANTISSA(x)                            \
+    ((unsigned int)SCALE_MANTISSA_VALUE(x) +         \
+     (SCALE_MANTISSA_VALUE(x) > (unsigned int)SCALE_MANTISSA_VALUE(x)))
+#define UNIT(name, scale, minExponent) \
+    {name, scale, minExponent, SCALE_MANTISSA(scale), SCALE_EXPONENT(scale)}
 
 UnitType units[] = {
-    {{"Sv/h", (60 * 1E-6F) / CPM_PER_USVH, -6},
-     {"Sv", (60 * 1E-6F / 3600) / CPM_PER_USVH, -6}},
-    {{"rem/h", (60 * 1E-4F) / CPM_PER_USVH, -6},
-     {"rem", (60 * 1E-4F / 3600) / CPM_PER_USVH, -6}},
-    {{"cpm", 60, 0},
-     {"counts", 1, 0}},
-    {{"cps", 1, 0},
-     {"counts", 1, 0}},
+    {UNIT("Sv/h", SIEVERT_RATE_SCALE, -6),
+     UNIT("Sv", SIEVERT_DOSE_SCALE, -6)},
+    {UNIT("rem/h", (60 * 1E-4) / CPM_PER_USVH, -6),
+     UNIT("rem", (60 * 1E-4 / 3600) / CPM_PER_USVH, -6)},
+    {UNIT("cpm", 60, 0),
+     UNIT("counts", 1, 0)},
+    {UNIT("cps", 1, 0),
+     UNIT("counts", 1, 0)},
 };
 
 const float rateAlarmsSvH[] = {
@@ -54,6 +102,38 @@ const float doseAlarmsSv[] = {
     1000E-6F,
 };
 
+#ifdef FIXED_POINT
+#define RATE_ALARM(svH) FIXED((svH) / SIEVERT_RATE_SCALE)
+
+const Rate rateAlarmRates[] = {
+    0,
+    RATE_ALARM(0.2E-6),
+    RATE_ALARM(0.5E-6),
+    RATE_ALARM(1E-6),
+    RATE_ALARM(2E-6),
+    RATE_ALARM(5E-6),
+    RATE_ALARM(10E-6),
+    RATE_ALARM(20E-6),
+    RATE_ALARM(50E-6),
+    RATE_ALARM(100E-6),
+};
+
+#define DOSE_ALARM(sv) ((unsigned int)((sv) / SIEVERT_DOSE_SCALE + 0.5))
+
+const unsigned int doseAlarmCounts[] = {
+    0,
+    DOSE_ALARM(2E-6),
+    DOSE_ALARM(5E-6),
+    DOSE_ALARM(10E-6),
+    DOSE_ALARM(20E-6),
+    DOSE_ALARM(50E-6),
+    DOSE_ALARM(100E-6),
+    DOSE_ALARM(200E-6),
+    DOSE_ALARM(500E-6),
+    DOSE_ALARM(1000E-6),
+};
+#endif
+
 const unsigned int backlightTime[] = {
     0,
     10,
@@ -70,13 +150,30 @@ Settings settings;
 
 unsigned char eeprom[65536];
 #define SETTINGS_PAGE_BASE eeprom
+
+// Power loss simulation and flash wear, for the host tests
+struct
+{
+    int writeLimit;
+    unsigned int eraseCounts[sizeof(eeprom) / SETTINGS_PAGE_SIZE];
+    bool isKept;
+} eepromState = {.writeLimit = -1};
 #endif
 
-#define SETTINGS_PAGE_SIZE 0x400
-#define SETTINGS_PAGE_START 0x30
+// Pages 0x30-0x37 hold the measurement checkpoints (checkpoint.c)
+#define SETTINGS_PAGE_START 0x38
 #define SETTINGS_PAGE_END 0x40
+
+// Firmware before the checkpoints kept the settings ring in pages
+// 0x30-0x3f
+#define SETTINGS_LEGACY_PAGE_START 0x30
+
 #define SETTINGS_PER_PAGE (SETTINGS_PAGE_SIZE / sizeof(settings))
 
+// A page erase stalls the CPU for up to 40 ms, the tick is stretched over
+// this many ticks so the stalled ticks are counted
+#define SETTINGS_ERASE_TICKS 100
+
 unsigned char *getSettingsAddress(unsigned int pageIndex, unsigned int index)
 {
     return (unsigned char *)SETTINGS_PAGE_BASE +
@@ -84,16 +181,16 @@ unsigned char *getSettingsAddress(unsigned int pageIndex, unsigned int index)
            sizeof(settings) * index;
 }
 
-int getLatestSettingsPageIndex()
+int getLatestSettingsPageIndex(int pageStart, int pageEnd)
 {
-    for (int pageIndex = SETTINGS_PAGE_START; pageIndex < SETTINGS_PAGE_END; pageIndex++)
+    for (int pageIndex = pageStart; pageIndex < pageEnd; pageIndex++)
     {
         Settings *page = (Settings *)getSettingsAddress(pageIndex, 0);
         if (page[SETTINGS_PER_PAGE - 1].validState == SETTING_INVALID)
         {
             if (page[0].validState == SETTING_VALID)
                 return pageIndex;
-            else if (pageIndex > SETTINGS_PAGE_START)
+            else if (pageIndex > pageStart)
                 return pageIndex - 1;
             else
                 return -1;
@@ -108,56 +205,188 @@ int getLatestSettingsIndex(int pageIndex)
     Settings *page = (Settings *)getSettingsAddress(pageIndex, 0);
     for (int index = (SETTINGS_PER_PAGE - 1); index >= 0; index--)
     {
-        if (page[index].lifeTimer != ULONG_MAX)
+        if (page[index].lifeTimer != UINT_MAX)
             return index;
     }
 
     return -1;
 }
 
+// Flash page helpers, also used by the checkpoint ring and the data logger
+
 bool eraseSettingsPage(int pageIndex)
 {
 #ifndef SDL_MODE
     FLASH_EraseInitTypeDef eraseRequest;
     eraseRequest.TypeErase = FLASH_TYPEERASE_PAGES;
-    eraseRequest.PageAddress = pageIndex;
+    eraseRequest.PageAddress = (uint32_t)getSettingsAddress(pageIndex, 0);
     eraseRequest.NbPages = 1;
     uint32_t error;
 
-    return (HAL_FLASHEx_Erase(&eraseRequest,
-                              &error) == HAL_OK);
+    traceEvent(TRACE_FLASH_ERASE_START, pageIndex);
+
+    __disable_irq();
+    bool isStretched = stretchEventsTick(SETTINGS_ERASE_TICKS);
+    __enable_irq();
+
+    HAL_FLASH_Unlock();
+    bool success = (HAL_FLASHEx_Erase(&eraseRequest,
+                                      &error) == HAL_OK);
+    HAL_FLASH_Lock();
+
+    if (isStretched)
+    {
+        __disable_irq();
+        endEventsTickStretch();
+        __enable_irq();
+    }
+
+    traceEvent(TRACE_FLASH_ERASE_END, pageIndex);
+
+    return success;
 #else
     // printf("Erasing page %d\n", pageIndex);
 
-    unsigned char *dest = getSettingsAddress(pageIndex, 0);
-    for (int i = 0; i < SETTINGS_PAGE_SIZE; i++)
-        dest[i] = 0xff;
+    traceEvent(TRACE_FLASH_ERASE_START, pageIndex);
+
+    // After a simulated power loss, the page is left as it is
+    bool success = (eepromState.writeLimit != 0);
+    if (success)
+    {
+        eepromState.eraseCounts[pageIndex]++;
 
-    return true;
+        unsigned char *dest = getSettingsAddress(pageIndex, 0);
+        for (int i = 0; i < SETTINGS_PAGE_SIZE; i++)
+            dest[i] = 0xff;
+    }
+
+    traceEvent(TRACE_FLASH_ERASE_END, pageIndex);
+
+    return success;
 #endif
 }
 
-bool writeSettingsToPage(int pageIndex, int index)
+// Writes an even number of bytes to a halfword-aligned, erased address
+bool writeSettingsData(unsigned char *dest, const void *source, unsigned int size)
 {
+#ifndef SDL_MODE
     bool success = true;
+    const unsigned char *sourceBytes = source;
 
-    unsigned int *source = (unsigned int *)&settings;
-    unsigned int *dest = (unsigned int *)getSettingsAddress(pageIndex, index);
+    // The data is the size in halfwords, saturated
+    traceEvent(TRACE_FLASH_PROGRAM_START, (size > 0x1fe) ? 0xff : size / 2);
 
-#ifndef SDL_MODE
-    for (int i = 0; i < (sizeof(settings) / 4); i++)
-        success &= (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD,
+    HAL_FLASH_Unlock();
+    for (unsigned int i = 0; i < size; i += 2)
+        success &= (HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD,
                                       (uint32_t)(dest + i),
-                                      source[i]) == HAL_OK);
+                                      sourceBytes[i] | (sourceBytes[i + 1] << 8)) == HAL_OK);
+    HAL_FLASH_Lock();
+
+    traceEvent(TRACE_FLASH_PROGRAM_END, (size > 0x1fe) ? 0xff : size / 2);
+
+    return success;
 #else
-    // printf("Writing settings to pageIndex %d, index %d, address %04x\n",
-    //        pageIndex, index, (int)((unsigned char *)dest - eeprom));
+    bool success = true;
 
-    *((Settings *)dest) = *((Settings *)source);
-    success = true;
-#endif
+    // After a simulated power loss, the rest of the data is not written
+    if ((eepromState.writeLimit >= 0) &&
+        (size > 2 * (unsigned int)eepromState.writeLimit))
+    {
+        size = 2 * eepromState.writeLimit;
+        success = false;
+    }
+    if (eepromState.writeLimit > 0)
+        eepromState.writeLimit -= size / 2;
+
+    traceEvent(TRACE_FLASH_PROGRAM_START, (size > 0x1fe) ? 0xff : size / 2);
+
+    memcpy(dest, source, size);
+
+    traceEvent(TRACE_FLASH_PROGRAM_END, (size > 0x1fe) ? 0xff : size / 2);
 
     return success;
+#endif
+}
+
+#ifdef SDL_MODE
+// Simulates a power loss after halfwordNum more programmed halfwords: the
+// flash ignores writes and erases from then on. -1 restores the power
+void setSettingsWriteLimit(int halfwordNum)
+{
+    eepromState.writeLimit = halfwordNum;
+}
+
+unsigned int getSettingsEraseCount(int pageIndex)
+{
+    return eepromState.eraseCounts[pageIndex];
+}
+
+// Keeps the settings pages on readSettings(), which otherwise starts the
+// emulator with erased settings
+void setSettingsFlashKept(bool isKept)
+{
+    eepromState.isKept = isKept;
+}
+#endif
+
+bool writeSettingsToPage(int pageIndex, int index)
+{
+    unsigned char *dest = getSettingsAddress(pageIndex, index);
+
+#ifdef SDL_MODE
+    // printf("Writing settings to pageIndex %d, index %d, address %04x\n",
+    //        pageIndex, index, (int)(dest - eeprom));
+#endif
+
+    return writeSettingsData(dest, &settings, sizeof(settings));
+}
+
+// Settings of earlier firmware in pages 0x30-0x37, before the checkpoint
+// ring has written a bank there
+bool isLegacySettingsFlash()
+{
+    if (isCheckpointFlash())
+        return false;
+
+    for (int pageIndex = SETTINGS_LEGACY_PAGE_START;
+         pageIndex < SETTINGS_PAGE_START;
+         pageIndex++)
+    {
+        if (getLatestSettingsIndex(pageIndex) >= 0)
+            return true;
+    }
+
+    return false;
+}
+
+// Moves the latest record of the legacy ring to the start of the settings
+// ring, then erases the checkpoint pages, so this runs only once. A power
+// loss before the pages 0x30-0x37 are erased repeats the move on the next
+// start, which may restore an older record of the legacy ring
+void moveLegacySettings()
+{
+    int pageIndex = getLatestSettingsPageIndex(SETTINGS_LEGACY_PAGE_START,
+                                               SETTINGS_PAGE_END);
+    if (pageIndex >= 0)
+    {
+        int index = getLatestSettingsIndex(pageIndex);
+        settings = *((Settings *)getSettingsAddress(pageIndex, index));
+    }
+
+    for (pageIndex = SETTINGS_PAGE_START; pageIndex < SETTINGS_PAGE_END; pageIndex++)
+    {
+        if (getLatestSettingsIndex(pageIndex) >= 0)
+            eraseSettingsPage(pageIndex);
+    }
+
+    writeSettingsToPage(SETTINGS_PAGE_START, 0);
+
+    for (pageIndex = SETTINGS_LEGACY_PAGE_START; pageIndex < SETTINGS_PAGE_START; pageIndex++)
+    {
+        if (getLatestSettingsIndex(pageIndex) >= 0)
+            eraseSettingsPage(pageIndex);
+    }
 }
 
 void readSettings()
@@ -170,18 +399,29 @@ void readSettings()
     settings.backlight = BACKLIGHT_10S;
     settings.batteryType = BATTERY_NI_MH;
     settings.gameSkillLevel = 0;
+    setConfidenceLevel(CONFIDENCE_LEVEL_95);
 
     settings.lifeTimer = 0;
     settings.lifeCounts = 0;
 
+    bool isLegacy = isLegacySettingsFlash();
+
 #ifdef SDL_MODE
-    for (int pageIndex = SETTINGS_PAGE_START;
-         pageIndex < SETTINGS_PAGE_END;
-         pageIndex++)
-        eraseSettingsPage(pageIndex);
+    if (!eepromState.isKept)
+    {
+        isLegacy = false;
+
+        for (int pageIndex = SETTINGS_PAGE_START;
+             pageIndex < SETTINGS_PAGE_END;
+             pageIndex++)
+            eraseSettingsPage(pageIndex);
+    }
 #endif
 
-    int pageIndex = getLatestSettingsPageIndex();
+    if (isLegacy)
+        moveLegacySettings();
+
+    int pageIndex = getLatestSettingsPageIndex(SETTINGS_PAGE_START, SETTINGS_PAGE_END);
     if (pageIndex >= 0)
     {
         int index = getLatestSettingsIndex(pageIndex);
@@ -197,11 +437,7 @@ void readSettings()
 
 void writeSettings()
 {
-#ifndef SDL_MODE
-    HAL_FLASH_Unlock();
-#endif
-
-    int pageIndex = getLatestSettingsPageIndex();
+    int pageIndex = getLatestSettingsPageIndex(SETTINGS_PAGE_START, SETTINGS_PAGE_END);
     int index;
 
     if (pageIndex < 0)
@@ -237,10 +473,6 @@ void writeSettings()
     }
 
     writeSettingsToPage(pageIndex, index);
-
-#ifndef SDL_MODE
-    HAL_FLASH_Lock();
-#endif
 }
 
 float getRateAlarmSvH(unsigned int index)
@@ -253,7 +485,29 @@ float getDoseAlarmSv(unsigned int index)
     return doseAlarmsSv[index];
 }
 
+#ifdef FIXED_POINT
+Rate getRateAlarmRate(unsigned int index)
+{
+    return rateAlarmRates[index];
+}
+
+unsigned int getDoseAlarmCount(unsigned int index)
+{
+    return doseAlarmCounts[index];
+}
+#endif
+
 int getBacklightTime(unsigned int index)
 {
     return backlightTime[index];
 }
+
+unsigned int getConfidenceLevel()
+{
+    return settings.confidenceLevelCode ^ CONFIDENCE_LEVEL_95;
+}
+
+void setConfidenceLevel(unsigned int level)
+{
+    settings.confidenceLevelCode = level ^ CONFIDENCE_LEVEL_95;
+}
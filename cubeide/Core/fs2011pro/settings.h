@@ -10,6 +10,10 @@
 #ifndef SETTINGS_H
 #define SETTINGS_H
 
+#include <stdbool.h>
+
+#include "cmath.h"
+
 enum UnitsSetting
 {
     UNITS_SIEVERTS,
@@ -19,11 +23,17 @@ enum UnitsSetting
     UNITS_NUM,
 };
 
+#define UNIT_SCALE_SHIFT 28
+
 typedef const struct
 {
     char *const name;
     float scale;
     int minExponent;
+
+    // Fixed point: scale = scaleMantissa / 2^UNIT_SCALE_SHIFT * 10^scaleExponent
+    unsigned int scaleMantissa;
+    int scaleExponent;
 } Unit;
 
 typedef const struct
@@ -92,6 +102,14 @@ enum BatteryTypeSetting
     BATTERY_ALKALINE,
 };
 
+enum ConfidenceLevelSetting
+{
+    CONFIDENCE_LEVEL_68,
+    CONFIDENCE_LEVEL_90,
+    CONFIDENCE_LEVEL_95,
+    CONFIDENCE_LEVEL_99,
+};
+
 enum GameSkillLevelSetting
 {
     GAME_SKILLLEVEL_1,
@@ -124,6 +142,9 @@ typedef struct
     unsigned int batteryType : 1;
     unsigned int gameSkillLevel : 3;
     unsigned int validState : 1;
+    // level ^ CONFIDENCE_LEVEL_95 (get/setConfidenceLevel()): firmware
+    // without the setting wrote these bits as 0, which reads as 95%
+    unsigned int confidenceLevelCode : 2;
 
     unsigned int lifeTimer;
     unsigned long long lifeCounts;
@@ -131,11 +152,32 @@ typedef struct
 
 extern Settings settings;
 
+#ifdef SDL_MODE
+extern unsigned char eeprom[65536];
+#endif
+
+#define SETTINGS_PAGE_SIZE 0x400
+
+unsigned char *getSettingsAddress(unsigned int pageIndex, unsigned int index);
+bool eraseSettingsPage(int pageIndex);
+bool writeSettingsData(unsigned char *dest, const void *source, unsigned int size);
+#ifdef SDL_MODE
+void setSettingsWriteLimit(int halfwordNum);
+unsigned int getSettingsEraseCount(int pageIndex);
+void setSettingsFlashKept(bool isKept);
+#endif
+
 void readSettings();
 void writeSettings();
 
 float getRateAlarmSvH(unsigned int index);
 float getDoseAlarmSv(unsigned int index);
+#ifdef FIXED_POINT
+Rate getRateAlarmRate(unsigned int index);
+unsigned int getDoseAlarmCount(unsigned int index);
+#endif
 int getBacklightTime(unsigned int index);
+unsigned int getConfidenceLevel();
+void setConfidenceLevel(unsigned int level);
 
 #endif
@@ -9,39 +9,313 @@
 
 #include <math.h>
 #include <stdio.h>
-#include <stdlib.h>
+#include <string.h>
 
+#include "counter.h"
 #include "events.h"
+#include "measurements.h"
+#include "sim.h"
 
-float getRandom()
+// Pulses are a Poisson process, generated from exponential inter-arrival
+// times. The arrival is kept in expected pulses, so the rate may change
+// every tick, and a tick without pulses costs no random numbers. Pulses
+// within the tube's dead time are lost.
+//
+// Scenario files (SDL build) have one segment per line, rates in cps,
+// times in seconds and distances in meters, and are repeated:
+//
+//   # comment
+//   seed 1
+//   deadtime 15                        (us)
+//   constant 60 0.5                    (time, rate)
+//   step 120 0.5 20 60                 (time, rate, rate after, step time)
+//   ramp 300 0.5 100                   (time, start rate, end rate)
+//   approach 60 0.5 100 5 0.2          (time, background, rate at 1 m,
+//                                       start distance, end distance)
+//   hotspot 600 0.5 50 30 2            (time, background, hot spot rate,
+//                                       period, hot spot time)
+
+#define SIM_TICK_COUNTER_TICKS (COUNTER_FREQUENCY / TICK_FREQUENCY)
+#define SIM_DISTANCE_MIN 0.01F
+
+struct
 {
-    return (float)rand() / RAND_MAX;
+    // xoshiro128**
+    unsigned int random[4];
+
+    float arrival;
+    float deadTime;
+    float deadTimeEnd;
+
+#ifdef SDL_MODE
+    SimSegment segments[SIM_SCENARIO_SEGMENT_NUM];
+    unsigned int segmentNum;
+
+    unsigned int segmentIndex;
+    unsigned int segmentTick;
+    unsigned int segmentTicks;
+#endif
+} sim;
+
+unsigned int rotateSimRandom(unsigned int x, int k)
+{
+    return (x << k) | (x >> (32 - k));
 }
 
-int getPoisson(float lambda)
+unsigned int getSimRandom()
 {
-    double l = exp(-lambda);
-    int k = 0;
-    double p = 1;
+    unsigned int *s = sim.random;
+    unsigned int result = rotateSimRandom(s[1] * 5, 7) * 9;
+    unsigned int t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotateSimRandom(s[3], 11);
 
-    do
+    return result;
+}
+
+// Returns an exponential variate with mean 1
+float getSimExponential()
+{
+    return -logf(((getSimRandom() >> 8) + 0.5F) * (1.0F / 16777216.0F));
+}
+
+void setSimSeed(unsigned int seed)
+{
+    // Seeded with the MurmurHash3 finalizer, so no state word is zero
+    for (int i = 0; i < 4; i++)
     {
-        k++;
-        p = p * getRandom();
-    } while (p > l);
+        unsigned int z = (seed += 0x9e3779b9);
+        z = (z ^ (z >> 16)) * 0x85ebca6b;
+        z = (z ^ (z >> 13)) * 0xc2b2ae35;
+        sim.random[i] = (z ^ (z >> 16)) | 1;
+    }
+
+    sim.arrival = getSimExponential();
+    sim.deadTimeEnd = 0;
+}
 
-    return k - 1;
+void initSim(unsigned int seed)
+{
+    setSimSeed(seed);
+    setSimDeadTime(DEAD_TIME);
+
+#ifdef SDL_MODE
+    sim.segmentNum = 0;
+    sim.segmentIndex = 0;
+    sim.segmentTick = 0;
+    sim.segmentTicks = 0;
+#endif
 }
 
+void setSimDeadTime(float deadTime)
+{
+    // In ticks
+    sim.deadTime = deadTime * TICK_FREQUENCY;
+}
+
+void simPulse(float position)
+{
+    bool isCounted = (position >= sim.deadTimeEnd);
+
+#if DEAD_TIME_MODEL == DEAD_TIME_PARALYZABLE
+    sim.deadTimeEnd = position + sim.deadTime;
+#else
+    if (isCounted)
+        sim.deadTimeEnd = position + sim.deadTime;
+#endif
+
+    if (!isCounted)
+        return;
+
+#if defined(PULSE_COUNTER) && defined(SDL_MODE)
+    // Delay before the next tick
+    simCounterPulse((unsigned short)((1.0F - position) * SIM_TICK_COUNTER_TICKS));
+#else
+    triggerPulse();
+#endif
+}
+
+// Generates the pulses of one tick
 void simPulses(float cps)
 {
-    int n = getPoisson(cps / TICK_FREQUENCY);
+    float lambda = cps / TICK_FREQUENCY;
+    float position = 0;
 
-    for (int i = 0; i < n; i++)
+    while (sim.arrival < lambda * (1.0F - position))
     {
+        position += sim.arrival / lambda;
+        sim.arrival = getSimExponential();
+
+        simPulse(position);
+    }
+
+    sim.arrival -= lambda * (1.0F - position);
+
+    sim.deadTimeEnd -= 1.0F;
+    if (sim.deadTimeEnd < 0)
+        sim.deadTimeEnd = 0;
+}
+
 #ifdef SDL_MODE
-        // printf("simPulses: triggerPulse\n");
-#endif
-        triggerPulse();
+void setSimRate(float cps)
+{
+    SimSegment segment = {SIM_CONSTANT, 1, cps, 0, 0, 0};
+
+    sim.segmentNum = 0;
+    addSimSegment(&segment);
+}
+
+bool addSimSegment(const SimSegment *segment)
+{
+    if ((sim.segmentNum >= SIM_SCENARIO_SEGMENT_NUM) ||
+        (segment->time <= 0))
+        return false;
+
+    sim.segments[sim.segmentNum++] = *segment;
+
+    sim.segmentIndex = 0;
+    sim.segmentTick = 0;
+    sim.segmentTicks = (unsigned int)(sim.segments[0].time * TICK_FREQUENCY + 0.5F);
+
+    return true;
+}
+
+bool readSimScenarioLine(char *line)
+{
+    char *comment = strchr(line, '#');
+    if (comment)
+        *comment = '\0';
+
+    char keyword[16];
+    SimSegment segment = {0};
+
+    int n = sscanf(line, "%15s %f %f %f %f %f",
+                   keyword,
+                   &segment.time, &segment.rate, &segment.rate2,
+                   &segment.parameter1, &segment.parameter2);
+
+    if (n <= 0)
+        return true;
+    else if (!strcmp(keyword, "seed") && (n == 2))
+        setSimSeed((unsigned int)segment.time);
+    else if (!strcmp(keyword, "deadtime") && (n == 2))
+        setSimDeadTime(segment.time * 1E-6F);
+    else if (!strcmp(keyword, "constant") && (n == 3))
+        segment.type = SIM_CONSTANT;
+    else if (!strcmp(keyword, "step") && (n == 5))
+        segment.type = SIM_STEP;
+    else if (!strcmp(keyword, "ramp") && (n == 4))
+        segment.type = SIM_RAMP;
+    else if (!strcmp(keyword, "approach") && (n == 6))
+        segment.type = SIM_APPROACH;
+    else if (!strcmp(keyword, "hotspot") && (n == 6) && (segment.parameter1 > 0))
+        segment.type = SIM_HOTSPOT;
+    else
+        return false;
+
+    if (n == 2)
+        return true;
+
+    return addSimSegment(&segment);
+}
+
+bool readSimScenario(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "%s: cannot read\n", path);
+
+        return false;
+    }
+
+    char line[256];
+    unsigned int lineIndex = 0;
+    bool isValid = true;
+
+    sim.segmentNum = 0;
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        lineIndex++;
+
+        if (!readSimScenarioLine(line))
+        {
+            fprintf(stderr, "%s:%u: invalid segment\n", path, lineIndex);
+
+            isValid = false;
+            break;
+        }
+    }
+
+    fclose(fp);
+
+    if (isValid && !sim.segmentNum)
+    {
+        fprintf(stderr, "%s: no segments\n", path);
+
+        isValid = false;
+    }
+
+    return isValid;
+}
+
+// Returns the rate at the current scenario time, in cps
+float getSimRate()
+{
+    if (!sim.segmentNum)
+        return 0;
+
+    const SimSegment *segment = &sim.segments[sim.segmentIndex];
+    float time = (float)sim.segmentTick / TICK_FREQUENCY;
+    float fraction = time / segment->time;
+
+    switch (segment->type)
+    {
+    case SIM_STEP:
+        return (time < segment->parameter1) ? segment->rate : segment->rate2;
+
+    case SIM_RAMP:
+        return segment->rate + (segment->rate2 - segment->rate) * fraction;
+
+    case SIM_APPROACH:
+    {
+        float distance = segment->parameter1 +
+                         (segment->parameter2 - segment->parameter1) * fraction;
+        if (distance < SIM_DISTANCE_MIN)
+            distance = SIM_DISTANCE_MIN;
+
+        return segment->rate + segment->rate2 / (distance * distance);
+    }
+
+    case SIM_HOTSPOT:
+        return segment->rate +
+               ((fmodf(time, segment->parameter1) < segment->parameter2) ? segment->rate2 : 0);
+
+    default:
+        return segment->rate;
+    }
+}
+
+// Generates the pulses of one scenario tick
+void onSimTick()
+{
+    simPulses(getSimRate());
+
+    if (!sim.segmentNum)
+        return;
+
+    sim.segmentTick++;
+    if (sim.segmentTick >= sim.segmentTicks)
+    {
+        sim.segmentIndex = (sim.segmentIndex + 1) % sim.segmentNum;
+        sim.segmentTick = 0;
+        sim.segmentTicks = (unsigned int)(sim.segments[sim.segmentIndex].time * TICK_FREQUENCY + 0.5F);
     }
 }
+#endif
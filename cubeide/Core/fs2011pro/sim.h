@@ -10,6 +10,50 @@
 #ifndef SIM_H
 #define SIM_H
 
-void simPulses(float cpm);
+#include <stdbool.h>
+
+#define SIM_SEED 1
+#define SIM_SCENARIO_SEGMENT_NUM 32
+
+enum SimSegmentType
+{
+    SIM_CONSTANT,
+    SIM_STEP,
+    SIM_RAMP,
+    SIM_APPROACH,
+    SIM_HOTSPOT,
+};
+
+// Rates are in cps, times in seconds and distances in meters:
+// SIM_CONSTANT     rate
+// SIM_STEP         rate, then rate2 from time parameter1
+// SIM_RAMP         rate to rate2, linearly
+// SIM_APPROACH     rate plus rate2 (at 1 m) by the inverse square of a
+//                  distance from parameter1 to parameter2, linearly
+// SIM_HOTSPOT      rate plus rate2 for parameter2 every parameter1
+typedef struct
+{
+    unsigned char type;
+    float time;
+    float rate;
+    float rate2;
+    float parameter1;
+    float parameter2;
+} SimSegment;
+
+void initSim(unsigned int seed);
+void setSimSeed(unsigned int seed);
+void setSimDeadTime(float deadTime);
+
+void simPulses(float cps);
+
+#ifdef SDL_MODE
+void setSimRate(float cps);
+bool addSimSegment(const SimSegment *segment);
+bool readSimScenario(const char *path);
+
+float getSimRate();
+void onSimTick();
+#endif
 
 #endif
@@ -0,0 +1,108 @@
+/*
+ * FS2011 Pro
+ * Event trace
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#ifdef SDL_MODE
+#include <stdio.h>
+#else
+#include "main.h"
+#endif
+
+#include "events.h"
+#include "trace.h"
+
+#ifdef TRACE
+
+// Power of two
+#define TRACE_SIZE 128
+#define TRACE_MAGIC 0x45435254
+
+// Records hold the low 16 bits of the microsecond time. A TRACE_TIME
+// record, with the high 16 bits in its time field and their increment as
+// data (saturated), precedes any record whose high bits differ from the
+// previous record's. The decoder works back from timeHigh, so overwritten
+// TRACE_TIME records are not needed.
+
+typedef struct
+{
+    unsigned short time;
+    unsigned char type;
+    unsigned char data;
+} TraceRecord;
+
+// The layout is read by test/decode_trace.py
+struct Trace
+{
+    unsigned int magic;
+    unsigned short size;
+    volatile unsigned short index;
+    unsigned int timeHigh;
+    TraceRecord records[TRACE_SIZE];
+} trace = {TRACE_MAGIC, TRACE_SIZE, 0, 0xffffffff, {{0, 0, 0}}};
+
+#ifdef SDL_MODE
+// Records of each type since start, for the host tools
+unsigned int traceCounts[TRACE_TYPE_NUM];
+#endif
+
+void addTraceRecord(unsigned short time, unsigned char type, unsigned char data)
+{
+    TraceRecord *record = &trace.records[trace.index % TRACE_SIZE];
+    record->time = time;
+    record->type = type;
+    record->data = data;
+
+    trace.index++;
+}
+
+void traceEvent(unsigned char type, unsigned char data)
+{
+    // Records are also added from interrupts
+#ifndef SDL_MODE
+    unsigned int primask = __get_PRIMASK();
+    __disable_irq();
+#endif
+
+    unsigned int time = getEventsMicroseconds();
+
+    if ((time >> 16) != trace.timeHigh)
+    {
+        unsigned int increment = ((time >> 16) - trace.timeHigh) & 0xffff;
+
+        trace.timeHigh = time >> 16;
+        addTraceRecord(time >> 16, TRACE_TIME, (increment > 0xff) ? 0xff : increment);
+    }
+
+    addTraceRecord(time, type, data);
+
+#ifdef SDL_MODE
+    if (type < TRACE_TYPE_NUM)
+        traceCounts[type]++;
+#else
+    __set_PRIMASK(primask);
+#endif
+}
+
+#ifdef SDL_MODE
+void writeTrace(const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return;
+
+    fwrite(&trace, sizeof(trace), 1, fp);
+    fclose(fp);
+}
+
+unsigned int getTraceCount(unsigned char type)
+{
+    return (type < TRACE_TYPE_NUM) ? traceCounts[type] : 0;
+}
+#endif
+
+#endif
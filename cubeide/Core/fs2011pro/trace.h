@@ -0,0 +1,54 @@
+/*
+ * FS2011 Pro
+ * Event trace
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timestamped event trace in a RAM ring, read over SWD with
+// test/remote.py and decoded with test/decode_trace.py:
+// #define TRACE
+
+// The SDL build always traces, and writes the ring to a file at exit
+#if defined(SDL_MODE) && !defined(TRACE)
+#define TRACE
+#endif
+
+enum TraceType
+{
+    TRACE_NONE,
+    TRACE_TIME,
+
+    TRACE_PULSES,
+    TRACE_KEY,
+    TRACE_ALARM,
+
+    TRACE_FRAME_START,
+    TRACE_FRAME_END,
+    TRACE_FLASH_ERASE_START,
+    TRACE_FLASH_ERASE_END,
+    TRACE_FLASH_PROGRAM_START,
+    TRACE_FLASH_PROGRAM_END,
+    TRACE_GAME_SEARCH_START,
+    TRACE_GAME_SEARCH_END,
+
+    TRACE_TYPE_NUM,
+};
+
+#ifdef TRACE
+void traceEvent(unsigned char type, unsigned char data);
+
+#ifdef SDL_MODE
+void writeTrace(const char *path);
+unsigned int getTraceCount(unsigned char type);
+#endif
+#else
+#define traceEvent(type, data)
+#endif
+
+#endif
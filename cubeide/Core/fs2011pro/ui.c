@@ -12,11 +12,13 @@
 #include "display.h"
 #include "game.h"
 #include "keyboard.h"
+#include "logger.h"
 #include "measurements.h"
 #include "menus.h"
 #include "power.h"
 #include "settings.h"
 #include "stats.h"
+#include "trace.h"
 #include "ui.h"
 
 #ifdef SDL_MODE
@@ -26,6 +28,7 @@ void onSDLTick();
 struct UI
 {
     unsigned char currentView;
+    bool isViewChanged;
     bool updateView;
 
     bool backKeyDown;
@@ -34,6 +37,7 @@ struct UI
 void setView(unsigned char viewIndex)
 {
     ui.currentView = viewIndex;
+    ui.isViewChanged = true;
     ui.backKeyDown = false;
 
     updateView();
@@ -49,6 +53,46 @@ void updateView()
     ui.updateView = true;
 }
 
+void drawView()
+{
+    drawStatusBar();
+
+    switch (ui.currentView)
+    {
+    case VIEW_WELCOME:
+        drawWelcome();
+        break;
+
+    case VIEW_INSTANTANEOUS_RATE:
+        drawInstantaneousRateView();
+        break;
+
+    case VIEW_AVERAGE_RATE:
+        drawAverageRateView();
+        break;
+
+    case VIEW_DOSE:
+        drawDoseView();
+        break;
+
+    case VIEW_HISTORY:
+        drawHistoryView();
+        break;
+
+    case VIEW_MENU:
+        drawMenuView();
+        break;
+
+    case VIEW_STATS:
+        drawStatsView();
+        break;
+
+    case VIEW_GAME:
+        drawGameView();
+        break;
+    }
+}
+
 void updateUI()
 {
 #ifdef SDL_MODE
@@ -74,6 +118,8 @@ void updateUI()
     else if (key == KEY_POWER_OFF)
     {
         writeSettings();
+        writeMeasurementCheckpoint(true);
+        writeLogger();
 
         powerDown(0);
     }
@@ -108,45 +154,40 @@ void updateUI()
     {
         ui.updateView = false;
 
-        clearDisplay();
-
-        drawStatusBar();
-
-        switch (ui.currentView)
-        {
-        case VIEW_WELCOME:
-            drawWelcome();
-            break;
-
-        case VIEW_INSTANTANEOUS_RATE:
-            drawInstantaneousRateView();
-            break;
+        traceEvent(TRACE_FRAME_START, ui.currentView);
 
-        case VIEW_AVERAGE_RATE:
-            drawAverageRateView();
-            break;
+        // The measurement views redraw only the regions that changed: with
+        // the full buffer in place, with page rendering by hashing the
+        // regions first and drawing only the buffers with changed regions
+        bool isRegionView = (ui.currentView == VIEW_INSTANTANEOUS_RATE) ||
+                            (ui.currentView == VIEW_AVERAGE_RATE) ||
+                            (ui.currentView == VIEW_DOSE);
+        bool isPartialRedraw = (DISPLAY_BUFFER_PAGES == DISPLAY_PAGES) &&
+                               isRegionView &&
+                               !ui.isViewChanged;
 
-        case VIEW_DOSE:
-            drawDoseView();
-            break;
-
-        case VIEW_HISTORY:
-            drawHistoryView();
-            break;
+        if (!isRegionView || ui.isViewChanged)
+            invalidateDisplayRegions();
+        ui.isViewChanged = false;
 
-        case VIEW_MENU:
-            drawMenuView();
-            break;
+        if ((DISPLAY_BUFFER_PAGES < DISPLAY_PAGES) && isRegionView)
+        {
+            startDisplayRegionHashing();
+            drawView();
+            endDisplayRegionHashing();
+        }
 
-        case VIEW_STATS:
-            drawStatsView();
-            break;
+        if (firstDisplayPage())
+        {
+            do
+            {
+                if (!isPartialRedraw)
+                    clearDisplay();
 
-        case VIEW_GAME:
-            drawGameView();
-            break;
+                drawView();
+            } while (nextDisplayPage());
         }
 
-        updateDisplay();
+        traceEvent(TRACE_FRAME_END, ui.currentView);
     }
 }
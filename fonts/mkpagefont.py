@@ -0,0 +1,107 @@
+# FS2011 Pro
+# Page font generator
+#
+# (C) 2022 Gissio
+#
+# License: MIT
+#
+# Pre-rasterizes BDF glyphs into the display buffer layout (pages of 8
+# rows, one byte per column, top pixel in the LSB), for a baseline at a
+# fixed row within its page. Each glyph has the background mask of its
+# bounding box in each page, as u8g2 draws fonts in solid mode.
+#
+# Usage: mkpagefont.py font.bdf first-last baseline-row output.h name
+
+import sys
+
+def read_bdf(path, first, last):
+    glyphs = {}
+    with open(path) as f:
+        lines = iter(f.read().splitlines())
+
+    for line in lines:
+        if not line.startswith('STARTCHAR'):
+            continue
+
+        glyph = {}
+        for line in lines:
+            fields = line.split()
+            if fields[0] == 'ENCODING':
+                glyph['encoding'] = int(fields[1])
+            elif fields[0] == 'DWIDTH':
+                glyph['advance'] = int(fields[1])
+            elif fields[0] == 'BBX':
+                glyph['bbx'] = [int(value) for value in fields[1:5]]
+            elif fields[0] == 'BITMAP':
+                glyph['rows'] = []
+            elif fields[0] == 'ENDCHAR':
+                break
+            elif 'rows' in glyph:
+                glyph['rows'].append(int(fields[0], 16) << (32 - 4 * len(fields[0])))
+
+        if first <= glyph['encoding'] <= last:
+            glyphs[glyph['encoding']] = glyph
+
+    return glyphs
+
+def rasterize(glyph, baseline_row):
+    width, height, x, y = glyph['bbx']
+    # Rows relative to the first row of the baseline page
+    top = baseline_row - (height + y)
+    first_page = top // 8
+    page_num = (top + height - 1) // 8 - first_page + 1 if width and height else 0
+
+    masks = [0] * page_num
+    columns = [[0] * width for i in range(page_num)]
+    for row in range(height if width else 0):
+        page, bit = divmod(top + row - 8 * first_page, 8)
+        masks[page] |= 1 << bit
+        for column in range(width):
+            if glyph['rows'][row] & (1 << (31 - column)):
+                columns[page][column] |= 1 << bit
+
+    return first_page, masks, columns
+
+def main():
+    path, glyph_range, baseline_row, output, name = sys.argv[1:6]
+    first, last = [int(value) for value in glyph_range.split('-')]
+    baseline_row = int(baseline_row)
+
+    glyphs = read_bdf(path, first, last)
+
+    data = []
+    entries = []
+    for encoding in range(first, last + 1):
+        glyph = glyphs.get(encoding)
+        if glyph is None:
+            entries.append((0, 0, 0, 0, 0, len(data)))
+            continue
+
+        first_page, masks, columns = rasterize(glyph, baseline_row)
+        entries.append((glyph['advance'], glyph['bbx'][2], len(columns[0]) if columns else 0,
+                        first_page, len(masks), len(data)))
+        data += masks
+        for page_columns in columns:
+            data += page_columns
+
+    upper_name = name.upper()
+    with open(output, 'w') as f:
+        f.write('/*\n')
+        f.write('  Generated by mkpagefont.py from %s\n' % path)
+        f.write('  Glyphs: %d-%d, baseline at row %d of a page\n' % (first, last, baseline_row))
+        f.write('*/\n\n')
+        f.write('#define %s_FIRST %d\n' % (upper_name, first))
+        f.write('#define %s_NUM %d\n' % (upper_name, last - first + 1))
+        f.write('#define %s_BASELINE_ROW %d\n\n' % (upper_name, baseline_row))
+        f.write('// Advance, x offset, width, first page from the baseline page, page number,\n')
+        f.write('// offset of the page masks, followed by the columns of each page\n')
+        f.write('const PageFontGlyph %s_glyphs[%d] = {\n' % (name, len(entries)))
+        for entry in entries:
+            f.write('    {%d, %d, %d, %d, %d, %d},\n' % entry)
+        f.write('};\n\n')
+        f.write('const uint8_t %s_data[%d] = {' % (name, len(data)))
+        for i, value in enumerate(data):
+            f.write(('\n    ' if i % 12 == 0 else ' ') + '0x%02x,' % value)
+        f.write('\n};\n')
+
+main()
@@ -0,0 +1,293 @@
+/*
+ * FS2011 Pro
+ * Headless render benchmark
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../cubeide/Core/fs2011pro/counter.h"
+#include "../cubeide/Core/fs2011pro/display.h"
+#include "../cubeide/Core/fs2011pro/events.h"
+#include "../cubeide/Core/fs2011pro/game.h"
+#include "../cubeide/Core/fs2011pro/keyboard.h"
+#include "../cubeide/Core/fs2011pro/logger.h"
+#include "../cubeide/Core/fs2011pro/measurements.h"
+#include "../cubeide/Core/fs2011pro/menus.h"
+#include "../cubeide/Core/fs2011pro/power.h"
+#include "../cubeide/Core/fs2011pro/settings.h"
+#include "../cubeide/Core/fs2011pro/ui.h"
+
+#include "headless/headless.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Draws every view of updateUI() many times and reports the time and the
+// LCD traffic per frame. Then each view is drawn after every second of
+// measurements, redrawn in full or, for the measurement views, only in
+// the regions that changed.
+// Frames can be written and compared with golden images:
+//
+//   fs2011pro-bench [-n iterations] [-o output-dir] [-g golden-dir]
+//
+// The device state is built from a constant pulse rate, so the frames do
+// not depend on the host. The golden images in test/golden are made with
+// the default configuration; the page-buffer builds (DISPLAY_BUFFER_PAGES
+// 2 and 1) must draw the same frames.
+
+#define BENCH_WARMUP_TIME 600
+#define BENCH_RATE 5
+#define BENCH_ITERATIONS 2000
+// Each partial redraw follows a second of ticks
+#define BENCH_PARTIAL_ITERATIONS_DIVISOR 10
+
+typedef struct
+{
+    const char *name;
+    unsigned char view;
+} BenchView;
+
+static const BenchView benchViews[] = {
+    {"welcome", VIEW_WELCOME},
+    {"instantaneous", VIEW_INSTANTANEOUS_RATE},
+    {"average", VIEW_AVERAGE_RATE},
+    {"dose", VIEW_DOSE},
+    {"history", VIEW_HISTORY},
+    {"menu", VIEW_MENU},
+    {"stats", VIEW_STATS},
+    {"game", VIEW_GAME},
+};
+
+void onSDLTick()
+{
+}
+
+void injectPulse()
+{
+#ifdef PULSE_COUNTER
+    simCounterPulse(0);
+#else
+    triggerPulse();
+#endif
+}
+
+// Runs the device at a constant rate, drawing the views or only updating
+// the events
+void runTicks(unsigned int ticks, unsigned int rate, bool isDrawn)
+{
+    unsigned int pulseFraction = 0;
+
+    for (unsigned int i = 0; i < ticks; i++)
+    {
+        pulseFraction += rate;
+        for (; pulseFraction >= TICK_FREQUENCY; pulseFraction -= TICK_FREQUENCY)
+            injectPulse();
+
+        addHeadlessTicks(1);
+        onEventsTick();
+
+        if (!(i % 10))
+        {
+            if (isDrawn)
+                updateUI();
+            else
+                updateEvents();
+        }
+    }
+}
+
+void openView(unsigned char view)
+{
+    switch (view)
+    {
+    case VIEW_MENU:
+        openSettingsMenu();
+        break;
+
+    case VIEW_GAME:
+        resetGame(0);
+        setView(view);
+        break;
+
+    default:
+        setView(view);
+        break;
+    }
+}
+
+double getBenchTime()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + 1E-9 * time.tv_nsec;
+}
+
+// Returns microseconds per frame
+double benchFrames(unsigned char view, bool isViewChanged, unsigned int iterations)
+{
+    double startTime = getBenchTime();
+
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        if (isViewChanged)
+            setView(view);
+        else
+            updateView();
+
+        updateUI();
+    }
+
+    double endTime = getBenchTime();
+
+    return 1E6 * (endTime - startTime) / iterations;
+}
+
+// Returns microseconds per frame drawn after a second of measurements,
+// without the time of the second. Unless the view is changed, the
+// measurement views redraw only the changed regions
+double benchSecondFrames(unsigned char view, bool isViewChanged, unsigned int iterations)
+{
+    double time = 0;
+
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        runTicks(TICK_FREQUENCY, BENCH_RATE, false);
+
+        double startTime = getBenchTime();
+
+        if (isViewChanged)
+            setView(view);
+
+        updateUI();
+
+        time += getBenchTime() - startTime;
+    }
+
+    return 1E6 * time / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int iterations = BENCH_ITERATIONS;
+    const char *outputPath = NULL;
+    const char *goldenPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-n") && ((i + 1) < argc))
+            iterations = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && ((i + 1) < argc))
+            outputPath = argv[++i];
+        else if (!strcmp(argv[i], "-g") && ((i + 1) < argc))
+            goldenPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [-n iterations] [-o output-dir] [-g golden-dir]\n", argv[0]);
+
+            return 2;
+        }
+    }
+
+    if (!iterations)
+        iterations = 1;
+
+    initKeyboard();
+    initPower();
+    initDisplay();
+
+    readSettings();
+
+    initEvents();
+    initMeasurements();
+    initLogger();
+    initMenus();
+
+    runTicks(BENCH_WARMUP_TIME * TICK_FREQUENCY, BENCH_RATE, true);
+
+    // The LCD traffic is that of the first frame, as unchanged tiles are
+    // not sent again
+    printf("%-14s %12s %12s %12s %12s\n",
+           "view", "tiles", "bytes", "full (us)", "update (us)");
+
+    unsigned int failureNum = 0;
+
+    for (unsigned int i = 0; i < sizeof(benchViews) / sizeof(BenchView); i++)
+    {
+        const BenchView *benchView = &benchViews[i];
+        HeadlessDisplayStats stats;
+
+        openView(benchView->view);
+
+        resetHeadlessDisplayStats();
+        updateUI();
+        getHeadlessDisplayStats(&stats);
+
+        double fullTime = benchFrames(benchView->view, true, iterations);
+        double updateTime = benchFrames(benchView->view, false, iterations);
+
+        printf("%-14s %12u %12u %12.2f %12.2f\n",
+               benchView->name,
+               stats.tileNum, stats.byteNum,
+               fullTime, updateTime);
+
+        char path[1024];
+
+        if (outputPath)
+        {
+            snprintf(path, sizeof(path), "%s/%s.pbm", outputPath, benchView->name);
+            if (!writeHeadlessFrame(path))
+            {
+                fprintf(stderr, "%s: cannot write\n", path);
+
+                failureNum++;
+            }
+        }
+
+        if (goldenPath)
+        {
+            snprintf(path, sizeof(path), "%s/%s.pbm", goldenPath, benchView->name);
+            int differenceNum = compareHeadlessFrame(path);
+            if (differenceNum < 0)
+            {
+                fprintf(stderr, "%s: cannot read\n", path);
+
+                failureNum++;
+            }
+            else if (differenceNum > 0)
+            {
+                fprintf(stderr, "%s: %d pixels differ\n", path, differenceNum);
+
+                failureNum++;
+            }
+        }
+    }
+
+    // Frames of every second, after the golden frames as they advance the
+    // time
+    unsigned int partialIterations = iterations / BENCH_PARTIAL_ITERATIONS_DIVISOR;
+    if (!partialIterations)
+        partialIterations = 1;
+
+    printf("\n%-14s %12s %12s\n", "view", "full (us)", "partial (us)");
+
+    for (unsigned int i = 0; i < sizeof(benchViews) / sizeof(BenchView); i++)
+    {
+        const BenchView *benchView = &benchViews[i];
+
+        openView(benchView->view);
+        updateUI();
+
+        double fullTime = benchSecondFrames(benchView->view, true, partialIterations);
+        double partialTime = benchSecondFrames(benchView->view, false, partialIterations);
+
+        printf("%-14s %12.2f %12.2f\n",
+               benchView->name, fullTime, partialTime);
+    }
+
+    return failureNum ? 1 : 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * FS2011 Pro
+ * Headless SDL replacement
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#ifndef HEADLESS_SDL_H
+#define HEADLESS_SDL_H
+
+#include <stdint.h>
+
+// The subset of SDL used by the firmware modules in SDL_MODE. Time is a
+// virtual clock advanced by the host program, keys are set by it
+
+typedef uint8_t Uint8;
+typedef uint32_t Uint32;
+typedef uint64_t Uint64;
+
+enum
+{
+    SDL_SCANCODE_RIGHT = 79,
+    SDL_SCANCODE_LEFT = 80,
+    SDL_SCANCODE_DOWN = 81,
+    SDL_SCANCODE_UP = 82,
+    SDL_SCANCODE_SPACE = 44,
+
+    SDL_NUM_SCANCODES = 512,
+};
+
+const Uint8 *SDL_GetKeyboardState(int *numkeys);
+Uint32 SDL_GetTicks(void);
+Uint64 SDL_GetPerformanceCounter(void);
+Uint64 SDL_GetPerformanceFrequency(void);
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * FS2011 Pro
+ * Headless host platform
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "SDL.h"
+
+#include "headless.h"
+
+// The performance counter counts virtual microseconds, so tick latencies
+// and traces do not depend on the speed of the host
+
+#define HEADLESS_TICK_MICROSECONDS 1000
+
+struct Headless
+{
+    Uint32 ticks;
+    Uint8 keyboardState[SDL_NUM_SCANCODES];
+} headless;
+
+void addHeadlessTicks(unsigned int value)
+{
+    headless.ticks += value;
+}
+
+unsigned int getHeadlessTicks()
+{
+    return headless.ticks;
+}
+
+void setHeadlessKey(int scancode, bool value)
+{
+    if ((scancode >= 0) && (scancode < SDL_NUM_SCANCODES))
+        headless.keyboardState[scancode] = value;
+}
+
+// Pumps the SDL events in the SDL build
+int u8g_sdl_get_key()
+{
+    return -1;
+}
+
+const Uint8 *SDL_GetKeyboardState(int *numkeys)
+{
+    if (numkeys)
+        *numkeys = SDL_NUM_SCANCODES;
+
+    return headless.keyboardState;
+}
+
+Uint32 SDL_GetTicks(void)
+{
+    return headless.ticks;
+}
+
+Uint64 SDL_GetPerformanceCounter(void)
+{
+    return (Uint64)headless.ticks * HEADLESS_TICK_MICROSECONDS;
+}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+{
+    return 1000000;
+}
@@ -0,0 +1,41 @@
+/*
+ * FS2011 Pro
+ * Headless host platform
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HEADLESS_WIDTH 128
+#define HEADLESS_HEIGHT 64
+
+typedef struct
+{
+    unsigned int drawNum;
+    unsigned int tileNum;
+    unsigned int byteNum;
+} HeadlessDisplayStats;
+
+// Virtual clock
+void addHeadlessTicks(unsigned int value);
+unsigned int getHeadlessTicks();
+
+void setHeadlessKey(int scancode, bool value);
+
+// Display
+const uint8_t *getHeadlessFrame();
+bool getHeadlessPixel(int x, int y);
+void getHeadlessDisplayStats(HeadlessDisplayStats *stats);
+void resetHeadlessDisplayStats();
+
+bool writeHeadlessFrame(const char *path);
+int compareHeadlessFrame(const char *path);
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * FS2011 Pro
+ * Headless display
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "u8g2.h"
+
+#include "headless.h"
+
+// Captures the tiles sent by the firmware in a frame with the layout of
+// the LCD memory: 8 pages of 128 columns, LSB is the top row
+
+#define HEADLESS_PAGE_NUM (HEADLESS_HEIGHT / 8)
+
+struct HeadlessDisplay
+{
+    uint8_t frame[HEADLESS_PAGE_NUM * HEADLESS_WIDTH];
+    HeadlessDisplayStats stats;
+} headlessDisplay;
+
+static const u8x8_display_info_t headlessDisplayInfo = {
+    /* chip_enable_level = */ 0,
+    /* chip_disable_level = */ 1,
+    /* post_chip_enable_wait_ns = */ 0,
+    /* pre_chip_disable_wait_ns = */ 0,
+    /* reset_pulse_width_ms = */ 0,
+    /* post_reset_wait_ms = */ 0,
+    /* sda_setup_time_ns = */ 0,
+    /* sck_pulse_width_ns = */ 0,
+    /* sck_clock_hz = */ 4000000UL,
+    /* spi_mode = */ 1,
+    /* i2c_bus_clock_100kHz = */ 0,
+    /* data_setup_time_ns = */ 0,
+    /* write_pulse_width_ns = */ 0,
+    /* tile_width = */ HEADLESS_WIDTH / 8,
+    /* tile_height = */ HEADLESS_PAGE_NUM,
+    /* default_x_offset = */ 0,
+    /* flipmode_x_offset = */ 0,
+    /* pixel_width = */ HEADLESS_WIDTH,
+    /* pixel_height = */ HEADLESS_HEIGHT,
+};
+
+uint8_t onHeadlessDisplayMessage(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
+{
+    switch (msg)
+    {
+    case U8X8_MSG_DISPLAY_SETUP_MEMORY:
+        u8x8_d_helper_display_setup_memory(u8x8, &headlessDisplayInfo);
+        break;
+
+    case U8X8_MSG_DISPLAY_INIT:
+        u8x8_d_helper_display_init(u8x8);
+        break;
+
+    case U8X8_MSG_DISPLAY_SET_POWER_SAVE:
+    case U8X8_MSG_DISPLAY_SET_FLIP_MODE:
+    case U8X8_MSG_DISPLAY_SET_CONTRAST:
+    case U8X8_MSG_DISPLAY_REFRESH:
+        break;
+
+    case U8X8_MSG_DISPLAY_DRAW_TILE:
+    {
+        u8x8_tile_t *tile = arg_ptr;
+        unsigned int x = tile->x_pos * 8;
+        unsigned int size = tile->cnt * 8;
+
+        headlessDisplay.stats.drawNum++;
+
+        for (; arg_int > 0; arg_int--)
+        {
+            if ((tile->y_pos < HEADLESS_PAGE_NUM) && (x + size <= HEADLESS_WIDTH))
+                memcpy(headlessDisplay.frame + tile->y_pos * HEADLESS_WIDTH + x,
+                       tile->tile_ptr, size);
+
+            headlessDisplay.stats.tileNum += tile->cnt;
+            headlessDisplay.stats.byteNum += size;
+            x += size;
+        }
+
+        break;
+    }
+
+    default:
+        return 0;
+    }
+
+    return 1;
+}
+
+uint8_t onHeadlessGPIOMessage(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
+{
+    (void)u8x8;
+    (void)msg;
+    (void)arg_int;
+    (void)arg_ptr;
+
+    return 1;
+}
+
+// Replaces the SDL display of the SDL build
+void u8x8_Setup_SDL_128x64(u8x8_t *u8x8)
+{
+    u8x8_SetupDefaults(u8x8);
+
+    u8x8->display_cb = onHeadlessDisplayMessage;
+    u8x8->gpio_and_delay_cb = onHeadlessGPIOMessage;
+
+    u8x8_SetupMemory(u8x8);
+}
+
+const uint8_t *getHeadlessFrame()
+{
+    return headlessDisplay.frame;
+}
+
+bool getHeadlessPixel(int x, int y)
+{
+    if ((x < 0) || (x >= HEADLESS_WIDTH) || (y < 0) || (y >= HEADLESS_HEIGHT))
+        return false;
+
+    return (headlessDisplay.frame[(y / 8) * HEADLESS_WIDTH + x] >> (y % 8)) & 1;
+}
+
+void getHeadlessDisplayStats(HeadlessDisplayStats *stats)
+{
+    *stats = headlessDisplay.stats;
+}
+
+void resetHeadlessDisplayStats()
+{
+    memset(&headlessDisplay.stats, 0, sizeof(headlessDisplay.stats));
+}
+
+// Frames are stored as binary PBM files, set pixels are black
+
+void getHeadlessFrameRow(int y, uint8_t *row)
+{
+    for (int i = 0; i < (HEADLESS_WIDTH / 8); i++)
+    {
+        uint8_t value = 0;
+        for (int j = 0; j < 8; j++)
+            value = (value << 1) | getHeadlessPixel(8 * i + j, y);
+
+        row[i] = value;
+    }
+}
+
+bool writeHeadlessFrame(const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "P4\n%d %d\n", HEADLESS_WIDTH, HEADLESS_HEIGHT);
+
+    for (int y = 0; y < HEADLESS_HEIGHT; y++)
+    {
+        uint8_t row[HEADLESS_WIDTH / 8];
+        getHeadlessFrameRow(y, row);
+
+        fwrite(row, 1, sizeof(row), fp);
+    }
+
+    bool success = !ferror(fp);
+
+    fclose(fp);
+
+    return success;
+}
+
+// Returns the number of differing pixels, or -1 if the file is not a
+// frame
+int compareHeadlessFrame(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+
+    int width, height;
+    int differenceNum = -1;
+
+    if ((fscanf(fp, "P4 %d %d", &width, &height) == 2) &&
+        (width == HEADLESS_WIDTH) &&
+        (height == HEADLESS_HEIGHT) &&
+        (fgetc(fp) != EOF))
+    {
+        differenceNum = 0;
+
+        for (int y = 0; y < HEADLESS_HEIGHT; y++)
+        {
+            uint8_t row[HEADLESS_WIDTH / 8];
+            uint8_t referenceRow[HEADLESS_WIDTH / 8];
+            getHeadlessFrameRow(y, row);
+
+            if (fread(referenceRow, 1, sizeof(referenceRow), fp) != sizeof(referenceRow))
+            {
+                differenceNum = -1;
+
+                break;
+            }
+
+            for (int i = 0; i < (HEADLESS_WIDTH / 8); i++)
+            {
+                for (uint8_t value = row[i] ^ referenceRow[i]; value; value >>= 1)
+                    differenceNum += value & 1;
+            }
+        }
+    }
+
+    fclose(fp);
+
+    return differenceNum;
+}
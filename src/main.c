@@ -11,13 +11,17 @@
 #include "../cubeide/Core/fs2011pro/events.h"
 #include "../cubeide/Core/fs2011pro/game.h"
 #include "../cubeide/Core/fs2011pro/keyboard.h"
+#include "../cubeide/Core/fs2011pro/logger.h"
 #include "../cubeide/Core/fs2011pro/measurements.h"
 #include "../cubeide/Core/fs2011pro/power.h"
 #include "../cubeide/Core/fs2011pro/settings.h"
 #include "../cubeide/Core/fs2011pro/sim.h"
 #include "../cubeide/Core/fs2011pro/menus.h"
+#include "../cubeide/Core/fs2011pro/trace.h"
 #include "../cubeide/Core/fs2011pro/ui.h"
 
+#include <stdlib.h>
+
 #include "SDL.h"
 
 unsigned int sdlTimer;
@@ -30,7 +34,7 @@ void onSDLTick()
     {
         u8g_sdl_get_key();
 
-        simPulses(0.1F * CPM_PER_USVH / 60);
+        onSimTick();
         onEventsTick();
 
         sdlTimer++;
@@ -44,10 +48,27 @@ void waitSDLTick()
     while (sdlTimer == SDL_GetTicks());
 }
 
+void onSDLExit()
+{
+    writeTrace("fs2011pro-trace.bin");
+}
+
+// Usage: fs2011pro [scenario-file]
 int main(int argc, char *argv[])
 {
+    initSim(SIM_SEED);
+    if (argc > 1)
+    {
+        if (!readSimScenario(argv[1]))
+            return 1;
+    }
+    else
+        setSimRate(0.1F * CPM_PER_USVH / 60);
+
     sdlTimer = SDL_GetTicks();
 
+    atexit(onSDLExit);
+
     initKeyboard();
     initPower();
     initDisplay();
@@ -56,6 +77,7 @@ int main(int argc, char *argv[])
 
     initEvents();
     initMeasurements();
+    initLogger();
     initMenus();
 
     while (true)
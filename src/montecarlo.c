@@ -0,0 +1,462 @@
+/*
+ * FS2011 Pro
+ * Monte Carlo estimator benchmark
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../cubeide/Core/fs2011pro/confidence.h"
+#include "../cubeide/Core/fs2011pro/measurements.h"
+#include "../cubeide/Core/fs2011pro/settings.h"
+
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Runs many simulated devices on all cores, each with its own measurement
+// context, and reports for each rate:
+//
+// - the bias of the instantaneous and average rates,
+// - how often the true rate is within the displayed confidence intervals,
+// - the seconds the instantaneous rate takes to cover 90% of a rate step.
+//
+//   fs2011pro-montecarlo [-d devices] [-t seconds] [-j threads]
+//                        [-s seed] [-c 68|90|95|99]
+//
+// Pulses are a Poisson process with the tube's non-paralyzable dead time.
+// A run is deterministic for a given seed, whatever the thread number.
+
+#define MONTECARLO_DEVICES 200
+#define MONTECARLO_TIME 1000
+#define MONTECARLO_WARMUP_TIME 30
+#define MONTECARLO_STEP_TIME 120
+#define MONTECARLO_STEP_FRACTION 0.9
+
+#define MONTECARLO_TICK_PULSES_MAX 256
+#define MONTECARLO_TIME_PER_TICK (1000000 / TICK_FREQUENCY)
+
+static const double montecarloRates[] = {0.1, 1, 10, 100, 1000};
+
+typedef struct
+{
+    double rate;
+    double stepRate;
+    unsigned int time;
+} Scenario;
+
+typedef struct
+{
+    unsigned long long sampleNum;
+    double relativeSum;
+    unsigned long long coveredNum;
+} EstimatorStats;
+
+typedef struct
+{
+    EstimatorStats instantaneous;
+    EstimatorStats average;
+
+    unsigned long long stepNum;
+    unsigned long long stepMissNum;
+    double latencySum;
+    unsigned int latencyMax;
+} ScenarioStats;
+
+typedef struct
+{
+    const Scenario *scenario;
+    unsigned int firstDevice;
+    unsigned int deviceNum;
+    unsigned long long seed;
+
+    ScenarioStats stats;
+} Job;
+
+void onSDLTick()
+{
+}
+
+// xoshiro256**, seeded with splitmix64
+
+typedef struct
+{
+    unsigned long long s[4];
+} MontecarloRandom;
+
+unsigned long long rotateMontecarloRandom(unsigned long long x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+void seedMontecarloRandom(MontecarloRandom *random, unsigned long long seed)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        unsigned long long z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        random->s[i] = z ^ (z >> 31);
+    }
+}
+
+unsigned long long getMontecarloRandom(MontecarloRandom *random)
+{
+    unsigned long long *s = random->s;
+    unsigned long long result = rotateMontecarloRandom(s[1] * 5, 7) * 9;
+    unsigned long long t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotateMontecarloRandom(s[3], 45);
+
+    return result;
+}
+
+// Returns an exponential variate with mean 1
+double getMontecarloExponential(MontecarloRandom *random)
+{
+    return -log(((getMontecarloRandom(random) >> 11) + 0.5) * (1.0 / 9007199254740992.0));
+}
+
+double getRateValue(Rate rate)
+{
+#ifdef FIXED_POINT
+    return rate / (double)FIXED_ONE;
+#else
+    return rate;
+#endif
+}
+
+void addEstimatorSample(EstimatorStats *stats, double rate,
+                        Rate value, unsigned long long count)
+{
+    if (!value || !count)
+        return;
+
+    double measuredRate = getRateValue(value);
+
+    int lowerConfidenceInterval;
+    int upperConfidenceInterval;
+    getConfidenceIntervals((count > INT_MAX) ? INT_MAX : (unsigned int)count,
+                           &lowerConfidenceInterval, &upperConfidenceInterval);
+
+    stats->sampleNum++;
+    stats->relativeSum += measuredRate / rate - 1;
+    if ((rate >= measuredRate * (1 - lowerConfidenceInterval / 1000.0)) &&
+        (rate <= measuredRate * (1 + upperConfidenceInterval / 1000.0)))
+        stats->coveredNum++;
+}
+
+// Simulates one device; time is in us
+void runDevice(MeasurementContext *context, MontecarloRandom *random,
+               const Scenario *scenario, ScenarioStats *stats)
+{
+    unsigned short pulseDelays[MONTECARLO_TICK_PULSES_MAX];
+    unsigned int tickPulseCount = 0;
+    unsigned long long pulseTick = 0;
+
+    unsigned long long tick = 0;
+    unsigned int stepLatency = 0;
+    bool isStepped = false;
+    double stepThreshold = scenario->rate +
+                           MONTECARLO_STEP_FRACTION * (scenario->stepRate - scenario->rate);
+
+    double rate = scenario->rate;
+    double eventTime = getMontecarloExponential(random) * 1E6 / rate;
+    double deadTimeEnd = 0;
+
+    resetMeasurementContext(context);
+
+    for (unsigned int second = 0; second < scenario->time; second++)
+    {
+        unsigned long long secondEndTick = tick + TICK_FREQUENCY;
+        double secondEndTime = (double)secondEndTick * MONTECARLO_TIME_PER_TICK;
+
+        if (scenario->stepRate && (second == scenario->time - MONTECARLO_STEP_TIME))
+        {
+            // Memoryless: a new rate restarts the arrival process
+            rate = scenario->stepRate;
+            eventTime = (double)tick * MONTECARLO_TIME_PER_TICK +
+                        getMontecarloExponential(random) * 1E6 / rate;
+            isStepped = true;
+        }
+
+        while (eventTime < secondEndTime)
+        {
+            if (eventTime >= deadTimeEnd)
+            {
+                unsigned long long eventTick = (unsigned long long)(eventTime / MONTECARLO_TIME_PER_TICK);
+
+                if (tickPulseCount && (eventTick != pulseTick))
+                {
+                    skipMeasurementContextTicks(context, (unsigned int)(pulseTick - tick));
+                    onMeasurementContextTick(context, tickPulseCount, pulseDelays);
+                    tick = pulseTick + 1;
+                    tickPulseCount = 0;
+                }
+
+                // Delay from the pulse to the end of its tick
+                unsigned int offset = (unsigned int)(eventTime - (double)eventTick * MONTECARLO_TIME_PER_TICK);
+                pulseTick = eventTick;
+                if (tickPulseCount < MONTECARLO_TICK_PULSES_MAX)
+                    pulseDelays[tickPulseCount++] = MONTECARLO_TIME_PER_TICK - offset;
+
+                deadTimeEnd = eventTime + DEAD_TIME * 1E6;
+            }
+
+            eventTime += getMontecarloExponential(random) * 1E6 / rate;
+        }
+
+        if (tickPulseCount)
+        {
+            skipMeasurementContextTicks(context, (unsigned int)(pulseTick - tick));
+            onMeasurementContextTick(context, tickPulseCount, pulseDelays);
+            tick = pulseTick + 1;
+            tickPulseCount = 0;
+        }
+        skipMeasurementContextTicks(context, (unsigned int)(secondEndTick - tick));
+        tick = secondEndTick;
+
+        onMeasurementContextOneSecond(context);
+        updateMeasurementContext(context);
+
+        InstantaneousRate *instantaneousRate = &context->instantaneousRate;
+        AverageRate *averageRate = &context->averageRate;
+
+        if (!scenario->stepRate)
+        {
+            if (second >= MONTECARLO_WARMUP_TIME)
+                addEstimatorSample(&stats->instantaneous, rate,
+                                   instantaneousRate->snapshotValue,
+                                   instantaneousRate->snapshotCount);
+            addEstimatorSample(&stats->average, rate,
+                               averageRate->snapshotValue,
+                               averageRate->snapshotCount);
+        }
+        else if (isStepped && !stepLatency)
+        {
+            double value = getRateValue(instantaneousRate->snapshotValue);
+
+            if ((scenario->stepRate > scenario->rate) ? (value >= stepThreshold)
+                                                      : (value <= stepThreshold))
+                stepLatency = second - (scenario->time - MONTECARLO_STEP_TIME) + 1;
+        }
+    }
+
+    if (scenario->stepRate)
+    {
+        stats->stepNum++;
+        if (!stepLatency)
+            stats->stepMissNum++;
+        else
+        {
+            stats->latencySum += stepLatency;
+            if (stepLatency > stats->latencyMax)
+                stats->latencyMax = stepLatency;
+        }
+    }
+}
+
+void *runJob(void *argument)
+{
+    Job *job = argument;
+    MeasurementContext *context = malloc(sizeof(MeasurementContext));
+
+    memset(&job->stats, 0, sizeof(job->stats));
+
+    for (unsigned int i = 0; i < job->deviceNum; i++)
+    {
+        // One stream per device, so results do not depend on the threads
+        MontecarloRandom random;
+        seedMontecarloRandom(&random, job->seed ^ (0x100000001b3ULL * (job->firstDevice + i + 1)));
+
+        runDevice(context, &random, job->scenario, &job->stats);
+    }
+
+    free(context);
+
+    return NULL;
+}
+
+void addEstimatorStats(EstimatorStats *stats, const EstimatorStats *other)
+{
+    stats->sampleNum += other->sampleNum;
+    stats->relativeSum += other->relativeSum;
+    stats->coveredNum += other->coveredNum;
+}
+
+void runScenario(const Scenario *scenario, unsigned int deviceNum,
+                 unsigned int threadNum, unsigned long long seed,
+                 ScenarioStats *stats)
+{
+    Job jobs[threadNum];
+    pthread_t threads[threadNum];
+
+    unsigned int firstDevice = 0;
+    for (unsigned int i = 0; i < threadNum; i++)
+    {
+        jobs[i].scenario = scenario;
+        jobs[i].firstDevice = firstDevice;
+        jobs[i].deviceNum = deviceNum / threadNum + (i < (deviceNum % threadNum));
+        jobs[i].seed = seed;
+        firstDevice += jobs[i].deviceNum;
+
+        pthread_create(&threads[i], NULL, runJob, &jobs[i]);
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    for (unsigned int i = 0; i < threadNum; i++)
+    {
+        pthread_join(threads[i], NULL);
+
+        addEstimatorStats(&stats->instantaneous, &jobs[i].stats.instantaneous);
+        addEstimatorStats(&stats->average, &jobs[i].stats.average);
+        stats->stepNum += jobs[i].stats.stepNum;
+        stats->stepMissNum += jobs[i].stats.stepMissNum;
+        stats->latencySum += jobs[i].stats.latencySum;
+        if (jobs[i].stats.latencyMax > stats->latencyMax)
+            stats->latencyMax = jobs[i].stats.latencyMax;
+    }
+}
+
+double getBias(const EstimatorStats *stats)
+{
+    return stats->sampleNum ? 100 * stats->relativeSum / stats->sampleNum : 0;
+}
+
+double getCoverage(const EstimatorStats *stats)
+{
+    return stats->sampleNum ? 100.0 * stats->coveredNum / stats->sampleNum : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int deviceNum = MONTECARLO_DEVICES;
+    unsigned int time = MONTECARLO_TIME;
+    unsigned int threadNum = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long long seed = 1;
+    int level = 95;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d") && ((i + 1) < argc))
+            deviceNum = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && ((i + 1) < argc))
+            time = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-j") && ((i + 1) < argc))
+            threadNum = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && ((i + 1) < argc))
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-c") && ((i + 1) < argc))
+            level = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [-d devices] [-t seconds] [-j threads] [-s seed] [-c 68|90|95|99]\n",
+                    argv[0]);
+
+            return 2;
+        }
+    }
+
+    switch (level)
+    {
+    case 68:
+        setConfidenceLevel(CONFIDENCE_LEVEL_68);
+        break;
+
+    case 90:
+        setConfidenceLevel(CONFIDENCE_LEVEL_90);
+        break;
+
+    case 95:
+        setConfidenceLevel(CONFIDENCE_LEVEL_95);
+        break;
+
+    case 99:
+        setConfidenceLevel(CONFIDENCE_LEVEL_99);
+        break;
+
+    default:
+        fprintf(stderr, "confidence level must be 68, 90, 95 or 99\n");
+
+        return 2;
+    }
+
+    if (!threadNum)
+        threadNum = 1;
+    if (!deviceNum)
+        deviceNum = 1;
+    if (time <= (MONTECARLO_WARMUP_TIME + MONTECARLO_STEP_TIME))
+        time = MONTECARLO_WARMUP_TIME + MONTECARLO_STEP_TIME + 1;
+
+    unsigned int rateNum = sizeof(montecarloRates) / sizeof(montecarloRates[0]);
+    unsigned long long deviceSeconds = 0;
+    struct timespec startTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+    printf("%u devices x %u s per scenario, %u threads, seed %llu, %d%% confidence\n\n",
+           deviceNum, time, threadNum, seed, level);
+    printf("%-10s %12s %12s %12s %12s\n",
+           "rate (cps)", "inst. bias", "inst. cover", "avg. bias", "avg. cover");
+
+    for (unsigned int i = 0; i < rateNum; i++)
+    {
+        Scenario scenario = {montecarloRates[i], 0, time};
+        ScenarioStats stats;
+
+        runScenario(&scenario, deviceNum, threadNum, seed + i, &stats);
+        deviceSeconds += (unsigned long long)deviceNum * time;
+
+        printf("%-10g %11.2f%% %11.2f%% %11.3f%% %11.2f%%\n",
+               scenario.rate,
+               getBias(&stats.instantaneous), getCoverage(&stats.instantaneous),
+               getBias(&stats.average), getCoverage(&stats.average));
+    }
+
+    printf("\n%-10s %-10s %12s %12s %12s\n",
+           "step from", "to (cps)", "mean (s)", "max (s)", "missed");
+
+    for (unsigned int i = 0; i < rateNum; i++)
+    {
+        for (int direction = -1; direction <= 1; direction += 2)
+        {
+            unsigned int j = i + direction;
+            if (j >= rateNum)
+                continue;
+
+            Scenario scenario = {montecarloRates[i], montecarloRates[j],
+                                 MONTECARLO_WARMUP_TIME + MONTECARLO_STEP_TIME};
+            ScenarioStats stats;
+
+            runScenario(&scenario, deviceNum, threadNum, seed + rateNum + 2 * i + (direction > 0), &stats);
+            deviceSeconds += (unsigned long long)deviceNum * scenario.time;
+
+            unsigned long long stepHitNum = stats.stepNum - stats.stepMissNum;
+            printf("%-10g %-10g %12.1f %12u %11.1f%%\n",
+                   scenario.rate, scenario.stepRate,
+                   stepHitNum ? stats.latencySum / stepHitNum : 0,
+                   stats.latencyMax,
+                   100.0 * stats.stepMissNum / stats.stepNum);
+        }
+    }
+
+    struct timespec endTime;
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    double elapsedTime = (endTime.tv_sec - startTime.tv_sec) +
+                         1E-9 * (endTime.tv_nsec - startTime.tv_nsec);
+
+    printf("\n%llu device-seconds in %.1f s (%.0f device-seconds/s)\n",
+           deviceSeconds, elapsedTime, deviceSeconds / elapsedTime);
+
+    return 0;
+}
@@ -0,0 +1,569 @@
+/*
+ * FS2011 Pro
+ * Headless pulse log replay
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../cubeide/Core/fs2011pro/counter.h"
+#include "../cubeide/Core/fs2011pro/display.h"
+#include "../cubeide/Core/fs2011pro/events.h"
+#include "../cubeide/Core/fs2011pro/keyboard.h"
+#include "../cubeide/Core/fs2011pro/logger.h"
+#include "../cubeide/Core/fs2011pro/measurements.h"
+#include "../cubeide/Core/fs2011pro/menus.h"
+#include "../cubeide/Core/fs2011pro/power.h"
+#include "../cubeide/Core/fs2011pro/settings.h"
+#include "../cubeide/Core/fs2011pro/ui.h"
+
+#include "headless/headless.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define REPLAY_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Replays a log of pulse timestamps through the firmware, from the
+// headless virtual clock, and writes the measurements every second as
+// CSV, and the history buffers at the end:
+//
+//   fs2011pro-replay [-t seconds] [-o output.csv] [-H history.csv]
+//                    [-w output.bin] pulse-log
+//
+// Pulse logs are either CSV, with the time of a pulse in seconds in the
+// first column of each line (lines not starting with a number are
+// skipped), or binary: "FSPL" followed by the time from the previous
+// pulse (the first from 0), in microseconds, as ULEB128 varints. -w
+// converts a log to binary. Time 0 of the replay is the second of the
+// first pulse. The replay runs until the second after the last pulse, or
+// for -t seconds.
+//
+// Regular files are memory mapped; "-" reads the standard input.
+
+#define REPLAY_MAGIC "FSPL"
+#define REPLAY_MAGIC_SIZE 4
+#define REPLAY_BUFFER_SIZE 65536
+#define REPLAY_TOKEN_SIZE 64
+
+#define REPLAY_TICK_MICROSECONDS (1000000 / TICK_FREQUENCY)
+#define REPLAY_UI_TICKS 10
+
+typedef struct
+{
+    const unsigned char *data;
+    size_t size;
+    size_t index;
+
+    FILE *fp;
+    unsigned char *buffer;
+
+#ifdef REPLAY_MMAP
+    void *map;
+    size_t mapSize;
+#endif
+
+    bool isBinary;
+    unsigned long long lineIndex;
+    unsigned long long time;
+    unsigned long long origin;
+    bool isOriginSet;
+} PulseLog;
+
+void onSDLTick()
+{
+}
+
+double getRateValue(Rate rate)
+{
+#ifdef FIXED_POINT
+    return rate / (double)FIXED_ONE;
+#else
+    return rate;
+#endif
+}
+
+// Pulse log reader
+
+bool openPulseLog(PulseLog *log, const char *path)
+{
+    memset(log, 0, sizeof(PulseLog));
+
+    if (!strcmp(path, "-"))
+        log->fp = stdin;
+    else
+    {
+#ifdef REPLAY_MMAP
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat fileStat;
+        if (!fstat(fd, &fileStat) &&
+            S_ISREG(fileStat.st_mode) &&
+            (fileStat.st_size > 0))
+        {
+            void *map = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                madvise(map, fileStat.st_size, MADV_SEQUENTIAL);
+
+                log->map = map;
+                log->mapSize = fileStat.st_size;
+                log->data = map;
+                log->size = fileStat.st_size;
+            }
+        }
+
+        close(fd);
+
+        if (!log->map)
+#endif
+        {
+            log->fp = fopen(path, "rb");
+            if (!log->fp)
+                return false;
+        }
+    }
+
+    if (log->fp)
+    {
+        log->buffer = malloc(REPLAY_BUFFER_SIZE);
+        if (!log->buffer)
+            return false;
+
+        log->data = log->buffer;
+    }
+
+    return true;
+}
+
+void closePulseLog(PulseLog *log)
+{
+#ifdef REPLAY_MMAP
+    if (log->map)
+        munmap(log->map, log->mapSize);
+#endif
+
+    if (log->fp && (log->fp != stdin))
+        fclose(log->fp);
+
+    free(log->buffer);
+}
+
+// Returns the next byte, or -1 at the end
+static inline int getPulseLogByte(PulseLog *log)
+{
+    if (log->index >= log->size)
+    {
+        if (!log->fp)
+            return -1;
+
+        log->size = fread(log->buffer, 1, REPLAY_BUFFER_SIZE, log->fp);
+        log->index = 0;
+
+        if (!log->size)
+            return -1;
+    }
+
+    return log->data[log->index++];
+}
+
+static inline int peekPulseLogByte(PulseLog *log)
+{
+    int value = getPulseLogByte(log);
+    if (value >= 0)
+        log->index--;
+
+    return value;
+}
+
+bool readPulseLogHeader(PulseLog *log)
+{
+    unsigned int magicSize = 0;
+
+    while ((magicSize < REPLAY_MAGIC_SIZE) &&
+           (peekPulseLogByte(log) == REPLAY_MAGIC[magicSize]))
+    {
+        getPulseLogByte(log);
+        magicSize++;
+    }
+
+    if (magicSize == REPLAY_MAGIC_SIZE)
+    {
+        log->isBinary = true;
+
+        return true;
+    }
+
+    // A partial magic can only be the start of an invalid CSV line
+    return !magicSize;
+}
+
+// A truncated varint ends the log
+bool readBinaryPulse(PulseLog *log, unsigned long long *time)
+{
+    unsigned long long delta = 0;
+    int shift = 0;
+
+    while (true)
+    {
+        int value = getPulseLogByte(log);
+        if (value < 0)
+            return false;
+
+        if (shift < 64)
+            delta |= (unsigned long long)(value & 0x7f) << shift;
+        shift += 7;
+
+        if (!(value & 0x80))
+            break;
+    }
+
+    log->time += delta;
+    *time = log->time;
+
+    return true;
+}
+
+bool readCSVPulse(PulseLog *log, unsigned long long *time, bool *isValid)
+{
+    char token[REPLAY_TOKEN_SIZE];
+
+    while (true)
+    {
+        int value = getPulseLogByte(log);
+        if (value < 0)
+            return false;
+
+        log->lineIndex++;
+
+        unsigned int tokenSize = 0;
+        while ((value >= 0) && (value != '\n'))
+        {
+            if ((value == ',') || (value == ';') || (value == '\t') || (value == ' '))
+            {
+                if (tokenSize)
+                    break;
+            }
+            else if ((value != '\r') && (tokenSize < (REPLAY_TOKEN_SIZE - 1)))
+                token[tokenSize++] = value;
+
+            value = getPulseLogByte(log);
+        }
+
+        // Rest of the line
+        while ((value >= 0) && (value != '\n'))
+            value = getPulseLogByte(log);
+
+        token[tokenSize] = '\0';
+
+        if (!tokenSize ||
+            !(((token[0] >= '0') && (token[0] <= '9')) || (token[0] == '.')))
+            continue;
+
+        char *end;
+        double seconds = strtod(token, &end);
+        if (*end || (seconds < 0))
+        {
+            *isValid = false;
+
+            return false;
+        }
+
+        unsigned long long microseconds = (unsigned long long)(seconds * 1E6 + 0.5);
+        if (microseconds < log->time)
+        {
+            *isValid = false;
+
+            return false;
+        }
+
+        log->time = microseconds;
+        *time = microseconds;
+
+        return true;
+    }
+}
+
+// Returns the time of the next pulse from the start of the replay, in
+// microseconds
+bool readPulse(PulseLog *log, unsigned long long *time, bool *isValid)
+{
+    unsigned long long logTime;
+
+    if (log->isBinary)
+    {
+        if (!readBinaryPulse(log, &logTime))
+            return false;
+    }
+    else if (!readCSVPulse(log, &logTime, isValid))
+        return false;
+
+    if (!log->isOriginSet)
+    {
+        log->isOriginSet = true;
+        log->origin = logTime - logTime % 1000000;
+    }
+
+    *time = logTime - log->origin;
+
+    return true;
+}
+
+void writeBinaryPulse(FILE *fp, unsigned long long delta)
+{
+    do
+    {
+        unsigned char value = delta & 0x7f;
+        delta >>= 7;
+
+        fputc(delta ? (value | 0x80) : value, fp);
+    } while (delta);
+}
+
+// Replay
+
+void writeReplayHeader(FILE *fp)
+{
+    fprintf(fp, "time,counts,instantaneous,average,dose,"
+                "rate_alarm,dose_alarm,overload\n");
+}
+
+void writeReplayRecord(FILE *fp, unsigned long long tick, unsigned long long counts)
+{
+    InstantaneousRate *instantaneousRate = &measurementContext.instantaneousRate;
+    AverageRate *averageRate = &measurementContext.averageRate;
+    Dose *dose = &measurementContext.dose;
+
+    fprintf(fp, "%llu,%llu,%.6g,%.6g,%llu,%d,%d,%d\n",
+            tick / TICK_FREQUENCY,
+            counts,
+            getRateValue(instantaneousRate->snapshotValue),
+            getRateValue(averageRate->snapshotValue),
+            dose->correctedValue,
+            isInstantaneousRateAlarm(),
+            isDoseAlarm(),
+            instantaneousRate->isOverload || averageRate->isOverload);
+}
+
+bool writeReplayHistory(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "history,index,mean,min,max\n");
+
+    for (int i = 0; i < HISTORY_NUM; i++)
+    {
+        HistoryState *historyState = &measurementContext.historyStates[i];
+
+        for (int j = 0; j < HISTORY_BUFFER_SIZE; j++)
+        {
+            int bufferIndex = (HISTORY_BUFFER_SIZE + (historyState->bufferIndex - 1) - j) %
+                              HISTORY_BUFFER_SIZE;
+            HistoryDataPoint *dataPoint = &historyState->buffer[bufferIndex];
+
+            fprintf(fp, "%s,%d,%u,%u,%u\n",
+                    getHistoryName(i), j,
+                    dataPoint->mean, dataPoint->min, dataPoint->max);
+        }
+    }
+
+    fclose(fp);
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int time = 0;
+    const char *logPath = NULL;
+    const char *outputPath = NULL;
+    const char *historyPath = NULL;
+    const char *binaryPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-t") && ((i + 1) < argc))
+            time = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && ((i + 1) < argc))
+            outputPath = argv[++i];
+        else if (!strcmp(argv[i], "-H") && ((i + 1) < argc))
+            historyPath = argv[++i];
+        else if (!strcmp(argv[i], "-w") && ((i + 1) < argc))
+            binaryPath = argv[++i];
+        else if (!logPath && ((argv[i][0] != '-') || !strcmp(argv[i], "-")))
+            logPath = argv[i];
+        else
+        {
+            logPath = NULL;
+            break;
+        }
+    }
+
+    if (!logPath)
+    {
+        fprintf(stderr, "usage: %s [-t seconds] [-o output.csv] [-H history.csv] [-w output.bin] pulse-log\n",
+                argv[0]);
+
+        return 2;
+    }
+
+    PulseLog log;
+    if (!openPulseLog(&log, logPath) || !readPulseLogHeader(&log))
+    {
+        fprintf(stderr, "%s: cannot read\n", logPath);
+        closePulseLog(&log);
+
+        return 1;
+    }
+
+    FILE *fp = stdout;
+    if (outputPath)
+    {
+        fp = fopen(outputPath, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "%s: cannot write\n", outputPath);
+            closePulseLog(&log);
+
+            return 1;
+        }
+    }
+
+    FILE *binaryFp = NULL;
+    if (binaryPath)
+    {
+        binaryFp = fopen(binaryPath, "wb");
+        if (!binaryFp)
+        {
+            fprintf(stderr, "%s: cannot write\n", binaryPath);
+            closePulseLog(&log);
+
+            return 1;
+        }
+
+        fwrite(REPLAY_MAGIC, 1, REPLAY_MAGIC_SIZE, binaryFp);
+    }
+
+    initKeyboard();
+    initPower();
+    initDisplay();
+
+    readSettings();
+
+    initEvents();
+    initMeasurements();
+    initLogger();
+    initMenus();
+
+    writeReplayHeader(fp);
+
+    clock_t startTime = clock();
+
+    unsigned long long endTick = (unsigned long long)time * TICK_FREQUENCY;
+    unsigned long long pulseNum = 0;
+    unsigned long long droppedPulseNum = 0;
+    unsigned long long secondCounts = 0;
+    unsigned long long lastPulseTime = 0;
+
+    bool isValid = true;
+    unsigned long long pulseTime;
+    bool isPulse = readPulse(&log, &pulseTime, &isValid);
+
+    for (unsigned long long tick = 1;; tick++)
+    {
+        unsigned long long tickEndTime = tick * REPLAY_TICK_MICROSECONDS;
+
+        // The counter captures COUNTER_CAPTURE_NUM - 1 pulses per tick
+        unsigned int tickPulseNum = 0;
+
+        while (isPulse && (pulseTime < tickEndTime))
+        {
+            if (binaryFp)
+                writeBinaryPulse(binaryFp, (pulseNum ? pulseTime - lastPulseTime : pulseTime + log.origin));
+
+#ifdef PULSE_COUNTER
+            // Delay before the next tick
+            if (tickPulseNum >= (COUNTER_CAPTURE_NUM - 1))
+                droppedPulseNum++;
+            else
+            {
+                simCounterPulse((unsigned short)(tickEndTime - pulseTime));
+                tickPulseNum++;
+            }
+#else
+            triggerPulse();
+            tickPulseNum++;
+#endif
+
+            pulseNum++;
+            lastPulseTime = pulseTime;
+
+            isPulse = readPulse(&log, &pulseTime, &isValid);
+        }
+
+        secondCounts += tickPulseNum;
+
+        addHeadlessTicks(1);
+        onEventsTick();
+
+        bool isSecond = !(tick % TICK_FREQUENCY);
+
+        if (isSecond || !(tick % REPLAY_UI_TICKS))
+            updateUI();
+
+        if (isSecond)
+        {
+            writeReplayRecord(fp, tick, secondCounts);
+            secondCounts = 0;
+
+            if (endTick ? (tick >= endTick) : !isPulse)
+                break;
+        }
+    }
+
+    clock_t endTime = clock();
+
+    closePulseLog(&log);
+
+    if (outputPath)
+        fclose(fp);
+
+    int result = 0;
+
+    if (!isValid)
+    {
+        fprintf(stderr, "%s:%llu: invalid or out-of-order timestamp\n", logPath, log.lineIndex);
+
+        result = 1;
+    }
+
+    if (binaryFp)
+        fclose(binaryFp);
+
+    if (historyPath && !writeReplayHistory(historyPath))
+    {
+        fprintf(stderr, "%s: cannot write\n", historyPath);
+
+        result = 1;
+    }
+
+    fprintf(stderr, "%llu pulses", pulseNum);
+    if (droppedPulseNum)
+        fprintf(stderr, " (%llu dropped by the counter capture)", droppedPulseNum);
+    fprintf(stderr, " replayed in %.2f s\n", (double)(endTime - startTime) / CLOCKS_PER_SEC);
+
+    return result;
+}
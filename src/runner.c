@@ -0,0 +1,377 @@
+/*
+ * FS2011 Pro
+ * Headless virtual-clock runner
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../cubeide/Core/fs2011pro/display.h"
+#include "../cubeide/Core/fs2011pro/events.h"
+#include "../cubeide/Core/fs2011pro/keyboard.h"
+#include "../cubeide/Core/fs2011pro/logger.h"
+#include "../cubeide/Core/fs2011pro/measurements.h"
+#include "../cubeide/Core/fs2011pro/menus.h"
+#include "../cubeide/Core/fs2011pro/power.h"
+#include "../cubeide/Core/fs2011pro/settings.h"
+#include "../cubeide/Core/fs2011pro/sim.h"
+#include "../cubeide/Core/fs2011pro/ui.h"
+
+#include "headless/SDL.h"
+#include "headless/headless.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Runs the device from a virtual clock, as fast as the host allows, and
+// writes the measurements as CSV:
+//
+//   fs2011pro-runner [-t seconds] [-s scenario] [-k key-script]
+//                    [-i interval] [-o output.csv] [-H history.csv]
+//                    [-f frame.pbm]
+//
+// The scenario is a sim.c scenario file; without one, the rate is
+// 0.1 uSv/h. Key scripts have one key press per line, ordered by time:
+//
+//   # time (s), key (power, up, down, select, back), duration (s)
+//   10 select
+//   20 back 0.6
+//
+// Power off (a long power press) would stop the device, so it is not
+// allowed. The history file holds every history buffer, newest data
+// point first, and the frame is the display at the end of the run.
+
+#define RUNNER_TIME (24 * 60 * 60)
+#define RUNNER_INTERVAL 1
+#define RUNNER_UI_TICKS 10
+
+#define RUNNER_KEY_NUM 1024
+#define RUNNER_KEY_TIME 0.1F
+#define RUNNER_POWER_OFF_TIME 1.0F
+
+typedef struct
+{
+    unsigned long long tick;
+    unsigned short scancode;
+    bool isDown;
+} RunnerKey;
+
+static const struct
+{
+    const char *name;
+    unsigned short scancode;
+} runnerKeyNames[] = {
+    {"power", SDL_SCANCODE_SPACE},
+    {"up", SDL_SCANCODE_UP},
+    {"down", SDL_SCANCODE_DOWN},
+    {"select", SDL_SCANCODE_RIGHT},
+    {"back", SDL_SCANCODE_LEFT},
+};
+
+struct
+{
+    RunnerKey keys[2 * RUNNER_KEY_NUM];
+    unsigned int keyNum;
+    unsigned int keyIndex;
+
+    unsigned long long lastLifeCounts;
+} runner;
+
+void onSDLTick()
+{
+}
+
+double getRateValue(Rate rate)
+{
+#ifdef FIXED_POINT
+    return rate / (double)FIXED_ONE;
+#else
+    return rate;
+#endif
+}
+
+int compareRunnerKeys(const void *a, const void *b)
+{
+    const RunnerKey *keyA = a;
+    const RunnerKey *keyB = b;
+
+    if (keyA->tick != keyB->tick)
+        return (keyA->tick < keyB->tick) ? -1 : 1;
+
+    // Releases first
+    return (int)keyA->isDown - (int)keyB->isDown;
+}
+
+bool readRunnerKeys(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "%s: cannot read\n", path);
+
+        return false;
+    }
+
+    char line[256];
+    unsigned int lineIndex = 0;
+    float lastTime = 0;
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        lineIndex++;
+
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+
+        float time;
+        char name[16];
+        float duration = RUNNER_KEY_TIME;
+
+        int n = sscanf(line, "%f %15s %f", &time, name, &duration);
+        if (n <= 0)
+            continue;
+
+        int keyIndex = -1;
+        for (unsigned int i = 0; i < sizeof(runnerKeyNames) / sizeof(runnerKeyNames[0]); i++)
+            if (!strcmp(name, runnerKeyNames[i].name))
+                keyIndex = i;
+
+        if ((n < 2) ||
+            (keyIndex < 0) ||
+            (time < lastTime) ||
+            (duration <= 0) ||
+            ((runnerKeyNames[keyIndex].scancode == SDL_SCANCODE_SPACE) &&
+             (duration >= RUNNER_POWER_OFF_TIME)) ||
+            (runner.keyNum >= 2 * RUNNER_KEY_NUM))
+        {
+            fprintf(stderr, "%s:%u: invalid key\n", path, lineIndex);
+            fclose(fp);
+
+            return false;
+        }
+
+        lastTime = time;
+
+        unsigned long long pressTick = (unsigned long long)(time * TICK_FREQUENCY + 0.5F);
+        unsigned long long releaseTick = pressTick +
+                                         (unsigned long long)(duration * TICK_FREQUENCY + 0.5F);
+
+        RunnerKey *key = &runner.keys[runner.keyNum++];
+        key->tick = pressTick;
+        key->scancode = runnerKeyNames[keyIndex].scancode;
+        key->isDown = true;
+
+        key = &runner.keys[runner.keyNum++];
+        key->tick = releaseTick;
+        key->scancode = runnerKeyNames[keyIndex].scancode;
+        key->isDown = false;
+    }
+
+    fclose(fp);
+
+    qsort(runner.keys, runner.keyNum, sizeof(RunnerKey), compareRunnerKeys);
+
+    return true;
+}
+
+void updateRunnerKeys(unsigned long long tick)
+{
+    while ((runner.keyIndex < runner.keyNum) &&
+           (runner.keys[runner.keyIndex].tick <= tick))
+    {
+        RunnerKey *key = &runner.keys[runner.keyIndex++];
+
+        setHeadlessKey(key->scancode, key->isDown);
+    }
+}
+
+void writeRunnerHeader(FILE *fp)
+{
+    fprintf(fp, "time,rate,counts,instantaneous,average,dose,"
+                "rate_alarm,dose_alarm,overload,event_overflows,view\n");
+}
+
+void writeRunnerRecord(FILE *fp, unsigned long long tick)
+{
+    InstantaneousRate *instantaneousRate = &measurementContext.instantaneousRate;
+    AverageRate *averageRate = &measurementContext.averageRate;
+    Dose *dose = &measurementContext.dose;
+
+    unsigned int eventOverflows = 0;
+    for (int i = 0; i < EVENT_NUM; i++)
+        eventOverflows += getEventsOverflowCount(i);
+
+    fprintf(fp, "%.3f,%.6g,%llu,%.6g,%.6g,%llu,%d,%d,%d,%u,%d\n",
+            (double)tick / TICK_FREQUENCY,
+            getSimRate(),
+            settings.lifeCounts - runner.lastLifeCounts,
+            getRateValue(instantaneousRate->snapshotValue),
+            getRateValue(averageRate->snapshotValue),
+            dose->correctedValue,
+            isInstantaneousRateAlarm(),
+            isDoseAlarm(),
+            instantaneousRate->isOverload || averageRate->isOverload,
+            eventOverflows,
+            getView());
+
+    runner.lastLifeCounts = settings.lifeCounts;
+}
+
+bool writeRunnerHistory(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "history,index,mean,min,max\n");
+
+    for (int i = 0; i < HISTORY_NUM; i++)
+    {
+        HistoryState *historyState = &measurementContext.historyStates[i];
+
+        for (int j = 0; j < HISTORY_BUFFER_SIZE; j++)
+        {
+            int bufferIndex = (HISTORY_BUFFER_SIZE + (historyState->bufferIndex - 1) - j) %
+                              HISTORY_BUFFER_SIZE;
+            HistoryDataPoint *dataPoint = &historyState->buffer[bufferIndex];
+
+            fprintf(fp, "%s,%d,%u,%u,%u\n",
+                    getHistoryName(i), j,
+                    dataPoint->mean, dataPoint->min, dataPoint->max);
+        }
+    }
+
+    fclose(fp);
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int time = RUNNER_TIME;
+    unsigned int interval = RUNNER_INTERVAL;
+    const char *scenarioPath = NULL;
+    const char *keysPath = NULL;
+    const char *outputPath = NULL;
+    const char *historyPath = NULL;
+    const char *framePath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-t") && ((i + 1) < argc))
+            time = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && ((i + 1) < argc))
+            scenarioPath = argv[++i];
+        else if (!strcmp(argv[i], "-k") && ((i + 1) < argc))
+            keysPath = argv[++i];
+        else if (!strcmp(argv[i], "-i") && ((i + 1) < argc))
+            interval = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && ((i + 1) < argc))
+            outputPath = argv[++i];
+        else if (!strcmp(argv[i], "-H") && ((i + 1) < argc))
+            historyPath = argv[++i];
+        else if (!strcmp(argv[i], "-f") && ((i + 1) < argc))
+            framePath = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [-t seconds] [-s scenario] [-k key-script] [-i interval]\n"
+                            "       [-o output.csv] [-H history.csv] [-f frame.pbm]\n",
+                    argv[0]);
+
+            return 2;
+        }
+    }
+
+    if (!interval)
+        interval = 1;
+
+    initSim(SIM_SEED);
+    if (scenarioPath)
+    {
+        if (!readSimScenario(scenarioPath))
+            return 1;
+    }
+    else
+        setSimRate(0.1F * CPM_PER_USVH / 60);
+
+    if (keysPath && !readRunnerKeys(keysPath))
+        return 1;
+
+    FILE *fp = stdout;
+    if (outputPath)
+    {
+        fp = fopen(outputPath, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "%s: cannot write\n", outputPath);
+
+            return 1;
+        }
+    }
+
+    initKeyboard();
+    initPower();
+    initDisplay();
+
+    readSettings();
+
+    initEvents();
+    initMeasurements();
+    initLogger();
+    initMenus();
+
+    writeRunnerHeader(fp);
+
+    clock_t startTime = clock();
+
+    unsigned long long ticks = (unsigned long long)time * TICK_FREQUENCY;
+    unsigned long long intervalTicks = (unsigned long long)interval * TICK_FREQUENCY;
+
+    for (unsigned long long tick = 1; tick <= ticks; tick++)
+    {
+        updateRunnerKeys(tick);
+
+        onSimTick();
+        addHeadlessTicks(1);
+        onEventsTick();
+
+        bool isRecorded = !(tick % intervalTicks);
+
+        if (isRecorded || !(tick % RUNNER_UI_TICKS))
+            updateUI();
+
+        if (isRecorded)
+            writeRunnerRecord(fp, tick);
+    }
+
+    clock_t endTime = clock();
+
+    if (outputPath)
+        fclose(fp);
+
+    int result = 0;
+
+    if (historyPath && !writeRunnerHistory(historyPath))
+    {
+        fprintf(stderr, "%s: cannot write\n", historyPath);
+
+        result = 1;
+    }
+
+    if (framePath && !writeHeadlessFrame(framePath))
+    {
+        fprintf(stderr, "%s: cannot write\n", framePath);
+
+        result = 1;
+    }
+
+    double wallTime = (double)(endTime - startTime) / CLOCKS_PER_SEC;
+    fprintf(stderr, "%u s of device time in %.2f s (%.0fx)\n",
+            time, wallTime, wallTime > 0 ? time / wallTime : 0);
+
+    return result;
+}
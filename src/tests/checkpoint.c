@@ -0,0 +1,257 @@
+/*
+ * FS2011 Pro
+ * Measurement checkpoint power cycle test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/events.h"
+#include "../../cubeide/Core/fs2011pro/measurements.h"
+#include "../../cubeide/Core/fs2011pro/settings.h"
+#include "../../cubeide/Core/fs2011pro/trace.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// Runs the measurements through thousands of power cycles of random
+// length and rate. Half of the cycles end with the power off checkpoint,
+// which must restore the dose, the average rate and the checkpointed
+// histories exactly. The others end with a power loss, which may tear the
+// flash writes of the last second: the restored dose must not exceed the
+// true dose and may only lag by the checkpoint policy in measurements.c,
+// and the history data points must match except for the unwritten batch.
+// The erases of each checkpoint page give the flash lifetime. A snapshot
+// must fit its flash programs in a quarter of the trace ring.
+
+#define CHECKPOINT_CYCLE_NUM 2000
+#define CHECKPOINT_RUN_TIME_MAX (4 * 3600)
+
+// Flash pages of the checkpoint banks (checkpoint.c)
+#define CHECKPOINT_PAGE_START 0x30
+#define CHECKPOINT_PAGE_END 0x38
+
+// Flash endurance (erase cycles)
+#define CHECKPOINT_ENDURANCE 10000
+#define CHECKPOINT_LIFETIME_MIN_YEARS 2
+
+// Flash programs per snapshot, each traces 2 of the 128 trace records
+#define CHECKPOINT_SNAPSHOT_PROGRAM_MAX 16
+
+// Dose loss allowed by the policy (pulses, s): the larger of 64 pulses and
+// 1/64 of the dose, plus the pulses of the last minute and the torn second
+#define CHECKPOINT_LOSS_PULSES_MIN 64
+#define CHECKPOINT_LOSS_SHIFT 6
+#define CHECKPOINT_LOSS_TIME 62
+
+// History data points completed since the last batch (s)
+#define CHECKPOINT_HISTORY_PERIOD (3 * 60 + 1)
+
+static const unsigned int historyIntervals[HISTORY_NUM] = {1, 5, 30, 180, 720};
+
+struct
+{
+    unsigned int pulseCounts[CHECKPOINT_LOSS_TIME];
+    unsigned long long time;
+
+    unsigned int cleanNum;
+    unsigned int lossNum;
+    unsigned int tornNum;
+    unsigned long long pulseNum;
+    unsigned long long lostPulseNum;
+} checkpointTest;
+
+void checkCheckpoint(bool isValid, const char *message, unsigned int cycle)
+{
+    checkTest(isValid, "cycle %u: %s", cycle, message);
+}
+
+// One second of measurements at rate (cps)
+void runCheckpointSecond(float rate)
+{
+    unsigned int pulseCount = (unsigned int)(rate * (getTestRandom() % 1024) / 512);
+
+    onMeasurementTick(pulseCount, NULL);
+    skipMeasurementTicks(TICK_FREQUENCY - 1);
+    onMeasurementOneSecond();
+    updateMeasurements();
+
+    checkpointTest.pulseCounts[checkpointTest.time % CHECKPOINT_LOSS_TIME] = pulseCount;
+    checkpointTest.time++;
+    checkpointTest.pulseNum += pulseCount;
+}
+
+unsigned int getFlashOperationCount()
+{
+    return getTraceCount(TRACE_FLASH_ERASE_START) +
+           getTraceCount(TRACE_FLASH_PROGRAM_START);
+}
+
+void checkHistories(const MeasurementContext *context, bool isExact, unsigned int cycle)
+{
+    for (unsigned int i = HISTORY_1H; i < HISTORY_NUM; i++)
+    {
+        const HistoryState *historyState = &context->historyStates[i];
+        const HistoryState *restoredState = &measurementContext.historyStates[i];
+
+        unsigned int pendingNum = (HISTORY_BUFFER_SIZE +
+                                   historyState->bufferIndex -
+                                   restoredState->bufferIndex) %
+                                  HISTORY_BUFFER_SIZE;
+        unsigned int pendingNumMax = isExact ? 0 : CHECKPOINT_HISTORY_PERIOD / historyIntervals[i] + 1;
+
+        checkCheckpoint(pendingNum <= pendingNumMax, "history data points lost", cycle);
+
+        for (unsigned int j = 0; j < HISTORY_BUFFER_SIZE; j++)
+        {
+            // Data points of the unwritten batch
+            if (((HISTORY_BUFFER_SIZE + j - restoredState->bufferIndex) % HISTORY_BUFFER_SIZE) < pendingNum)
+                continue;
+
+            const HistoryDataPoint *dataPoint = &historyState->buffer[j];
+            const HistoryDataPoint *restoredDataPoint = &restoredState->buffer[j];
+
+            checkCheckpoint((dataPoint->mean == restoredDataPoint->mean) &&
+                                (dataPoint->min == restoredDataPoint->min) &&
+                                (dataPoint->max == restoredDataPoint->max),
+                            "history data point differs", cycle);
+        }
+
+        if (isExact)
+            checkCheckpoint(historyState->sampleNum == restoredState->sampleNum,
+                            "history samples differ", cycle);
+    }
+}
+
+int main()
+{
+    static MeasurementContext context;
+
+    initMeasurements();
+
+    for (unsigned int cycle = 0; cycle < CHECKPOINT_CYCLE_NUM; cycle++)
+    {
+        // Log-uniform rates from 0.01 to 1000 cps
+        float rate = 0.01F;
+        for (unsigned int i = getTestRandom() % 16; i; i--)
+            rate *= 2.154F;
+
+        unsigned int runTime = 1 + getTestRandom() % CHECKPOINT_RUN_TIME_MAX;
+        bool isPowerLoss = getTestRandom() & 1;
+
+        if (!(getTestRandom() % 64))
+            resetDose();
+
+        for (unsigned int i = 0; i < runTime; i++)
+            runCheckpointSecond(rate);
+
+        if (!isPowerLoss)
+        {
+            writeMeasurementCheckpoint(true);
+
+            checkpointTest.cleanNum++;
+        }
+        else
+        {
+            // The power fails within the first second with flash writes,
+            // or after the batch period
+            for (unsigned int i = 0; i < CHECKPOINT_HISTORY_PERIOD; i++)
+            {
+                unsigned int operationCount = getFlashOperationCount();
+
+                setSettingsWriteLimit(getTestRandom() % 1024);
+                runCheckpointSecond(rate);
+
+                if (getFlashOperationCount() != operationCount)
+                {
+                    checkpointTest.tornNum++;
+
+                    break;
+                }
+
+                setSettingsWriteLimit(-1);
+            }
+
+            checkpointTest.lossNum++;
+        }
+
+        context = measurementContext;
+
+        // Power cycle
+        setSettingsWriteLimit(-1);
+        initMeasurements();
+
+        unsigned long long dose = context.dose.pulseCount;
+        unsigned long long restoredDose = measurementContext.dose.pulseCount;
+
+        if (!isPowerLoss)
+        {
+            checkCheckpoint(restoredDose == dose, "dose differs", cycle);
+            checkCheckpoint(measurementContext.averageRate.pulseCount ==
+                                context.averageRate.pulseCount,
+                            "average rate differs", cycle);
+        }
+        else
+        {
+            unsigned long long lossMax = dose >> CHECKPOINT_LOSS_SHIFT;
+            if (lossMax < CHECKPOINT_LOSS_PULSES_MIN)
+                lossMax = CHECKPOINT_LOSS_PULSES_MIN;
+            for (unsigned int i = 0; i < CHECKPOINT_LOSS_TIME; i++)
+                lossMax += checkpointTest.pulseCounts[i];
+
+            checkCheckpoint(restoredDose <= dose, "dose restored above the true dose", cycle);
+            checkCheckpoint((dose - restoredDose) <= lossMax, "dose lost", cycle);
+
+            if (restoredDose <= dose)
+                checkpointTest.lostPulseNum += dose - restoredDose;
+        }
+
+        checkHistories(&context, !isPowerLoss, cycle);
+    }
+
+    unsigned int eraseNumMin = ~0U;
+    unsigned int eraseNumMax = 0;
+    for (unsigned int i = CHECKPOINT_PAGE_START; i < CHECKPOINT_PAGE_END; i++)
+    {
+        unsigned int eraseNum = getSettingsEraseCount(i);
+
+        if (eraseNum < eraseNumMin)
+            eraseNumMin = eraseNum;
+        if (eraseNum > eraseNumMax)
+            eraseNumMax = eraseNum;
+    }
+
+    double hours = checkpointTest.time / 3600.0;
+    double lifetimeYears = eraseNumMax
+                               ? CHECKPOINT_ENDURANCE * hours / eraseNumMax / (24 * 365)
+                               : 0;
+
+    printf("%u power cycles: %u power offs, %u power losses (%u during flash writes)\n",
+           CHECKPOINT_CYCLE_NUM, checkpointTest.cleanNum,
+           checkpointTest.lossNum, checkpointTest.tornNum);
+    printf("%.0f h, %llu pulses, %llu lost to power losses\n",
+           hours, checkpointTest.pulseNum, checkpointTest.lostPulseNum);
+    printf("checkpoint page erases: %u to %u, %.1f h per erase\n",
+           eraseNumMin, eraseNumMax, eraseNumMax ? hours / eraseNumMax : 0);
+    printf("flash lifetime at %u erases, continuous use: %.1f years\n",
+           CHECKPOINT_ENDURANCE, lifetimeYears);
+
+    checkTest(lifetimeYears >= CHECKPOINT_LIFETIME_MIN_YEARS,
+              "checkpoint flash lifetime below %u years", CHECKPOINT_LIFETIME_MIN_YEARS);
+
+    // A dose reset writes a snapshot
+    unsigned int programCount = getTraceCount(TRACE_FLASH_PROGRAM_START);
+    resetDose();
+    writeMeasurementCheckpoint(false);
+    programCount = getTraceCount(TRACE_FLASH_PROGRAM_START) - programCount;
+
+    printf("flash programs per snapshot: %u\n", programCount);
+
+    checkTest(programCount <= CHECKPOINT_SNAPSHOT_PROGRAM_MAX,
+              "%u flash programs per snapshot", programCount);
+
+    return endTest();
+}
@@ -0,0 +1,380 @@
+/*
+ * FS2011 Pro
+ * Decimal exponent and scaling test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/cmath.h"
+
+#include "test.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Sweeps every binary exponent of the positive floats, the floats next to
+// each decade boundary, and the fixed-point products of every shift, and
+// compares getExponent(), getPowerOfTen(), getFloatDecimal(),
+// getFixedExponent() and getFixedDecimal() with an exact 128-bit integer
+// reference. Then reports the time per call.
+
+#define CMATH_MANTISSA_NUM 1024
+#define CMATH_BOUNDARY_ULPS 8
+#define CMATH_PRODUCT_NUM 2048
+#define CMATH_BENCHMARK_NUM 2000000
+
+#define CMATH_POWER_OF_TEN_MIN -45
+#define CMATH_POWER_OF_TEN_MAX 38
+#define CMATH_FLOAT_DECIMAL_POWER_MIN -19
+#define CMATH_FLOAT_DECIMAL_POWER_MAX 9
+#define CMATH_FIXED_POWER_MAX 19
+
+typedef unsigned __int128 uint128;
+
+void checkCMath(bool isValid, const char *function, const char *input)
+{
+    checkTest(isValid, "%s(%s) differs", function, input);
+}
+
+float getFloat(unsigned int bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+// value = mantissa * 2^exponent
+void splitFloat(float value, unsigned int *mantissa, int *exponent)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    int biasedExponent = bits >> 23;
+    *mantissa = bits & 0x7fffff;
+    if (biasedExponent)
+        *mantissa |= 0x800000;
+    else
+        biasedExponent = 1;
+
+    *exponent = biasedExponent - 150;
+}
+
+uint128 getPower(unsigned int base, int power)
+{
+    uint128 result = 1;
+    for (int i = 0; i < power; i++)
+        result *= base;
+
+    return result;
+}
+
+int getBitNum(uint128 value)
+{
+    int bitNum = 0;
+    for (; value; value >>= 1)
+        bitNum++;
+
+    return bitNum;
+}
+
+// Exact: value >= 10^power, power from -45 to 38
+bool isAtLeastPowerOfTenExact(float value, int power)
+{
+    unsigned int mantissa;
+    int exponent;
+    splitFloat(value, &mantissa, &exponent);
+
+    if (power >= 0)
+    {
+        uint128 powerOfTen = getPower(10, power);
+
+        if (exponent >= 0)
+            return ((uint128)mantissa << exponent) >= powerOfTen;
+
+        if (-exponent > (127 - getBitNum(powerOfTen)))
+            return false;
+
+        return mantissa >= (powerOfTen << -exponent);
+    }
+    else
+    {
+        // mantissa * 5^-power * 2^(exponent - power) >= 1
+        uint128 scaled = mantissa * getPower(5, -power);
+        int shift = exponent - power;
+
+        if (shift >= 0)
+            return scaled != 0;
+        if (-shift >= 128)
+            return false;
+
+        return scaled >= ((uint128)1 << -shift);
+    }
+}
+
+int getExponentExact(float value)
+{
+    int power = (int)floor(log10(value));
+
+    while ((power < CMATH_POWER_OF_TEN_MAX) && isAtLeastPowerOfTenExact(value, power + 1))
+        power++;
+    while ((power > CMATH_POWER_OF_TEN_MIN) && !isAtLeastPowerOfTenExact(value, power))
+        power--;
+
+    return power;
+}
+
+// Exact value * 10^power, truncated or rounded; false outside the
+// getFloatDecimal() contract: the value and the result must fit in 63 bits
+bool getFloatDecimalExact(float value, int power, bool isRounded,
+                          unsigned long long *result)
+{
+    if (value >= 9223372036854775808.0F)
+        return false;
+
+    unsigned int mantissa;
+    int exponent;
+    splitFloat(value, &mantissa, &exponent);
+
+    // value * 10^power = numerator / denominator
+    uint128 numerator = mantissa;
+    uint128 denominator = 1;
+
+    if (power >= 0)
+        numerator *= getPower(10, power);
+    else
+        denominator = getPower(10, -power);
+
+    if (exponent >= 0)
+    {
+        if (getBitNum(numerator) + exponent > 126)
+            return false;
+
+        numerator <<= exponent;
+    }
+    else
+    {
+        if (getBitNum(denominator) - exponent > 126)
+        {
+            *result = 0;
+
+            return true;
+        }
+
+        denominator <<= -exponent;
+    }
+
+    uint128 quotient = isRounded
+                           ? (2 * numerator + denominator) / (2 * denominator)
+                           : numerator / denominator;
+    if (quotient >> 63)
+        return false;
+
+    *result = (unsigned long long)quotient;
+
+    return true;
+}
+
+// Exact floor(log10(product / 2^shift))
+int getFixedExponentExact(unsigned long long product, int shift)
+{
+    int power = 0;
+
+    while ((power < CMATH_FIXED_POWER_MAX) &&
+           ((uint128)product >= (getPower(10, power + 1) << shift)))
+        power++;
+    while ((power > -CMATH_FIXED_POWER_MAX) &&
+           ((power >= 0)
+                ? ((uint128)product < (getPower(10, power) << shift))
+                : (((uint128)product * getPower(10, -power)) < ((uint128)1 << shift))))
+        power--;
+
+    return power;
+}
+
+// Exact product / 2^shift * 10^power, truncated or rounded; false outside
+// the getFixedDecimal() contract: product * 10^power and the rounding must
+// fit in 64 bits, and rounding needs a shift
+bool getFixedDecimalExact(unsigned long long product, int shift, int power,
+                          bool isRounded, unsigned long long *result)
+{
+    if (isRounded && !shift && (power < 0))
+        return false;
+
+    uint128 numerator = product;
+    uint128 denominator = (uint128)1 << shift;
+
+    if (power >= 0)
+    {
+        numerator *= getPower(10, power);
+        if ((numerator + (denominator >> 1)) >> 64)
+            return false;
+    }
+    else
+        denominator *= getPower(10, -power);
+
+    *result = (unsigned long long)(isRounded
+                                       ? (2 * numerator + denominator) / (2 * denominator)
+                                       : numerator / denominator);
+
+    return true;
+}
+
+void checkFloat(float value)
+{
+    char input[64];
+
+    snprintf(input, sizeof(input), "%.9g", value);
+    checkCMath(getExponent(value) == getExponentExact(value), "getExponent", input);
+
+    for (int power = CMATH_FLOAT_DECIMAL_POWER_MIN; power <= CMATH_FLOAT_DECIMAL_POWER_MAX; power++)
+    {
+        for (int isRounded = 0; isRounded < 2; isRounded++)
+        {
+            unsigned long long result;
+            if (!getFloatDecimalExact(value, power, isRounded, &result))
+                continue;
+
+            snprintf(input, sizeof(input), "%.9g, %d, %d", value, power, isRounded);
+            checkCMath(getFloatDecimal(value, power, isRounded) == result,
+                       "getFloatDecimal", input);
+        }
+    }
+}
+
+void checkFixed(unsigned long long product, int shift)
+{
+    char input[64];
+
+    snprintf(input, sizeof(input), "%llu, %d", product, shift);
+    checkCMath(getFixedExponent(product, shift) == getFixedExponentExact(product, shift),
+               "getFixedExponent", input);
+
+    for (int power = -CMATH_FIXED_POWER_MAX; power <= CMATH_FIXED_POWER_MAX; power++)
+    {
+        for (int isRounded = 0; isRounded < 2; isRounded++)
+        {
+            unsigned long long result;
+            if (!getFixedDecimalExact(product, shift, power, isRounded, &result))
+                continue;
+
+            snprintf(input, sizeof(input), "%llu, %d, %d, %d", product, shift, power, isRounded);
+            checkCMath(getFixedDecimal(product, shift, power, isRounded) == result,
+                       "getFixedDecimal", input);
+        }
+    }
+}
+
+int main()
+{
+    // Powers of ten: correctly rounded, as strtof() is
+    for (int power = CMATH_POWER_OF_TEN_MIN; power <= CMATH_POWER_OF_TEN_MAX; power++)
+    {
+        char input[16];
+        snprintf(input, sizeof(input), "1E%d", power);
+
+        checkCMath(getPowerOfTen(power) == strtof(input, NULL), "getPowerOfTen", input);
+    }
+
+    // Every binary exponent, random mantissas
+    for (unsigned int exponent = 0; exponent < 255; exponent++)
+        for (unsigned int i = 0; i < CMATH_MANTISSA_NUM; i++)
+        {
+            unsigned int mantissa = getTestRandomLong() & 0x7fffff;
+            if (!exponent && !mantissa)
+                continue;
+
+            checkFloat(getFloat((exponent << 23) | mantissa));
+        }
+
+    // The floats next to each decade boundary
+    for (int power = CMATH_POWER_OF_TEN_MIN; power <= CMATH_POWER_OF_TEN_MAX; power++)
+    {
+        float value = getPowerOfTen(power);
+        for (int i = 0; i < CMATH_BOUNDARY_ULPS; i++)
+            value = nextafterf(value, 0);
+
+        for (int i = 0; i < 2 * CMATH_BOUNDARY_ULPS; i++)
+        {
+            if ((value > 0) && isfinite(value))
+                checkFloat(value);
+
+            value = nextafterf(value, INFINITY);
+        }
+    }
+
+    // Every shift, products of every bit length and next to each decade
+    // boundary
+    for (int shift = 0; shift < 64; shift++)
+    {
+        for (unsigned int i = 0; i < CMATH_PRODUCT_NUM; i++)
+        {
+            unsigned long long product = getTestRandomLong() >> (getTestRandomLong() % 64);
+            if (product)
+                checkFixed(product, shift);
+        }
+
+        for (int power = 0; power <= CMATH_FIXED_POWER_MAX; power++)
+        {
+            uint128 boundary = getPower(10, power) << shift;
+            for (int i = -2; i <= 2; i++)
+                if (((boundary + i) > 0) && !((boundary + i) >> 64))
+                    checkFixed((unsigned long long)(boundary + i), shift);
+        }
+    }
+
+    int result = endTest();
+    printf("\n");
+
+    // Benchmark: displayed values, from 1E-9 to 1E9
+    static float values[1024];
+    static unsigned long long products[1024];
+    for (unsigned int i = 0; i < 1024; i++)
+    {
+        values[i] = (float)pow(10, -9 + 18.0 * (getTestRandomLong() >> 11) / 9007199254740992.0);
+        products[i] = (unsigned long long)(values[i] * 65536);
+    }
+
+    volatile unsigned long long sink = 0;
+    double times[5];
+    double startTime;
+
+    startTime = getTestTime();
+    for (unsigned int i = 0; i < CMATH_BENCHMARK_NUM; i++)
+        sink += getExponent(values[i % 1024]);
+    times[0] = getTestTime() - startTime;
+
+    startTime = getTestTime();
+    for (unsigned int i = 0; i < CMATH_BENCHMARK_NUM; i++)
+        sink += (unsigned long long)getPowerOfTen(-9 + i % 19);
+    times[1] = getTestTime() - startTime;
+
+    startTime = getTestTime();
+    for (unsigned int i = 0; i < CMATH_BENCHMARK_NUM; i++)
+        sink += getFloatDecimal(values[i % 1024], 3, true);
+    times[2] = getTestTime() - startTime;
+
+    startTime = getTestTime();
+    for (unsigned int i = 0; i < CMATH_BENCHMARK_NUM; i++)
+        sink += getFixedExponent(products[i % 1024] + 1, FIXED_SHIFT);
+    times[3] = getTestTime() - startTime;
+
+    startTime = getTestTime();
+    for (unsigned int i = 0; i < CMATH_BENCHMARK_NUM; i++)
+        sink += getFixedDecimal(products[i % 1024], FIXED_SHIFT, 3, true);
+    times[4] = getTestTime() - startTime;
+
+    static const char *const names[] = {
+        "getExponent", "getPowerOfTen", "getFloatDecimal", "getFixedExponent", "getFixedDecimal"};
+
+    printf("%-18s %10s\n", "function", "ns/call");
+    for (unsigned int i = 0; i < 5; i++)
+        printf("%-18s %10.2f\n", names[i], 1E9 * times[i] / CMATH_BENCHMARK_NUM);
+
+    return result;
+}
@@ -0,0 +1,21 @@
+# Runs COMMAND1 and COMMAND2, and fails if their outputs differ:
+#
+#   cmake -DCOMMAND1=... -DCOMMAND2=... -P compare.cmake
+#
+# Differing outputs are kept in the working directory, for diff.
+
+execute_process(COMMAND ${COMMAND1} OUTPUT_VARIABLE output1 RESULT_VARIABLE result1)
+execute_process(COMMAND ${COMMAND2} OUTPUT_VARIABLE output2 RESULT_VARIABLE result2)
+
+if(NOT result1 EQUAL 0 OR NOT result2 EQUAL 0)
+    message(FATAL_ERROR "${COMMAND1}: ${result1}, ${COMMAND2}: ${result2}")
+endif()
+
+if(NOT output1 STREQUAL output2)
+    get_filename_component(name1 ${COMMAND1} NAME_WE)
+    get_filename_component(name2 ${COMMAND2} NAME_WE)
+    file(WRITE ${name1}.txt "${output1}")
+    file(WRITE ${name2}.txt "${output2}")
+
+    message(FATAL_ERROR "outputs differ: ${name1}.txt, ${name2}.txt")
+endif()
@@ -0,0 +1,415 @@
+/*
+ * FS2011 Pro
+ * Confidence interval test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/confidence.h"
+#include "../../cubeide/Core/fs2011pro/settings.h"
+
+#include "test.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Checks getConfidenceIntervals() at every level against the exact
+// intervals, from the gamma quantiles computed in long double, for every
+// count up to 2000 and for log-spaced counts up to 10^9. A displayed
+// interval may differ from the rounded exact one only within 0.02 display
+// units of a rounding tie. The intervals must not grow with the count,
+// also across the switch from the tables to the Wilson-Hilferty formula
+// after CONFIDENCE_TABLE_SIZE (64) counts, which is printed with the
+// Wilson-Hilferty intervals in long double. Then reports the time per
+// lookup against the binary search of the fixed 95% table it replaced.
+
+#define CONFIDENCE_LEVEL_NUM 4
+#define CONFIDENCE_TABLE_COUNT_MAX 64
+#define CONFIDENCE_DENSE_COUNT_MAX 2000
+#define CONFIDENCE_COUNT_MAX 1000000000
+#define CONFIDENCE_COUNT_FACTOR 1.1
+
+#define CONFIDENCE_TIE_MAX 0.02
+#define CONFIDENCE_BENCHMARK_NUM 2000000
+
+typedef const struct
+{
+    unsigned short sampleNum;
+    unsigned char lowerInterval;
+    unsigned short upperInterval;
+} OldConfidenceInterval;
+
+// The fixed 95% table, for the benchmark
+static const OldConfidenceInterval oldConfidenceIntervals[] = {
+    {1, 73, 3850},
+    {2, 65, 726},
+    {3, 59, 385},
+    {4, 55, 268},
+    {5, 52, 208},
+    {6, 49, 173},
+    {7, 47, 149},
+    {8, 45, 132},
+    {9, 43, 119},
+    {10, 42, 109},
+    {11, 41, 101},
+    {12, 40, 94},
+    {13, 38, 88},
+    {14, 38, 83},
+    {15, 37, 79},
+    {16, 36, 75},
+    {17, 35, 72},
+    {18, 34, 69},
+    {19, 34, 67},
+    {20, 33, 64},
+    {21, 33, 62},
+    {22, 32, 60},
+    {23, 31, 58},
+    {24, 31, 57},
+    {25, 30, 55},
+    {26, 30, 54},
+    {27, 30, 52},
+    {28, 29, 51},
+    {29, 29, 50},
+    {30, 28, 49},
+    {31, 28, 48},
+    {32, 28, 47},
+    {33, 27, 46},
+    {34, 27, 45},
+    {35, 27, 44},
+    {36, 27, 43},
+    {37, 26, 43},
+    {38, 26, 42},
+    {39, 26, 41},
+    {40, 25, 40},
+    {42, 25, 39},
+    {44, 25, 38},
+    {45, 24, 38},
+    {46, 24, 37},
+    {48, 24, 36},
+    {50, 23, 35},
+    {52, 23, 34},
+    {55, 22, 33},
+    {58, 22, 32},
+    {61, 22, 31},
+    {62, 21, 31},
+    {64, 21, 30},
+    {68, 21, 29},
+    {69, 20, 29},
+    {72, 20, 28},
+    {76, 20, 27},
+    {78, 19, 27},
+    {81, 19, 26},
+    {87, 19, 25},
+    {88, 18, 25},
+    {93, 18, 24},
+    {100, 18, 23},
+    {101, 17, 23},
+    {108, 17, 22},
+    {116, 16, 22},
+    {117, 16, 21},
+    {127, 16, 20},
+    {134, 15, 20},
+    {139, 15, 19},
+    {153, 15, 18},
+    {157, 14, 18},
+    {169, 14, 17},
+    {185, 13, 17},
+    {188, 13, 16},
+    {211, 13, 15},
+    {221, 12, 15},
+    {239, 12, 14},
+    {267, 11, 14},
+    {274, 11, 13},
+    {317, 11, 12},
+    {328, 10, 12},
+    {372, 10, 11},
+    {412, 9, 11},
+    {444, 9, 10},
+    {530, 8, 10},
+    {541, 8, 9},
+    {675, 8, 8},
+    {703, 7, 8},
+    {869, 7, 7},
+    {973, 6, 7},
+    {1166, 6, 6},
+    {1423, 5, 6},
+    {1654, 5, 5},
+    {2258, 4, 5},
+    {2548, 4, 4},
+    {4077, 3, 4},
+    {4463, 3, 3},
+    {9316, 2, 3},
+    {9895, 2, 2},
+    {37838, 1, 2},
+    {38995, 1, 1},
+};
+
+#define OLD_CONFIDENCE_INTERVALS_SIZE (sizeof(oldConfidenceIntervals) / sizeof(OldConfidenceInterval))
+
+static const long double confidenceLevels[CONFIDENCE_LEVEL_NUM] = {
+    0.682689492137085897L, 0.90L, 0.95L, 0.99L};
+
+static const char *const confidenceLevelNames[CONFIDENCE_LEVEL_NUM] = {
+    "68%", "90%", "95%", "99%"};
+
+void checkConfidence(bool isValid, const char *message,
+                     unsigned int level, unsigned int sampleNum,
+                     int value, double expectedValue)
+{
+    checkTest(isValid, "%s, n = %u: %s (%d instead of %.3f)",
+              confidenceLevelNames[level], sampleNum, message, value, expectedValue);
+}
+
+// Regularized lower incomplete gamma function, series expansion
+long double getGammaCDF(unsigned int n, long double x)
+{
+    long double term = 1;
+    long double total = 1;
+
+    for (unsigned int k = 1; term > 1E-21L * total; k++)
+    {
+        term *= x / (n + k);
+        total += term;
+    }
+
+    return expl(n * logl(x) - x - lgammal(n + 1.0L)) * total;
+}
+
+long double getGammaPDF(unsigned int n, long double x)
+{
+    return expl((n - 1) * logl(x) - x - lgammal(n));
+}
+
+long double getNormalQuantile(long double p)
+{
+    long double left = -10;
+    long double right = 10;
+
+    for (unsigned int i = 0; i < 100; i++)
+    {
+        long double mid = (left + right) / 2;
+        if ((1 + erfl(mid / sqrtl(2))) / 2 < p)
+            left = mid;
+        else
+            right = mid;
+    }
+
+    return (left + right) / 2;
+}
+
+// Wilson-Hilferty: chi2(p, 2n) / 2 = n * (1 - 1 / 9n + z(p) / (3 sqrt(n)))^3
+long double getWilsonHilfertyQuantile(unsigned int n, long double p)
+{
+    long double c = 1 - 1 / (9.0L * n) + getNormalQuantile(p) / (3 * sqrtl(n));
+
+    return n * c * c * c;
+}
+
+// Newton's method from the Wilson-Hilferty quantile, bisecting when a step
+// leaves the bracket
+long double getGammaQuantile(unsigned int n, long double p)
+{
+    long double left = 0;
+    long double right = n + 20 * sqrtl(n) + 50;
+    long double x = getWilsonHilfertyQuantile(n, p);
+    if ((x <= left) || (x >= right))
+        x = (left + right) / 2;
+
+    for (unsigned int i = 0; i < 200; i++)
+    {
+        long double error = getGammaCDF(n, x) - p;
+        if (error < 0)
+            left = x;
+        else
+            right = x;
+
+        long double next = x - error / getGammaPDF(n, x);
+        if ((next <= left) || (next >= right))
+            next = (left + right) / 2;
+
+        if (fabsl(next - x) <= 1E-15L * x)
+            return next;
+
+        x = next;
+    }
+
+    return x;
+}
+
+// Exact intervals (%), unrounded
+void getExactIntervals(unsigned int level, unsigned int sampleNum,
+                       long double *lower, long double *upper)
+{
+    long double alpha = 1 - confidenceLevels[level];
+
+    *lower = 100 * (1 - sampleNum / getGammaQuantile(sampleNum, 1 - alpha / 2));
+    *upper = 100 * (sampleNum / getGammaQuantile(sampleNum, alpha / 2) - 1);
+}
+
+void getWilsonHilfertyIntervals(unsigned int level, unsigned int sampleNum,
+                                long double *lower, long double *upper)
+{
+    long double alpha = 1 - confidenceLevels[level];
+
+    *lower = 100 * (1 - sampleNum / getWilsonHilfertyQuantile(sampleNum, 1 - alpha / 2));
+    *upper = 100 * (sampleNum / getWilsonHilfertyQuantile(sampleNum, alpha / 2) - 1);
+}
+
+// Displayed interval in tenths of a percent against the exact one in
+// percent: tenths below 10%, whole percents from 10% up
+void checkInterval(const char *message, unsigned int level, unsigned int sampleNum,
+                   int value, long double exactValue)
+{
+    double unit = (value < 100) ? 1 : 10;
+
+    checkConfidence(fabsl(value - 10 * exactValue) <= (0.5 + CONFIDENCE_TIE_MAX) * unit,
+                    message, level, sampleNum, value, (double)(10 * exactValue));
+}
+
+void checkCount(unsigned int level, unsigned int sampleNum,
+                int *lastLower, int *lastUpper)
+{
+    int lower;
+    int upper;
+    getConfidenceIntervals(sampleNum, &lower, &upper);
+
+    long double exactLower;
+    long double exactUpper;
+    getExactIntervals(level, sampleNum, &exactLower, &exactUpper);
+
+    checkInterval("lower interval differs", level, sampleNum, lower, exactLower);
+    checkInterval("upper interval differs", level, sampleNum, upper, exactUpper);
+
+    checkConfidence(lower <= *lastLower, "lower interval grows", level, sampleNum, lower, *lastLower);
+    checkConfidence(upper <= *lastUpper, "upper interval grows", level, sampleNum, upper, *lastUpper);
+
+    *lastLower = lower;
+    *lastUpper = upper;
+}
+
+void getOldConfidenceIntervals(unsigned int sampleNum,
+                               int *lowerConfidenceInterval,
+                               int *upperConfidenceInterval)
+{
+    int left = 0;
+    int right = OLD_CONFIDENCE_INTERVALS_SIZE - 1;
+    int index = -1;
+
+    while (left <= right)
+    {
+        int mid = (left + right) / 2;
+        unsigned int confidenceSampleNum = oldConfidenceIntervals[mid].sampleNum;
+
+        if (confidenceSampleNum < sampleNum)
+            left = mid + 1;
+        else if (confidenceSampleNum > sampleNum)
+            right = mid - 1;
+        else
+        {
+            index = mid;
+            break;
+        }
+    }
+
+    if (index == -1)
+        index = right;
+
+    *lowerConfidenceInterval = oldConfidenceIntervals[index].lowerInterval;
+    *upperConfidenceInterval = oldConfidenceIntervals[index].upperInterval;
+}
+
+// Time per lookup (ns) over the counts, from 1 to countMax, log-spaced
+double getLookupTime(void (*getIntervals)(unsigned int, int *, int *),
+                     const unsigned int *counts)
+{
+    volatile int sink = 0;
+
+    double startTime = getTestTime();
+    for (unsigned int i = 0; i < CONFIDENCE_BENCHMARK_NUM; i++)
+    {
+        int lower;
+        int upper;
+        getIntervals(counts[i % 1024], &lower, &upper);
+        sink += lower + upper;
+    }
+
+    return 1E9 * (getTestTime() - startTime) / CONFIDENCE_BENCHMARK_NUM;
+}
+
+int main()
+{
+    for (unsigned int level = 0; level < CONFIDENCE_LEVEL_NUM; level++)
+    {
+        setConfidenceLevel(level);
+
+        int lastLower = 1000;
+        int lastUpper = 1000000;
+
+        for (unsigned int sampleNum = 1; sampleNum <= CONFIDENCE_DENSE_COUNT_MAX; sampleNum++)
+            checkCount(level, sampleNum, &lastLower, &lastUpper);
+
+        for (double count = CONFIDENCE_DENSE_COUNT_MAX * CONFIDENCE_COUNT_FACTOR;
+             count < CONFIDENCE_COUNT_MAX;
+             count *= CONFIDENCE_COUNT_FACTOR)
+            checkCount(level, (unsigned int)count, &lastLower, &lastUpper);
+
+        checkCount(level, CONFIDENCE_COUNT_MAX, &lastLower, &lastUpper);
+
+        // Tables to formula
+        printf("%s:", confidenceLevelNames[level]);
+        for (unsigned int sampleNum = CONFIDENCE_TABLE_COUNT_MAX - 1;
+             sampleNum <= CONFIDENCE_TABLE_COUNT_MAX + 2;
+             sampleNum++)
+        {
+            int lower;
+            int upper;
+            getConfidenceIntervals(sampleNum, &lower, &upper);
+
+            long double exactLower;
+            long double exactUpper;
+            getExactIntervals(level, sampleNum, &exactLower, &exactUpper);
+
+            long double wilsonHilfertyLower;
+            long double wilsonHilfertyUpper;
+            getWilsonHilfertyIntervals(level, sampleNum, &wilsonHilfertyLower, &wilsonHilfertyUpper);
+
+            printf("  n = %u: -%.1f/+%.1f (exact -%.2Lf/+%.2Lf, WH -%.2Lf/+%.2Lf)\n",
+                   sampleNum, lower / 10.0, upper / 10.0,
+                   exactLower, exactUpper, wilsonHilfertyLower, wilsonHilfertyUpper);
+        }
+    }
+
+    int result = endTest();
+    printf("\n");
+
+    // Benchmark at 95%: counts of the table, of the formula and of a
+    // measurement from the first pulse on (log-spaced up to 10^6)
+    static unsigned int tableCounts[1024];
+    static unsigned int formulaCounts[1024];
+    static unsigned int measurementCounts[1024];
+    for (unsigned int i = 0; i < 1024; i++)
+    {
+        tableCounts[i] = 1 + getTestRandom() % CONFIDENCE_TABLE_COUNT_MAX;
+        formulaCounts[i] = CONFIDENCE_TABLE_COUNT_MAX + 1 +
+                           getTestRandom() % (CONFIDENCE_COUNT_MAX - CONFIDENCE_TABLE_COUNT_MAX);
+        measurementCounts[i] = (unsigned int)exp(13.8 * getTestRandom() / 4294967296.0);
+    }
+
+    setConfidenceLevel(CONFIDENCE_LEVEL_95);
+
+    printf("%-12s %14s %14s\n", "counts", "formula (ns)", "old 95% (ns)");
+    printf("%-12s %14.2f %14.2f\n", "1-64",
+           getLookupTime(getConfidenceIntervals, tableCounts),
+           getLookupTime(getOldConfidenceIntervals, tableCounts));
+    printf("%-12s %14.2f %14.2f\n", "65-1E9",
+           getLookupTime(getConfidenceIntervals, formulaCounts),
+           getLookupTime(getOldConfidenceIntervals, formulaCounts));
+    printf("%-12s %14.2f %14.2f\n", "log 1-1E6",
+           getLookupTime(getConfidenceIntervals, measurementCounts),
+           getLookupTime(getOldConfidenceIntervals, measurementCounts));
+
+    return result;
+}
@@ -0,0 +1,88 @@
+/*
+ * FS2011 Pro
+ * Pulse counter test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/counter.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// Captures bursts of pulses into the simulated capture ring and checks
+// that every pulse is read or counted as lost: bursts below
+// COUNTER_CAPTURE_NUM are read in full with their delays, larger bursts
+// wrap the ring and must report lost pulses. The capture timestamps
+// advance with every pulse, as TIM16 does.
+
+#define COUNTER_TICK_NUM 20000
+
+void checkCounter(bool isValid, const char *message, unsigned int tick, unsigned int pulseNum)
+{
+    checkTest(isValid, "tick %u, %u pulses: %s", tick, pulseNum, message);
+}
+
+int main()
+{
+    unsigned short delays[2 * COUNTER_CAPTURE_NUM];
+    unsigned long long pulseTotal = 0;
+    unsigned long long countedTotal = 0;
+    unsigned int wrapNum = 0;
+    unsigned short timestamp = 0;
+
+    for (unsigned int tick = 0; tick < COUNTER_TICK_NUM; tick++)
+    {
+        // Mostly small bursts, some that fill or wrap the ring
+        unsigned int random = getTestRandom();
+        unsigned int pulseNum = (random & 0x7)
+                                    ? (random >> 8) % COUNTER_CAPTURE_NUM
+                                    : (random >> 8) % (2 * COUNTER_CAPTURE_NUM);
+
+        for (unsigned int i = 0; i < pulseNum; i++)
+        {
+            timestamp += 1 + getTestRandom() % 16;
+
+            // The simulated counter reads 0 at the end of the tick
+            delays[i] = -timestamp;
+            simCounterPulse(delays[i]);
+        }
+
+        unsigned int pulseCount = getCounterPulses();
+        unsigned int lostPulseCount = getCounterLostPulses();
+        const unsigned short *pulseDelays = getCounterPulseDelays();
+
+        if (pulseNum < COUNTER_CAPTURE_NUM)
+        {
+            checkCounter(pulseCount == pulseNum, "pulses not read", tick, pulseNum);
+            checkCounter(!lostPulseCount, "pulses reported lost", tick, pulseNum);
+
+            for (unsigned int i = 0; (i < pulseCount) && (i < pulseNum); i++)
+                checkCounter(pulseDelays[i] == delays[i], "wrong delay", tick, pulseNum);
+        }
+        else
+        {
+            wrapNum++;
+
+            checkCounter(lostPulseCount > 0, "wrap not detected", tick, pulseNum);
+            checkCounter(pulseCount + lostPulseCount <= pulseNum, "pulses counted twice", tick, pulseNum);
+
+            // The newest pulses are read with their delays
+            unsigned int offset = pulseNum - pulseCount;
+            for (unsigned int i = 0; i < pulseCount; i++)
+                checkCounter(pulseDelays[i] == delays[offset + i], "wrong delay", tick, pulseNum);
+        }
+
+        pulseTotal += pulseNum;
+        countedTotal += pulseCount + lostPulseCount;
+    }
+
+    printf("%u ticks, %u ring wraps, %llu of %llu pulses counted\n",
+           COUNTER_TICK_NUM, wrapNum, countedTotal, pulseTotal);
+
+    return endTest();
+}
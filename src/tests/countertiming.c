@@ -0,0 +1,154 @@
+/*
+ * FS2011 Pro
+ * Pulse counter timing test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/counter.h"
+#include "../../cubeide/Core/fs2011pro/events.h"
+#include "../../cubeide/Core/fs2011pro/measurements.h"
+
+#include "test.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Feeds windows of pulses with known arrival times, to fractions of a
+// microsecond, into the simulated capture ring, and runs two measurement
+// contexts on them tick by tick, as the tick interrupt does: one with the
+// capture delays (PULSE_COUNTER), one with the pulses quantized to the
+// start of their tick. Reports the error of the window interval and of the
+// rate it gives against the true arrival times. With delays, the interval
+// must be exact to 1 us; quantized, to one tick.
+
+#define TIMING_TRIAL_NUM 1000
+#define TIMING_PULSE_NUM INSTANTANEOUS_RATE_PULSE_NUM
+
+// Counter ticks per tick
+#define TIMING_TICK_TIME (COUNTER_FREQUENCY / TICK_FREQUENCY)
+
+#define TIMING_RATE_NUM 4
+
+static const double timingRates[TIMING_RATE_NUM] = {10, 100, 1000, 10000};
+
+struct TimingErrors
+{
+    double intervalErrorSum;
+    double intervalErrorMax;
+    double rateErrorSquareSum;
+};
+
+void checkTiming(bool isValid, const char *message, double rate, unsigned int trial)
+{
+    checkTest(isValid, "%.0f cps, trial %u: %s", rate, trial, message);
+}
+
+void addTimingErrors(struct TimingErrors *errors, const MeasurementContext *context,
+                     double interval)
+{
+    const AverageRate *averageRate = &context->averageRate;
+
+    double measuredInterval = (double)(averageRate->lastPulseTime - averageRate->firstPulseTime);
+    double intervalError = fabs(measuredInterval - interval);
+
+    // No period, no rate (onMeasurementContextOneSecond())
+    double rateError = measuredInterval ? interval / measuredInterval - 1 : -1;
+
+    errors->intervalErrorSum += intervalError;
+    if (intervalError > errors->intervalErrorMax)
+        errors->intervalErrorMax = intervalError;
+    errors->rateErrorSquareSum += rateError * rateError;
+}
+
+int main()
+{
+    static MeasurementContext countedContext;
+    static MeasurementContext quantizedContext;
+
+    struct TimingErrors countedErrors[TIMING_RATE_NUM] = {{0}};
+    struct TimingErrors quantizedErrors[TIMING_RATE_NUM] = {{0}};
+
+    for (unsigned int i = 0; i < TIMING_RATE_NUM; i++)
+    {
+        double rate = timingRates[i];
+
+        for (unsigned int trial = 0; trial < TIMING_TRIAL_NUM; trial++)
+        {
+            // Arrival times in counter ticks
+            double pulseTimes[TIMING_PULSE_NUM];
+            double pulseTime = TIMING_TICK_TIME * getTestUniform();
+            for (unsigned int j = 0; j < TIMING_PULSE_NUM; j++)
+            {
+                pulseTimes[j] = pulseTime;
+                pulseTime -= COUNTER_FREQUENCY * log(getTestUniform()) / rate;
+            }
+
+            resetMeasurementContext(&countedContext);
+            resetMeasurementContext(&quantizedContext);
+
+            unsigned int pulseIndex = 0;
+            for (unsigned int tick = 0; pulseIndex < TIMING_PULSE_NUM; tick++)
+            {
+                double tickEndTime = (double)TIMING_TICK_TIME * (tick + 1);
+
+                // The simulated counter reads 0 at the end of the tick
+                unsigned int pulseNum = 0;
+                while ((pulseIndex < TIMING_PULSE_NUM) &&
+                       (pulseTimes[pulseIndex] < tickEndTime))
+                {
+                    simCounterPulse((unsigned short)(tickEndTime - pulseTimes[pulseIndex]));
+
+                    pulseIndex++;
+                    pulseNum++;
+                }
+
+                unsigned int pulseCount = getCounterPulses();
+                checkTiming((pulseCount == pulseNum) && !getCounterLostPulses(),
+                            "pulses lost", rate, trial);
+
+                onMeasurementContextTick(&countedContext, pulseCount, getCounterPulseDelays());
+                onMeasurementContextTick(&quantizedContext, pulseCount, NULL);
+            }
+
+            double interval = pulseTimes[TIMING_PULSE_NUM - 1] - pulseTimes[0];
+
+            addTimingErrors(&countedErrors[i], &countedContext, interval);
+            addTimingErrors(&quantizedErrors[i], &quantizedContext, interval);
+
+            const AverageRate *countedRate = &countedContext.averageRate;
+            const AverageRate *quantizedRate = &quantizedContext.averageRate;
+            checkTiming(fabs((double)(countedRate->lastPulseTime - countedRate->firstPulseTime) -
+                             interval) <= 1,
+                        "interval with delays off by more than 1 us", rate, trial);
+            checkTiming(fabs((double)(quantizedRate->lastPulseTime - quantizedRate->firstPulseTime) -
+                             interval) < TIMING_TICK_TIME,
+                        "quantized interval off by a tick or more", rate, trial);
+        }
+
+        checkTest(countedErrors[i].rateErrorSquareSum < quantizedErrors[i].rateErrorSquareSum,
+                  "%.0f cps: rate error with delays not below the quantized one", rate);
+    }
+
+    int result = endTest();
+    printf("\n");
+
+    printf("%-12s %21s %21s %21s\n",
+           "", "mean interval", "max interval", "rms rate");
+    printf("%-12s %10s %10s %10s %10s %10s %10s\n",
+           "rate (cps)", "delays", "ticks", "delays", "ticks", "delays", "ticks");
+    for (unsigned int i = 0; i < TIMING_RATE_NUM; i++)
+        printf("%-12.0f %7.2f us %7.0f us %7.2f us %7.0f us %8.4f %% %8.2f %%\n",
+               timingRates[i],
+               countedErrors[i].intervalErrorSum / TIMING_TRIAL_NUM,
+               quantizedErrors[i].intervalErrorSum / TIMING_TRIAL_NUM,
+               countedErrors[i].intervalErrorMax,
+               quantizedErrors[i].intervalErrorMax,
+               100 * sqrt(countedErrors[i].rateErrorSquareSum / TIMING_TRIAL_NUM),
+               100 * sqrt(quantizedErrors[i].rateErrorSquareSum / TIMING_TRIAL_NUM));
+
+    return result;
+}
@@ -0,0 +1,124 @@
+/*
+ * FS2011 Pro
+ * Dead-time correction test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/display.h"
+#include "../../cubeide/Core/fs2011pro/events.h"
+#include "../../cubeide/Core/fs2011pro/keyboard.h"
+#include "../../cubeide/Core/fs2011pro/logger.h"
+#include "../../cubeide/Core/fs2011pro/measurements.h"
+#include "../../cubeide/Core/fs2011pro/menus.h"
+#include "../../cubeide/Core/fs2011pro/power.h"
+#include "../../cubeide/Core/fs2011pro/settings.h"
+#include "../../cubeide/Core/fs2011pro/sim.h"
+#include "../../cubeide/Core/fs2011pro/ui.h"
+
+#include "../headless/headless.h"
+
+#include "test.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// Drives the simulator, which loses the pulses within the tube's dead
+// time, at 1 to 20 kcps through the firmware, and reports the error of
+// the average rate and the dose against the true rate, without (raw
+// counts) and with dead-time correction. The corrected errors must stay
+// within DEADTIME_ERROR_MAX.
+
+#define DEADTIME_WARMUP_TIME 5
+#define DEADTIME_TIME 60
+#define DEADTIME_UI_TICKS 10
+
+#define DEADTIME_ERROR_MAX 0.02
+
+static const float deadTimeRates[] = {1000, 2000, 5000, 10000, 15000, 20000};
+
+double getRateValue(Rate rate)
+{
+#ifdef FIXED_POINT
+    return rate / (double)FIXED_ONE;
+#else
+    return rate;
+#endif
+}
+
+void runDeadTimeTicks(unsigned int ticks)
+{
+    for (unsigned int i = 1; i <= ticks; i++)
+    {
+        onSimTick();
+        addHeadlessTicks(1);
+        onEventsTick();
+
+        if (!(i % DEADTIME_UI_TICKS))
+            updateUI();
+    }
+}
+
+int main()
+{
+    initSim(SIM_SEED);
+
+    initKeyboard();
+    initPower();
+    initDisplay();
+
+    readSettings();
+
+    initEvents();
+    initMeasurements();
+    initLogger();
+    initMenus();
+
+    AverageRate *averageRate = &measurementContext.averageRate;
+    Dose *dose = &measurementContext.dose;
+
+    printf("dead time: %.0f us\n\n", DEAD_TIME * 1E6);
+    printf("%-12s %24s %24s\n", "", "average rate error (%)", "dose error (%)");
+    printf("%-12s %12s %11s %12s %11s\n",
+           "rate (cps)", "raw", "corrected", "raw", "corrected");
+
+    for (unsigned int i = 0; i < sizeof(deadTimeRates) / sizeof(deadTimeRates[0]); i++)
+    {
+        float rate = deadTimeRates[i];
+
+        setSimRate(rate);
+        resetDose();
+        runDeadTimeTicks(DEADTIME_WARMUP_TIME * TICK_FREQUENCY);
+
+        // The dose is taken between two snapshots, as the pulses of the
+        // last second may still be queued
+        resetAverageRate();
+        Dose startDose = *dose;
+        runDeadTimeTicks(DEADTIME_TIME * TICK_FREQUENCY);
+
+        double rawRate = 1E6 * averageRate->snapshotCount / averageRate->snapshotPeriod;
+        double correctedRate = getRateValue(averageRate->snapshotValue);
+        double trueDose = (double)rate * (dose->snapshotTime - startDose.snapshotTime);
+        double rawDose = dose->snapshotValue - startDose.snapshotValue;
+        double correctedDose = dose->correctedValue - startDose.correctedValue;
+
+        double errors[] = {
+            rawRate / rate - 1,
+            correctedRate / rate - 1,
+            rawDose / trueDose - 1,
+            correctedDose / trueDose - 1,
+        };
+
+        printf("%-12.0f %12.2f %11.2f %12.2f %11.2f\n",
+               rate, 100 * errors[0], 100 * errors[1], 100 * errors[2], 100 * errors[3]);
+
+        checkTest((fabs(errors[1]) <= DEADTIME_ERROR_MAX) &&
+                      (fabs(errors[3]) <= DEADTIME_ERROR_MAX),
+                  "%.0f cps: corrected error above %.0f%%",
+                  rate, 100 * DEADTIME_ERROR_MAX);
+    }
+
+    return endTest();
+}
@@ -0,0 +1,125 @@
+/*
+ * FS2011 Pro
+ * Formatter equivalence test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/format.h"
+#include "../../cubeide/Core/fs2011pro/settings.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// Writes the strings of the measurement views and the alarm menus over
+// the rate and dose ranges, for every unit. The test is built with and
+// without FIXED_POINT, and format-equivalence compares both outputs.
+// Rates are multiples of 2^-16 cps, so both builds format the same value.
+// Floats do not resolve values just below a digit of the truncated
+// mantissa, so these are not compared.
+
+#define FORMAT_TEST_RATE_MAX 60000
+#define FORMAT_TEST_RESOLUTION (1.0 / (1 << 20))
+
+const char *getRateAlarmMenuOption(void *userdata, unsigned int index);
+const char *getDoseAlarmMenuOption(void *userdata, unsigned int index);
+
+double getUnitValue(Unit *unit, double value)
+{
+    return value * unit->scaleMantissa / (1 << UNIT_SCALE_SHIFT) *
+           pow(10, unit->scaleExponent);
+}
+
+bool isUnresolved(Unit *unit, double value)
+{
+    if (value <= 0)
+        return false;
+
+    int exponent = (int)floor(log10(value));
+    if (exponent < unit->minExponent)
+        exponent = unit->minExponent;
+
+    double mantissa = value * pow(10, 3 - exponent);
+    double distance = ceil(mantissa) - mantissa;
+
+    return (distance > 1E-9 * mantissa) &&
+           (distance < FORMAT_TEST_RESOLUTION * mantissa);
+}
+
+void writeRate(unsigned int fixedRate)
+{
+    char mantissa[32];
+    char characteristic[32];
+
+    Unit *unit = &units[settings.units].rate;
+    if (isUnresolved(unit, getUnitValue(unit, fixedRate / 65536.0)))
+    {
+        printf("rate %u: unresolved\n", fixedRate);
+
+        return;
+    }
+
+#ifdef FIXED_POINT
+    Rate rate = fixedRate;
+#else
+    Rate rate = fixedRate / 65536.0F;
+#endif
+
+    formatRate(rate, mantissa, characteristic);
+    printf("rate %u: %s %s\n", fixedRate, mantissa, characteristic);
+}
+
+void writeDose(unsigned long long count)
+{
+    char mantissa[32];
+    char characteristic[32];
+
+    Unit *unit = &units[settings.units].dose;
+    if (isUnresolved(unit, getUnitValue(unit, count)))
+    {
+        printf("dose %llu: unresolved\n", count);
+
+        return;
+    }
+
+    formatDose(count, mantissa, characteristic);
+    printf("dose %llu: %s %s\n", count, mantissa, characteristic);
+}
+
+int main()
+{
+    for (unsigned int i = 0; i < UNITS_NUM; i++)
+    {
+        settings.units = i;
+        printf("units %u\n", i);
+
+        for (unsigned int j = 1; j < RATE_ALARM_NUM; j++)
+            printf("rate alarm %u: %s\n", j, getRateAlarmMenuOption(NULL, j));
+
+        for (unsigned int j = 1; j < DOSE_ALARM_NUM; j++)
+            printf("dose alarm %u: %s\n", j, getDoseAlarmMenuOption(NULL, j));
+
+        for (unsigned int j = 0; j < 4096; j++)
+            writeRate(j);
+
+        // 1E-4 cps to FORMAT_TEST_RATE_MAX, 80 steps per decade
+        for (int j = -320; ; j++)
+        {
+            double rate = pow(10, j / 80.0);
+            if (rate > FORMAT_TEST_RATE_MAX)
+                break;
+
+            writeRate((unsigned int)(rate * 65536 + 0.5));
+        }
+
+        for (unsigned int j = 0; j < 4096; j++)
+            writeDose(j);
+
+        for (int j = 0; j <= 12 * 80; j++)
+            writeDose((unsigned long long)(pow(10, j / 80.0) + 0.5));
+    }
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * FS2011 Pro
+ * Data logger test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/logger.h"
+#include "../../cubeide/Core/fs2011pro/settings.h"
+
+#include "test.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Logs minute counts through updateLogger() and reads them back with
+// readLoggerRecord(): every record read must carry the count and time it
+// was logged with, and the newest records must all be read. The counts
+// are varint edge cases, random values and Poisson counts, logged across
+// power offs and power losses that tear a block write. Then reports the
+// records per KB of flash for Poisson counts at several rates, with the
+// log ring full.
+
+// SDL log region (logger.c)
+#define LOGGER_TEST_PAGE_START 0x20
+#define LOGGER_TEST_PAGE_END 0x30
+#define LOGGER_TEST_SIZE ((LOGGER_TEST_PAGE_END - LOGGER_TEST_PAGE_START) * SETTINGS_PAGE_SIZE)
+
+// More records than the log holds
+#define LOGGER_TEST_RECORD_NUM 50000
+#define LOGGER_TEST_CYCLE_TIME_MAX 2000
+
+typedef struct
+{
+    unsigned int time;
+    unsigned int count;
+} LoggerTestRecord;
+
+struct
+{
+    LoggerTestRecord records[LOGGER_TEST_RECORD_NUM];
+    unsigned int recordNum;
+} loggerTest;
+
+unsigned int getPoissonCount(double mean)
+{
+    if (mean < 30)
+    {
+        double limit = exp(-mean);
+        double product = getTestUniform();
+        unsigned int count = 0;
+
+        while (product > limit)
+        {
+            product *= getTestUniform();
+            count++;
+        }
+
+        return count;
+    }
+
+    // Normal approximation
+    double normal = sqrt(-2 * log(getTestUniform())) *
+                    cos(2 * M_PI * getTestUniform());
+    double count = mean + sqrt(mean) * normal + 0.5;
+
+    return (count < 0) ? 0 : (unsigned int)count;
+}
+
+void checkLogger(bool isValid, const char *message, unsigned int value)
+{
+    checkTest(isValid, "%s (%u)", message, value);
+}
+
+void resetLoggerTest()
+{
+    for (int i = LOGGER_TEST_PAGE_START; i < LOGGER_TEST_PAGE_END; i++)
+        eraseSettingsPage(i);
+
+    settings.lifeTimer = 0;
+    settings.lifeCounts = 0;
+    loggerTest.recordNum = 0;
+
+    initLogger();
+}
+
+// Logs one minute, as the firmware does once a second
+void logMinute(unsigned int count)
+{
+    for (unsigned int i = 0; i < LOGGER_RECORD_TIME; i++)
+    {
+        settings.lifeTimer++;
+        if (i == (LOGGER_RECORD_TIME - 1))
+            settings.lifeCounts += count;
+
+        updateLogger();
+    }
+
+    if (loggerTest.recordNum < LOGGER_TEST_RECORD_NUM)
+    {
+        LoggerTestRecord *record = &loggerTest.records[loggerTest.recordNum++];
+        record->time = settings.lifeTimer;
+        record->count = count;
+    }
+}
+
+const LoggerTestRecord *findLoggerTestRecord(unsigned int time)
+{
+    unsigned int low = 0;
+    unsigned int high = loggerTest.recordNum;
+
+    while (low < high)
+    {
+        unsigned int middle = (low + high) / 2;
+
+        if (loggerTest.records[middle].time < time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if ((low < loggerTest.recordNum) && (loggerTest.records[low].time == time))
+        return &loggerTest.records[low];
+
+    return NULL;
+}
+
+// Reads the log back, returns the number of records read
+unsigned int readLoggerTest(unsigned int newestRecordNum)
+{
+    unsigned int time;
+    unsigned int count;
+    unsigned int lastTime = 0;
+    unsigned int readNum = 0;
+    unsigned int newestTime = (loggerTest.recordNum > newestRecordNum)
+                                  ? loggerTest.records[loggerTest.recordNum - newestRecordNum].time
+                                  : 0;
+
+    rewindLogger();
+    while (readLoggerRecord(&time, &count))
+    {
+        const LoggerTestRecord *record = findLoggerTestRecord(time);
+
+        checkLogger(record != NULL, "record time not logged", time);
+        checkLogger(!readNum || (time > lastTime), "records out of order", time);
+        if (record)
+            checkLogger(record->count == count, "record count differs", time);
+
+        if (record && (record >= &loggerTest.records[loggerTest.recordNum - newestRecordNum]))
+            newestRecordNum--;
+
+        lastTime = time;
+        readNum++;
+    }
+
+    checkLogger(!newestRecordNum, "newest records not read", newestTime);
+
+    return readNum;
+}
+
+unsigned int getEdgeCount(unsigned int index)
+{
+    static const unsigned int edgeCounts[] = {
+        0, 1, 63, 64, 127, 128, 8191, 8192, 16383, 16384,
+        0x1fffff, 0x200000, 0xfffffff, 0x10000000, INT_MAX, 0x80000000U, UINT_MAX - 1, UINT_MAX};
+
+    return edgeCounts[index % (sizeof(edgeCounts) / sizeof(edgeCounts[0]))];
+}
+
+int main()
+{
+    // Varint edge cases: every pair of edge counts, in both orders
+    resetLoggerTest();
+    for (unsigned int i = 0; i < 18; i++)
+        for (unsigned int j = 0; j < 18; j++)
+        {
+            logMinute(getEdgeCount(i));
+            logMinute(getEdgeCount(j));
+        }
+    writeLogger();
+    checkLogger(readLoggerTest(loggerTest.recordNum) == loggerTest.recordNum,
+                "edge counts not read", loggerTest.recordNum);
+
+    // Random counts and magnitudes, power offs and power losses
+    resetLoggerTest();
+    unsigned int lossNum = 0;
+    while (loggerTest.recordNum < LOGGER_TEST_RECORD_NUM)
+    {
+        unsigned int cycleTime = 1 + getTestRandom() % LOGGER_TEST_CYCLE_TIME_MAX;
+        double mean = exp(getTestUniform() * log(1E6));
+
+        for (unsigned int i = 0; (i < cycleTime) && (loggerTest.recordNum < LOGGER_TEST_RECORD_NUM); i++)
+        {
+            unsigned int random = getTestRandom();
+            unsigned int count = (random & 0xf)
+                                     ? getPoissonCount(mean)
+                                     : getTestRandom() >> (random >> 27);
+
+            logMinute(count);
+        }
+
+        // The records since the last block are lost on a power loss
+        bool isPowerLoss = getTestRandom() & 1;
+        if (isPowerLoss)
+        {
+            setSettingsWriteLimit(getTestRandom() % 40);
+            writeLogger();
+            setSettingsWriteLimit(-1);
+
+            lossNum++;
+        }
+        else
+            writeLogger();
+
+        initLogger();
+
+        readLoggerTest(isPowerLoss ? 0 : 1);
+    }
+
+    printf("%u records, %u power losses\n", loggerTest.recordNum, lossNum);
+    int result = endTest();
+    printf("\n");
+
+    // Records per KB, with the log ring full
+    static const double rates[] = {3, 30, 300, 3000, 30000, 300000};
+
+    printf("%-12s %14s %14s\n", "rate (cpm)", "records", "records/KB");
+    for (unsigned int i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        resetLoggerTest();
+        setTestRandomSeed(1);
+
+        for (unsigned int j = 0; j < LOGGER_TEST_RECORD_NUM; j++)
+            logMinute(getPoissonCount(rates[i]));
+        writeLogger();
+
+        unsigned int readNum = readLoggerTest(0);
+
+        printf("%-12.0f %14u %14.1f\n",
+               rates[i], readNum, 1024.0 * readNum / LOGGER_TEST_SIZE);
+    }
+
+    return result;
+}
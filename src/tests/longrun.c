@@ -0,0 +1,126 @@
+/*
+ * FS2011 Pro
+ * Long measurement test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/events.h"
+#include "../../cubeide/Core/fs2011pro/measurements.h"
+
+#include "test.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Fast-forwards the measurement clock past 2^32 pulses and past 2^32 ticks
+// (49.7 days) at a constant rate, and checks the average rate and
+// dose counters against the exact counts and their dead-time corrected
+// values against the rate corrected in double precision.
+
+#define LONGRUN_RATE 1500
+#define LONGRUN_TIME (4294967296ULL / TICK_FREQUENCY + 3600)
+
+#define LONGRUN_CORRECTED_ERROR_MAX 1E-5
+
+struct
+{
+    unsigned long long time;
+} longRunTest;
+
+double getRateValue(Rate rate)
+{
+#ifdef FIXED_POINT
+    return rate / (double)FIXED_ONE;
+#else
+    return rate;
+#endif
+}
+
+void checkLongRun(bool isValid, const char *message, double value, double expectedValue)
+{
+    checkTest(isValid, "%llu s: %s (%.6f instead of %.6f)",
+              longRunTest.time, message, value, expectedValue);
+}
+
+void checkLongRunCorrected(const char *message, double value, double expectedValue)
+{
+    checkLongRun(fabs(value / expectedValue - 1) <= LONGRUN_CORRECTED_ERROR_MAX,
+                 message, value, expectedValue);
+}
+
+void checkLongRunMeasurements()
+{
+    const AverageRate *averageRate = &measurementContext.averageRate;
+    const Dose *dose = &measurementContext.dose;
+
+    // All the pulses of a second arrive on its first tick
+    unsigned long long pulseNum = LONGRUN_RATE * longRunTest.time;
+    double rawRate = LONGRUN_RATE * (double)longRunTest.time / (longRunTest.time - 1);
+    double correctedRate = LONGRUN_RATE / (1 - LONGRUN_RATE * (double)DEAD_TIME);
+
+    checkLongRun(averageRate->tick == TICK_FREQUENCY * longRunTest.time,
+                 "average rate tick differs",
+                 averageRate->tick, TICK_FREQUENCY * longRunTest.time);
+    checkLongRun(averageRate->snapshotCount == pulseNum - 1,
+                 "average rate count differs",
+                 averageRate->snapshotCount, pulseNum - 1);
+    checkLongRun(averageRate->snapshotPeriod == 1000000 * (longRunTest.time - 1),
+                 "average rate period differs",
+                 averageRate->snapshotPeriod, 1000000 * (longRunTest.time - 1));
+    checkLongRunCorrected("average rate differs",
+                          getRateValue(averageRate->snapshotValue),
+                          rawRate / (1 - rawRate * DEAD_TIME));
+    checkLongRun(!averageRate->isOverload, "average rate overload", 1, 0);
+
+    checkLongRun(dose->snapshotTime == longRunTest.time,
+                 "dose time differs", dose->snapshotTime, longRunTest.time);
+    checkLongRun(dose->snapshotValue == pulseNum,
+                 "dose differs", dose->snapshotValue, pulseNum);
+    checkLongRunCorrected("corrected dose differs",
+                          dose->correctedValue, correctedRate * longRunTest.time);
+}
+
+int main()
+{
+    initMeasurements();
+    resetAverageRate();
+    resetDose();
+
+    unsigned long long checkTimes[] = {
+        3600,
+        4294967296ULL / LONGRUN_RATE + 1,
+        4294967296ULL / TICK_FREQUENCY,
+        4294967296ULL / TICK_FREQUENCY + 1,
+        LONGRUN_TIME,
+    };
+    unsigned int checkIndex = 0;
+
+    while (longRunTest.time < LONGRUN_TIME)
+    {
+        onMeasurementTick(LONGRUN_RATE, NULL);
+        skipMeasurementTicks(TICK_FREQUENCY - 1);
+        onMeasurementOneSecond();
+        updateMeasurements();
+
+        longRunTest.time++;
+
+        if (longRunTest.time == checkTimes[checkIndex])
+        {
+            checkLongRunMeasurements();
+
+            printf("%9llu s: average rate %.3f cps, dose %llu (corrected %llu)\n",
+                   longRunTest.time,
+                   getRateValue(measurementContext.averageRate.snapshotValue),
+                   measurementContext.dose.snapshotValue,
+                   measurementContext.dose.correctedValue);
+
+            checkIndex++;
+        }
+    }
+
+    return endTest();
+}
@@ -0,0 +1,115 @@
+/*
+ * FS2011 Pro
+ * Page font test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/display.h"
+
+#include "../../cubeide/Core/fs2011pro/u8g2/u8g2.h"
+
+#include "../../cubeide/Core/fs2011pro/resources/font_helvR24.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Draws random strings of the page font glyphs (45-57) with
+// drawPageFontText() and with u8g2_DrawStr() and font_helvR24, at random
+// positions on blank and random backgrounds, clipped at the left, right
+// and bottom edges of the buffer and at the top of the first page. Both
+// buffers must be identical. Then reports the time per 5-character
+// measurement value of both.
+
+#define PAGEFONT_TRIAL_NUM 50000
+#define PAGEFONT_BENCHMARK_NUM 20000
+
+#define PAGEFONT_BUFFER_SIZE (DISPLAY_PAGES * 128)
+#define PAGEFONT_STRING_SIZE 8
+
+// Page font glyphs (font_helvR24_digits.h)
+#define PAGEFONT_FIRST 45
+#define PAGEFONT_NUM 13
+#define PAGEFONT_BASELINE_ROW 4
+
+extern u8g2_t u8g2;
+
+void drawPageFontText(const char *str, int x, int y);
+
+void setRandomString(char *str, unsigned int size)
+{
+    for (unsigned int i = 0; i < size; i++)
+        str[i] = PAGEFONT_FIRST + getTestRandom() % PAGEFONT_NUM;
+    str[size] = '\0';
+}
+
+int main()
+{
+    static uint8_t background[PAGEFONT_BUFFER_SIZE];
+    static uint8_t expected[PAGEFONT_BUFFER_SIZE];
+
+    initDisplay();
+
+    uint8_t *buffer = u8g2_GetBufferPtr(&u8g2);
+    u8g2_SetFont(&u8g2, font_helvR24);
+
+    for (unsigned int i = 0; i < PAGEFONT_TRIAL_NUM; i++)
+    {
+        char str[PAGEFONT_STRING_SIZE + 1];
+        setRandomString(str, 1 + getTestRandom() % PAGEFONT_STRING_SIZE);
+
+        // Baselines from the first page to below the buffer, as u8g2
+        // coordinates are unsigned
+        int x = (int)(getTestRandom() % 200) - 40;
+        int y = 8 * (int)(getTestRandom() % (DISPLAY_PAGES + 2)) +
+                PAGEFONT_BASELINE_ROW;
+
+        bool isBlank = getTestRandom() & 1;
+        for (unsigned int j = 0; j < PAGEFONT_BUFFER_SIZE; j++)
+            background[j] = isBlank ? 0 : getTestRandom();
+
+        memcpy(buffer, background, PAGEFONT_BUFFER_SIZE);
+        u8g2_DrawStr(&u8g2, x, y, str);
+        memcpy(expected, buffer, PAGEFONT_BUFFER_SIZE);
+
+        memcpy(buffer, background, PAGEFONT_BUFFER_SIZE);
+        drawPageFontText(str, x, y);
+
+        checkTest(!memcmp(buffer, expected, PAGEFONT_BUFFER_SIZE),
+                  "\"%s\" at (%d, %d) on a %s background differs",
+                  str, x, y, isBlank ? "blank" : "random");
+    }
+
+    int result = endTest();
+
+    // Benchmark: a measurement value at its position
+    char str[6];
+    setRandomString(str, 5);
+
+    double startTime = getTestTime();
+    for (unsigned int i = 0; i < PAGEFONT_BENCHMARK_NUM; i++)
+    {
+        str[i % 5] = PAGEFONT_FIRST + i % PAGEFONT_NUM;
+        u8g2_DrawStr(&u8g2, 10, 44, str);
+    }
+    double drawStrTime = getTestTime() - startTime;
+
+    startTime = getTestTime();
+    for (unsigned int i = 0; i < PAGEFONT_BENCHMARK_NUM; i++)
+    {
+        str[i % 5] = PAGEFONT_FIRST + i % PAGEFONT_NUM;
+        drawPageFontText(str, 10, 44);
+    }
+    double pageFontTime = getTestTime() - startTime;
+
+    printf("5-character value: u8g2_DrawStr %.3f us, drawPageFontText %.3f us\n",
+           1E6 * drawStrTime / PAGEFONT_BENCHMARK_NUM,
+           1E6 * pageFontTime / PAGEFONT_BENCHMARK_NUM);
+
+    return result;
+}
@@ -0,0 +1,199 @@
+/*
+ * FS2011 Pro
+ * Pulse queue stress test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/display.h"
+#include "../../cubeide/Core/fs2011pro/events.h"
+#include "../../cubeide/Core/fs2011pro/keyboard.h"
+#include "../../cubeide/Core/fs2011pro/logger.h"
+#include "../../cubeide/Core/fs2011pro/measurements.h"
+#include "../../cubeide/Core/fs2011pro/menus.h"
+#include "../../cubeide/Core/fs2011pro/power.h"
+#include "../../cubeide/Core/fs2011pro/settings.h"
+
+#include "test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Runs the tick interrupt (triggerPulse() and onEventsTick()) and the main
+// loop (updateEvents()) on separate threads. While the main loop keeps up,
+// the measurements must have counted exactly the pulses of the ticks they
+// replayed, so a lost, repeated or torn pulse queue record shows at the
+// next check. Then the tick thread runs unthrottled, so the queue fills
+// and pulses are held back: the pulse count may lag, but must never exceed
+// the pulses produced, and every pulse must arrive in the end.
+
+#define QUEUE_THROTTLED_TICKS 1000000
+#define QUEUE_UNTHROTTLED_TICKS 1000000
+#define QUEUE_AHEAD_TICKS_MAX 16
+#define QUEUE_FLUSH_TICKS_MAX 100000
+
+struct
+{
+    // Pulses produced before each tick of the throttled phase
+    unsigned int pulseSums[QUEUE_THROTTLED_TICKS + 1];
+
+    // Tick thread
+    unsigned long long pulseNum;
+    unsigned long long tick;
+    bool isDone;
+
+    // Main loop thread
+    unsigned long long startTick;
+    unsigned long long startPulseCount;
+    unsigned long long replayedTick;
+    unsigned long long replayedPulseNum;
+} queueTest;
+
+void checkQueue(bool isValid, const char *message, unsigned long long tick)
+{
+    checkTest(isValid, "tick %llu: %s", tick, message);
+}
+
+unsigned long long loadQueueValue(unsigned long long *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+void storeQueueValue(unsigned long long *value, unsigned long long newValue)
+{
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+// Bursts of up to 15 pulses, about 1000 cps
+unsigned int getQueueTestPulseCount()
+{
+    unsigned int random = getTestRandom();
+
+    return (random & 0x7) ? 0 : (random >> 8) & 0xf;
+}
+
+void runQueueTick(unsigned int pulseCount)
+{
+    storeQueueValue(&queueTest.pulseNum, queueTest.pulseNum + pulseCount);
+
+    for (unsigned int i = 0; i < pulseCount; i++)
+        triggerPulse();
+    onEventsTick();
+
+    storeQueueValue(&queueTest.tick, queueTest.tick + 1);
+}
+
+void waitQueueMainLoop()
+{
+    while ((queueTest.tick - loadQueueValue(&queueTest.replayedTick)) >= QUEUE_AHEAD_TICKS_MAX)
+        sched_yield();
+}
+
+void *runTickThread(void *arg)
+{
+    (void)arg;
+
+    for (unsigned int i = 0; i < QUEUE_THROTTLED_TICKS; i++)
+    {
+        waitQueueMainLoop();
+
+        unsigned int pulseCount = getQueueTestPulseCount();
+        queueTest.pulseSums[i + 1] = queueTest.pulseSums[i] + pulseCount;
+        runQueueTick(pulseCount);
+    }
+
+    for (unsigned int i = 0; i < QUEUE_UNTHROTTLED_TICKS; i++)
+        runQueueTick(getQueueTestPulseCount());
+
+    // Held back pulses are queued by the next ticks
+    for (unsigned int i = 0;
+         (i < QUEUE_FLUSH_TICKS_MAX) &&
+         (loadQueueValue(&queueTest.replayedPulseNum) < queueTest.pulseNum);
+         i++)
+    {
+        waitQueueMainLoop();
+        runQueueTick(0);
+    }
+
+    __atomic_store_n(&queueTest.isDone, true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+void *runMainLoopThread(void *arg)
+{
+    (void)arg;
+
+    unsigned long long lastPulseNum = 0;
+
+    while (true)
+    {
+        bool isDone = __atomic_load_n(&queueTest.isDone, __ATOMIC_ACQUIRE);
+        unsigned long long tick = loadQueueValue(&queueTest.tick);
+
+        updateEvents();
+        getEventsKey();
+
+        unsigned long long replayedTick = measurementContext.averageRate.tick - queueTest.startTick;
+        unsigned long long replayedPulseNum = measurementContext.dose.pulseCount - queueTest.startPulseCount;
+        unsigned long long pulseNum = loadQueueValue(&queueTest.pulseNum);
+
+        if (replayedTick <= QUEUE_THROTTLED_TICKS)
+            checkQueue(replayedPulseNum == queueTest.pulseSums[replayedTick],
+                       "replayed pulses differ", replayedTick);
+        else
+        {
+            checkQueue(replayedPulseNum >= lastPulseNum, "pulse count decreased", replayedTick);
+            checkQueue(replayedPulseNum <= pulseNum, "more pulses than produced", replayedTick);
+        }
+
+        lastPulseNum = replayedPulseNum;
+        storeQueueValue(&queueTest.replayedPulseNum, replayedPulseNum);
+        storeQueueValue(&queueTest.replayedTick, replayedTick);
+
+        if (isDone && (replayedTick == tick))
+            break;
+
+        if (replayedTick == tick)
+            sched_yield();
+    }
+
+    return NULL;
+}
+
+int main()
+{
+    initKeyboard();
+    initPower();
+    initDisplay();
+
+    readSettings();
+    settings.pulseSound = PULSE_SOUND_OFF;
+
+    initEvents();
+    initMeasurements();
+    initLogger();
+    initMenus();
+
+    queueTest.startTick = measurementContext.averageRate.tick;
+    queueTest.startPulseCount = measurementContext.dose.pulseCount;
+
+    pthread_t tickThread;
+    pthread_t mainLoopThread;
+    pthread_create(&mainLoopThread, NULL, runMainLoopThread, NULL);
+    pthread_create(&tickThread, NULL, runTickThread, NULL);
+    pthread_join(tickThread, NULL);
+    pthread_join(mainLoopThread, NULL);
+
+    checkQueue(queueTest.replayedPulseNum == queueTest.pulseNum,
+               "pulses lost", queueTest.tick);
+
+    printf("%llu ticks, %llu pulses, %u pulse queue overflows\n",
+           queueTest.tick, queueTest.pulseNum, getEventsPulseOverflowCount());
+
+    return endTest();
+}
@@ -0,0 +1,248 @@
+/*
+ * FS2011 Pro
+ * Settings flash test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/checkpoint.h"
+#include "../../cubeide/Core/fs2011pro/settings.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Writes settings records in the format of the firmware before the
+// confidence level setting, which flashed the unused bits of the first
+// word as 0, and reads them with readSettings(): every setting must be
+// restored, and the confidence level must read as the 95% default. Then
+// each confidence level must survive writeSettings() and readSettings().
+//
+// That firmware kept its ring in pages 0x30-0x3f, which now start with the
+// checkpoint pages: readSettings() must move the latest record of such a
+// ring to pages 0x38-0x3f and erase pages 0x30-0x37, once, and must leave
+// the checkpoint pages alone once they hold a bank.
+
+// Settings ring (settings.c)
+#define SETTINGS_TEST_LEGACY_PAGE_START 0x30
+#define SETTINGS_TEST_PAGE_START 0x38
+#define SETTINGS_TEST_PAGE_END 0x40
+
+#define SETTINGS_TEST_RECORD_SIZE 16
+#define SETTINGS_TEST_PER_PAGE (SETTINGS_PAGE_SIZE / SETTINGS_TEST_RECORD_SIZE)
+#define SETTINGS_TEST_LEGACY_RECORD_NUM \
+    ((SETTINGS_TEST_PAGE_END - SETTINGS_TEST_LEGACY_PAGE_START) * SETTINGS_TEST_PER_PAGE)
+
+typedef struct
+{
+    unsigned int units;
+    unsigned int history;
+    unsigned int rateAlarm;
+    unsigned int doseAlarm;
+    unsigned int pulseSound;
+    unsigned int backlight;
+    unsigned int batteryType;
+    unsigned int gameSkillLevel;
+    unsigned int lifeTimer;
+    unsigned long long lifeCounts;
+} BaselineSettings;
+
+static const BaselineSettings baselineSettings[] = {
+    {UNITS_SIEVERTS, 0, RATE_ALARM_OFF, DOSE_ALARM_OFF, PULSE_SOUND_QUIET, BACKLIGHT_10S, BATTERY_NI_MH, 0, 0, 0},
+    {UNITS_CPM, 4, RATE_ALARM_2, DOSE_ALARM_50, PULSE_SOUND_LOUD, BACKLIGHT_ON, BATTERY_ALKALINE, 7, 123456, 9876543210ULL},
+    {UNITS_REM, 7, RATE_ALARM_100, DOSE_ALARM_1000, PULSE_SOUND_OFF, BACKLIGHT_OFF, BATTERY_NI_MH, 3, 0xfffffffe, 1},
+};
+
+// The record of the firmware before the confidence level: bit fields from
+// the least significant bit, the rest of the first word 0
+void getBaselineRecord(const BaselineSettings *baseline, unsigned char *record)
+{
+    unsigned int word = baseline->units |
+                        (baseline->history << 2) |
+                        (baseline->rateAlarm << 5) |
+                        (baseline->doseAlarm << 10) |
+                        (baseline->pulseSound << 15) |
+                        (baseline->backlight << 17) |
+                        (baseline->batteryType << 19) |
+                        (baseline->gameSkillLevel << 20) |
+                        (SETTING_VALID << 23);
+
+    memcpy(record, &word, 4);
+    memcpy(record + 4, &baseline->lifeTimer, 4);
+    memcpy(record + 8, &baseline->lifeCounts, 8);
+}
+
+void eraseSettingsTestPages(int pageStart)
+{
+    for (int pageIndex = pageStart; pageIndex < SETTINGS_TEST_PAGE_END; pageIndex++)
+        eraseSettingsPage(pageIndex);
+}
+
+bool isSettingsTestPageErased(int pageIndex)
+{
+    const unsigned char *page = getSettingsAddress(pageIndex, 0);
+
+    for (unsigned int i = 0; i < SETTINGS_PAGE_SIZE; i++)
+    {
+        if (page[i] != 0xff)
+            return false;
+    }
+
+    return true;
+}
+
+// Writes recordNum records the way the earlier firmware did, each with
+// its record number as life timer: the page after the current one is
+// erased before its last slot is written
+void writeLegacySettingsRing(const BaselineSettings *baseline, unsigned int recordNum)
+{
+    eraseSettingsTestPages(SETTINGS_TEST_LEGACY_PAGE_START);
+
+    for (unsigned int i = 0; i < recordNum; i++)
+    {
+        unsigned int slot = i % SETTINGS_TEST_LEGACY_RECORD_NUM;
+        int pageIndex = SETTINGS_TEST_LEGACY_PAGE_START + slot / SETTINGS_TEST_PER_PAGE;
+        unsigned int index = slot % SETTINGS_TEST_PER_PAGE;
+
+        if (index == (SETTINGS_TEST_PER_PAGE - 1))
+            eraseSettingsPage((pageIndex + 1 < SETTINGS_TEST_PAGE_END)
+                                  ? pageIndex + 1
+                                  : SETTINGS_TEST_LEGACY_PAGE_START);
+
+        BaselineSettings record = *baseline;
+        record.lifeTimer = i;
+
+        unsigned char data[SETTINGS_TEST_RECORD_SIZE];
+        getBaselineRecord(&record, data);
+        writeSettingsData(getSettingsAddress(pageIndex, index), data, sizeof(data));
+    }
+}
+
+void checkBaselineSettings(const BaselineSettings *baseline, unsigned int index)
+{
+    checkTest((settings.units == baseline->units) &&
+                  (settings.history == baseline->history) &&
+                  (settings.rateAlarm == baseline->rateAlarm) &&
+                  (settings.doseAlarm == baseline->doseAlarm) &&
+                  (settings.pulseSound == baseline->pulseSound) &&
+                  (settings.backlight == baseline->backlight) &&
+                  (settings.batteryType == baseline->batteryType) &&
+                  (settings.gameSkillLevel == baseline->gameSkillLevel) &&
+                  (settings.lifeTimer == baseline->lifeTimer) &&
+                  (settings.lifeCounts == baseline->lifeCounts),
+              "baseline record %u: settings differ", index);
+    checkTest(getConfidenceLevel() == CONFIDENCE_LEVEL_95,
+              "baseline record %u: confidence level %u instead of 95%%",
+              index, getConfidenceLevel());
+}
+
+void checkLegacySettings(const BaselineSettings *baseline, unsigned int recordNum)
+{
+    BaselineSettings record = *baseline;
+    record.lifeTimer = recordNum - 1;
+
+    checkBaselineSettings(&record, recordNum);
+
+    bool isErased = true;
+    for (int pageIndex = SETTINGS_TEST_LEGACY_PAGE_START; pageIndex < SETTINGS_TEST_PAGE_START; pageIndex++)
+        isErased &= isSettingsTestPageErased(pageIndex);
+    checkTest(isErased, "legacy ring of %u records: checkpoint pages not erased", recordNum);
+}
+
+int main()
+{
+    checkTest(sizeof(Settings) == SETTINGS_TEST_RECORD_SIZE,
+              "settings record of %u bytes", (unsigned int)sizeof(Settings));
+
+    setSettingsFlashKept(true);
+
+    // Baseline records, as the latest of the ring
+    for (unsigned int i = 0; i < sizeof(baselineSettings) / sizeof(baselineSettings[0]); i++)
+    {
+        unsigned char record[SETTINGS_TEST_RECORD_SIZE];
+        getBaselineRecord(&baselineSettings[i], record);
+
+        eraseSettingsTestPages(SETTINGS_TEST_PAGE_START);
+        for (unsigned int j = 0; j <= i; j++)
+            writeSettingsData(getSettingsAddress(SETTINGS_TEST_PAGE_START, j),
+                              record, sizeof(record));
+
+        readSettings();
+        checkBaselineSettings(&baselineSettings[i], i);
+
+        // The upgraded firmware keeps the settings
+        writeSettings();
+        readSettings();
+        checkBaselineSettings(&baselineSettings[i], i);
+    }
+
+    // Every level
+    for (unsigned int level = CONFIDENCE_LEVEL_68; level <= CONFIDENCE_LEVEL_99; level++)
+    {
+        setConfidenceLevel(level);
+        writeSettings();
+
+        setConfidenceLevel(CONFIDENCE_LEVEL_68);
+        readSettings();
+
+        checkTest(getConfidenceLevel() == level,
+                  "confidence level %u read as %u", level, getConfidenceLevel());
+    }
+
+    // Legacy rings, with the latest record in each half and wrapped
+    static const unsigned int legacyRecordNums[] = {
+        1,
+        3 * SETTINGS_TEST_PER_PAGE + 5,
+        8 * SETTINGS_TEST_PER_PAGE - 1,
+        8 * SETTINGS_TEST_PER_PAGE + 5,
+        SETTINGS_TEST_LEGACY_RECORD_NUM - 1,
+        SETTINGS_TEST_LEGACY_RECORD_NUM + 10,
+        2 * SETTINGS_TEST_LEGACY_RECORD_NUM + 9 * SETTINGS_TEST_PER_PAGE,
+    };
+
+    for (unsigned int i = 0; i < sizeof(legacyRecordNums) / sizeof(legacyRecordNums[0]); i++)
+    {
+        unsigned int recordNum = legacyRecordNums[i];
+
+        writeLegacySettingsRing(&baselineSettings[1], recordNum);
+        readSettings();
+        checkLegacySettings(&baselineSettings[1], recordNum);
+
+        readSettings();
+        checkLegacySettings(&baselineSettings[1], recordNum);
+
+        // Not moved again
+        settings.units = UNITS_CPS;
+        writeSettings();
+        readSettings();
+        checkTest(settings.units == UNITS_CPS,
+                  "legacy ring of %u records: moved again", recordNum);
+    }
+
+    // A checkpoint bank is no legacy ring
+    eraseSettingsTestPages(SETTINGS_TEST_LEGACY_PAGE_START);
+    settings.units = UNITS_CPM;
+    writeSettings();
+
+    unsigned int checkpointData = 0x12345678;
+    initCheckpoint();
+    startCheckpointSnapshot(0, 0, sizeof(checkpointData));
+    writeCheckpointData(&checkpointData, sizeof(checkpointData));
+    endCheckpointRecord();
+
+    readSettings();
+    checkTest(settings.units == UNITS_CPM, "checkpoint bank: settings lost");
+
+    initCheckpoint();
+    unsigned int type, argument, size;
+    checkpointData = 0;
+    if (readCheckpointRecord(&type, &argument, &size))
+        readCheckpointData(&checkpointData, sizeof(checkpointData));
+    checkTest(checkpointData == 0x12345678, "checkpoint bank: snapshot lost");
+
+    return endTest();
+}
@@ -0,0 +1,97 @@
+/*
+ * FS2011 Pro
+ * Host test helpers
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "test.h"
+
+struct
+{
+    unsigned long long random;
+
+    unsigned int checkNum;
+    unsigned int failureNum;
+} test = {
+    .random = 1,
+};
+
+// The tests run the firmware without SDL
+void onSDLTick()
+{
+}
+
+void setTestRandomSeed(unsigned long long seed)
+{
+    test.random = seed;
+}
+
+unsigned long long getTestRandomLong()
+{
+    // xorshift64
+    test.random ^= test.random << 13;
+    test.random ^= test.random >> 7;
+    test.random ^= test.random << 17;
+
+    return test.random;
+}
+
+unsigned int getTestRandom()
+{
+    return (unsigned int)(getTestRandomLong() >> 16);
+}
+
+// Uniform in (0, 1)
+double getTestUniform()
+{
+    return (getTestRandom() + 0.5) / 4294967296.0;
+}
+
+// Counts a check; prints the message of the first failures
+void checkTest(bool isValid, const char *format, ...)
+{
+    test.checkNum++;
+
+    if (!isValid)
+    {
+        if (test.failureNum < TEST_FAILURE_PRINT_MAX)
+        {
+            va_list args;
+            va_start(args, format);
+            vfprintf(stderr, format, args);
+            va_end(args);
+
+            fputc('\n', stderr);
+        }
+
+        test.failureNum++;
+    }
+}
+
+unsigned int getTestFailureNum()
+{
+    return test.failureNum;
+}
+
+// Prints the check count and returns the exit status
+int endTest()
+{
+    printf("%u checks, %u failures\n", test.checkNum, test.failureNum);
+
+    return test.failureNum ? 1 : 0;
+}
+
+double getTestTime()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + 1E-9 * time.tv_nsec;
+}
@@ -0,0 +1,29 @@
+/*
+ * FS2011 Pro
+ * Host test helpers
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdbool.h>
+
+// Failures printed to stderr; the rest are only counted
+#define TEST_FAILURE_PRINT_MAX 20
+
+void setTestRandomSeed(unsigned long long seed);
+unsigned long long getTestRandomLong();
+unsigned int getTestRandom();
+double getTestUniform();
+
+void checkTest(bool isValid, const char *format, ...);
+unsigned int getTestFailureNum();
+int endTest();
+
+double getTestTime();
+
+#endif
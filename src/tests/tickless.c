@@ -0,0 +1,219 @@
+/*
+ * FS2011 Pro
+ * Tickless sleep test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/display.h"
+#include "../../cubeide/Core/fs2011pro/events.h"
+#include "../../cubeide/Core/fs2011pro/keyboard.h"
+#include "../../cubeide/Core/fs2011pro/logger.h"
+#include "../../cubeide/Core/fs2011pro/measurements.h"
+#include "../../cubeide/Core/fs2011pro/menus.h"
+#include "../../cubeide/Core/fs2011pro/power.h"
+#include "../../cubeide/Core/fs2011pro/settings.h"
+
+#include "../headless/SDL.h"
+#include "../headless/headless.h"
+
+#include "test.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Replays the same pulse trains and key presses through the main loop,
+// sleeping as the firmware does: with TICKLESS, getEventsSleepTicks()
+// gives the ticks SysTick is stretched over, and a pulse or a key press
+// within them wakes the MCU early. The test is built with and without
+// TICKLESS, and tickless-equivalence compares the measurements both
+// builds print. The wake-ups per second (tick interrupts and EXTI
+// wake-ups) go to stderr.
+
+#define TICKLESS_SCENARIO_TIME 600
+#define TICKLESS_PRINT_TIME 10
+
+// A key press every 100 s, for 200 ms
+#define TICKLESS_KEY_PERIOD 100
+#define TICKLESS_KEY_TICKS 200
+
+static const float ticklessRates[] = {0.25F, 5, 100};
+
+struct
+{
+    unsigned long long tick;
+    unsigned long long nextPulseTick;
+    unsigned int nextPulseCount;
+
+    unsigned long long wakeNum;
+} ticklessTest;
+
+// Exponential inter-arrival times, one in eight ticks with two pulses
+void setNextPulse(float rate)
+{
+    double uniform = getTestUniform();
+    unsigned int random = getTestRandom();
+
+    ticklessTest.nextPulseTick += 1 + (unsigned long long)(-log(uniform) * TICK_FREQUENCY / rate);
+    ticklessTest.nextPulseCount = (random & 0x7) ? 1 : 2;
+}
+
+#define TICKLESS_KEY_PERIOD_TICKS (TICKLESS_KEY_PERIOD * TICK_FREQUENCY)
+#define TICKLESS_KEY_PRESS_TICK (TICKLESS_KEY_PERIOD_TICKS - TICKLESS_KEY_TICKS)
+
+bool isKeyDownTick(unsigned long long tick)
+{
+    return (tick % TICKLESS_KEY_PERIOD_TICKS) >= TICKLESS_KEY_PRESS_TICK;
+}
+
+// First tick from the current one with an EXTI interrupt: a pulse or a
+// key press
+unsigned long long getWakeTick()
+{
+    unsigned long long tick = ticklessTest.tick;
+    unsigned long long keyTick = tick +
+                                 (TICKLESS_KEY_PERIOD_TICKS + TICKLESS_KEY_PRESS_TICK -
+                                  tick % TICKLESS_KEY_PERIOD_TICKS) %
+                                     TICKLESS_KEY_PERIOD_TICKS;
+
+    return (keyTick < ticklessTest.nextPulseTick) ? keyTick : ticklessTest.nextPulseTick;
+}
+
+void runTicklessTick(float rate)
+{
+    setHeadlessKey(SDL_SCANCODE_DOWN, isKeyDownTick(ticklessTest.tick));
+
+    if (ticklessTest.tick == ticklessTest.nextPulseTick)
+    {
+        for (unsigned int i = 0; i < ticklessTest.nextPulseCount; i++)
+            triggerPulse();
+
+        setNextPulse(rate);
+    }
+
+    addHeadlessTicks(1);
+    onEventsTick();
+
+    ticklessTest.tick++;
+    ticklessTest.wakeNum++;
+}
+
+unsigned int getHistoryHash()
+{
+    // FNV-1a
+    unsigned int hash = 2166136261U;
+
+    for (unsigned int i = 0; i < HISTORY_NUM; i++)
+    {
+        const HistoryState *historyState = &measurementContext.historyStates[i];
+
+        for (unsigned int j = 0; j < HISTORY_BUFFER_SIZE; j++)
+        {
+            const HistoryDataPoint *dataPoint = &historyState->buffer[j];
+
+            hash = (hash ^ dataPoint->mean) * 16777619U;
+            hash = (hash ^ dataPoint->min) * 16777619U;
+            hash = (hash ^ dataPoint->max) * 16777619U;
+        }
+
+        hash = (hash ^ historyState->bufferIndex) * 16777619U;
+    }
+
+    return hash;
+}
+
+void printMeasurements()
+{
+    const InstantaneousRate *instantaneousRate = &measurementContext.instantaneousRate;
+    const AverageRate *averageRate = &measurementContext.averageRate;
+    const Dose *dose = &measurementContext.dose;
+
+    printf("%7llu: instantaneous %u/%u %.6g, average %llu/%llu %.6g, dose %llu %llu, history %08x, life %llu\n",
+           ticklessTest.tick / TICK_FREQUENCY,
+           instantaneousRate->snapshotCount, instantaneousRate->snapshotPeriod,
+           (double)instantaneousRate->snapshotValue,
+           averageRate->snapshotCount, averageRate->snapshotPeriod,
+           (double)averageRate->snapshotValue,
+           dose->snapshotValue, dose->correctedValue,
+           getHistoryHash(), settings.lifeCounts);
+}
+
+int main()
+{
+    initKeyboard();
+    initPower();
+    initDisplay();
+
+    readSettings();
+
+    initEvents();
+    initMeasurements();
+    initLogger();
+    initMenus();
+
+    for (unsigned int i = 0; i < sizeof(ticklessRates) / sizeof(ticklessRates[0]); i++)
+    {
+        float rate = ticklessRates[i];
+        unsigned long long endTick = ticklessTest.tick + TICKLESS_SCENARIO_TIME * TICK_FREQUENCY;
+        unsigned long long wakeNum = 0;
+
+        resetAverageRate();
+        resetDose();
+
+        ticklessTest.nextPulseTick = ticklessTest.tick;
+        setNextPulse(rate);
+        ticklessTest.wakeNum = 0;
+
+        printf("%g cps\n", rate);
+
+        while (ticklessTest.tick < endTick)
+        {
+            // Main loop
+            updateEvents();
+            getEventsKey();
+
+            unsigned int sleepTicks = getEventsSleepTicks();
+            if (sleepTicks)
+            {
+                unsigned long long wakeTick = getWakeTick();
+                unsigned int skippedTicks = sleepTicks;
+
+                if (wakeTick < (ticklessTest.tick + sleepTicks))
+                {
+                    skippedTicks = (unsigned int)(wakeTick - ticklessTest.tick);
+
+                    wakeNum++;
+                }
+
+                skipEventsSleepTicks(skippedTicks);
+                addHeadlessTicks(skippedTicks);
+                ticklessTest.tick += skippedTicks;
+            }
+            else if (ticklessTest.tick == getWakeTick())
+                wakeNum++;
+
+            // Tick interrupt
+            if (ticklessTest.tick < endTick)
+            {
+                runTicklessTick(rate);
+
+                // After a one-second tick, which is never slept over
+                if ((ticklessTest.tick % (TICKLESS_PRINT_TIME * TICK_FREQUENCY)) == 1)
+                {
+                    updateEvents();
+                    getEventsKey();
+
+                    printMeasurements();
+                }
+            }
+        }
+
+        fprintf(stderr, "%g cps: %.1f wake-ups/s\n",
+                rate, (double)(ticklessTest.wakeNum + wakeNum) / TICKLESS_SCENARIO_TIME);
+    }
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * FS2011 Pro
+ * LCD DMA word stream test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/display.h"
+#include "../../cubeide/Core/fs2011pro/events.h"
+#include "../../cubeide/Core/fs2011pro/keyboard.h"
+#include "../../cubeide/Core/fs2011pro/logger.h"
+#include "../../cubeide/Core/fs2011pro/measurements.h"
+#include "../../cubeide/Core/fs2011pro/menus.h"
+#include "../../cubeide/Core/fs2011pro/power.h"
+#include "../../cubeide/Core/fs2011pro/settings.h"
+#include "../../cubeide/Core/fs2011pro/sim.h"
+#include "../../cubeide/Core/fs2011pro/ui.h"
+
+#include "../headless/headless.h"
+
+#include "test.h"
+
+#include <stdio.h>
+
+// Encodes byte streams with encodeDisplayWords() (LCD_DMA) and replays the
+// GPIOA and GPIOF BSRR words on simulated ports. Each byte must leave the
+// same pins as the per-byte CPU send in onDisplayByte(), and no pin outside
+// the LCD bus may change. The streams are every byte value and the frames
+// of the views.
+
+#define WORDS_VIEW_TIME 30
+#define WORDS_UI_TICKS 10
+
+// LCD bus: D0-D4 on PA8-PA12, D5 and D6 on PF6 and PF7, D7 on PA15
+#define WORDS_GPIOA_MASK 0x9f00
+#define WORDS_GPIOF_MASK 0x00c0
+
+// The words written by the CPU send for a byte
+void encodeByteWords(uint8_t value, uint32_t *gpioAWord, uint32_t *gpioFWord)
+{
+    unsigned int gpioA = ((value & 0x1f) << 8) | ((value & 0x80) << 8);
+    unsigned int gpioF = ((value >> 5) & 0x3) << 6;
+
+    *gpioAWord = (WORDS_GPIOA_MASK << 16) | gpioA;
+    *gpioFWord = (WORDS_GPIOF_MASK << 16) | gpioF;
+}
+
+// BSRR: the low half sets pins, the high half resets them, set wins
+unsigned short applyBSRR(unsigned short odr, uint32_t word)
+{
+    return (odr & ~(word >> 16)) | (word & 0xffff);
+}
+
+uint8_t readLCDBus(unsigned short gpioA, unsigned short gpioF)
+{
+    return ((gpioA >> 8) & 0x1f) |
+           (((gpioF >> 6) & 0x3) << 5) |
+           (((gpioA >> 15) & 0x1) << 7);
+}
+
+void checkWords(const char *name, const uint8_t *data, unsigned int size)
+{
+    static uint32_t gpioAWords[DISPLAY_PAGES * 128];
+    static uint32_t gpioFWords[DISPLAY_PAGES * 128];
+
+    encodeDisplayWords(data, size, gpioAWords, gpioFWords);
+
+    // Other pins hold a pattern that must survive
+    unsigned short gpioA = 0x5a5a;
+    unsigned short gpioF = 0xa5a5;
+
+    for (unsigned int i = 0; i < size; i++)
+    {
+        uint32_t gpioAWord;
+        uint32_t gpioFWord;
+        encodeByteWords(data[i], &gpioAWord, &gpioFWord);
+
+        gpioA = applyBSRR(gpioA, gpioAWords[i]);
+        gpioF = applyBSRR(gpioF, gpioFWords[i]);
+
+        bool isValid = (gpioAWords[i] == gpioAWord) &&
+                       (gpioFWords[i] == gpioFWord) &&
+                       (readLCDBus(gpioA, gpioF) == data[i]) &&
+                       ((gpioA & ~WORDS_GPIOA_MASK) == (0x5a5a & ~WORDS_GPIOA_MASK)) &&
+                       ((gpioF & ~WORDS_GPIOF_MASK) == (0xa5a5 & ~WORDS_GPIOF_MASK));
+
+        checkTest(isValid, "%s, byte %u (0x%02x): words %08x %08x instead of %08x %08x",
+                  name, i, data[i],
+                  gpioAWords[i], gpioFWords[i], gpioAWord, gpioFWord);
+    }
+}
+
+void runWordsTicks(unsigned int ticks)
+{
+    for (unsigned int i = 1; i <= ticks; i++)
+    {
+        onSimTick();
+        addHeadlessTicks(1);
+        onEventsTick();
+
+        if (!(i % WORDS_UI_TICKS))
+            updateUI();
+    }
+}
+
+int main()
+{
+    uint8_t values[256];
+    for (int i = 0; i < 256; i++)
+        values[i] = i;
+    checkWords("values", values, 256);
+
+    initSim(SIM_SEED);
+    setSimRate(50);
+
+    initKeyboard();
+    initPower();
+    initDisplay();
+
+    readSettings();
+
+    initEvents();
+    initMeasurements();
+    initLogger();
+    initMenus();
+
+    static const unsigned char views[] = {
+        VIEW_INSTANTANEOUS_RATE,
+        VIEW_AVERAGE_RATE,
+        VIEW_DOSE,
+        VIEW_HISTORY,
+        VIEW_STATS,
+    };
+
+    for (unsigned int i = 0; i < sizeof(views); i++)
+    {
+        setView(views[i]);
+        runWordsTicks(WORDS_VIEW_TIME * TICK_FREQUENCY);
+
+        checkWords("frame", getHeadlessFrame(), DISPLAY_PAGES * 128);
+    }
+
+    return endTest();
+}
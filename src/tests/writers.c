@@ -0,0 +1,249 @@
+/*
+ * FS2011 Pro
+ * Format writer test
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../../cubeide/Core/fs2011pro/format.h"
+
+#include "test.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Compares the format.c writers with the sprintf formats they replaced,
+// then reports the host time per call of both. Host times only compare
+// the code paths, they are no Cortex-M0 cycle counts.
+
+#define WRITERS_RANDOM_NUM 1000000
+#define WRITERS_BENCH_NUM 200000
+
+void formatMantissa(int mantissa, int decimalPoint, char *mantissaBuffer);
+
+void checkString(const char *name, const char *value, const char *reference)
+{
+    checkTest(!strcmp(value, reference),
+              "%s: \"%s\" instead of \"%s\"", name, value, reference);
+}
+
+void checkDigits(int value, int width)
+{
+    char buffer[32];
+    char reference[32];
+
+    char *end = formatDigits(value, width, buffer);
+    snprintf(reference, sizeof(reference), "%0*d", width, value);
+
+    checkString("formatDigits", buffer, reference);
+    if (end != buffer + strlen(buffer))
+        checkString("formatDigits end", "", "end of string");
+}
+
+void checkMantissa(int mantissa, int decimalPoint)
+{
+    static const int divisors[] = {1000, 100, 10};
+
+    char buffer[32];
+    char reference[32];
+
+    formatMantissa(mantissa, decimalPoint, buffer);
+    int length = snprintf(reference, sizeof(reference), "%d.%0*d",
+                          mantissa / divisors[decimalPoint],
+                          3 - decimalPoint,
+                          mantissa % divisors[decimalPoint]);
+    if (length >= (int)sizeof(reference))
+    {
+        checkString("formatMantissa reference", "", "not truncated");
+
+        return;
+    }
+
+    checkString("formatMantissa", buffer, reference);
+}
+
+void checkHex(unsigned int value)
+{
+    char buffer[32];
+    char reference[32];
+
+    formatHex(value, buffer);
+    snprintf(reference, sizeof(reference), "%08x", value);
+
+    checkString("formatHex", buffer, reference);
+}
+
+void checkUnsignedLongLong(unsigned long long value)
+{
+    char buffer[32];
+    char reference[32];
+
+    char *end = formatUnsignedLongLong(value, buffer);
+    snprintf(reference, sizeof(reference), "%llu", value);
+
+    checkString("formatUnsignedLongLong", buffer, reference);
+    if (end != buffer + strlen(buffer))
+        checkString("formatUnsignedLongLong end", "", "end of string");
+}
+
+void checkTime(unsigned int time)
+{
+    char buffer[32];
+    char reference[32];
+
+    formatTime(time, buffer);
+
+    unsigned int hours = time / 3600;
+    if (hours)
+        snprintf(reference, sizeof(reference), "%u:%02u:%02u",
+                 hours, (time / 60) % 60, time % 60);
+    else
+        snprintf(reference, sizeof(reference), "%02u:%02u",
+                 (time / 60) % 60, time % 60);
+
+    checkString("formatTime", buffer, reference);
+}
+
+// Returns ns per call
+double benchWriter(int type, bool isReference)
+{
+    char buffer[32];
+    volatile char sink = 0;
+
+    setTestRandomSeed(1);
+
+    clock_t startTime = clock();
+
+    for (unsigned int i = 0; i < WRITERS_BENCH_NUM; i++)
+    {
+        unsigned long long value = getTestRandomLong();
+
+        switch (type)
+        {
+        case 0:
+            if (isReference)
+                snprintf(buffer, sizeof(buffer), "%0*d", 4, (int)(value % 100000));
+            else
+                formatDigits((int)(value % 100000), 4, buffer);
+            break;
+
+        case 1:
+            if (isReference)
+                snprintf(buffer, sizeof(buffer), "%d.%0*d",
+                         (int)(value % 10000) / 100, 2, (int)(value % 10000) % 100);
+            else
+                formatMantissa((int)(value % 10000), 1, buffer);
+            break;
+
+        case 2:
+            if (isReference)
+                snprintf(buffer, sizeof(buffer), "%llu", value >> (value & 63));
+            else
+                formatUnsignedLongLong(value >> (value & 63), buffer);
+            break;
+
+        case 3:
+        {
+            unsigned int time = (unsigned int)(value % 360000);
+            if (isReference)
+                snprintf(buffer, sizeof(buffer), "%u:%02u:%02u",
+                         time / 3600, (time / 60) % 60, time % 60);
+            else
+                formatTime(time, buffer);
+            break;
+        }
+        }
+
+        sink += buffer[0];
+    }
+
+    clock_t endTime = clock();
+
+    return 1E9 * (endTime - startTime) / CLOCKS_PER_SEC / WRITERS_BENCH_NUM;
+}
+
+int main()
+{
+    // formatDigits
+    for (int i = -1000000; i <= 1000000; i++)
+    {
+        checkDigits(i, 1);
+        checkDigits(i, 4);
+    }
+
+    for (int width = 1; width <= 11; width++)
+    {
+        for (long long powerOfTen = 1; powerOfTen <= INT_MAX; powerOfTen *= 10)
+            for (int j = -1; j <= 1; j++)
+            {
+                checkDigits((int)(powerOfTen + j), width);
+                checkDigits((int)(-powerOfTen - j), width);
+            }
+
+        checkDigits(INT_MAX, width);
+        checkDigits(INT_MIN, width);
+    }
+
+    // formatMantissa
+    for (int i = 0; i < 100000; i++)
+        for (int decimalPoint = 0; decimalPoint < 3; decimalPoint++)
+            checkMantissa(i, decimalPoint);
+
+    // formatHex
+    setTestRandomSeed(1);
+    for (unsigned int i = 0; i < 32; i++)
+    {
+        checkHex(1U << i);
+        checkHex((1U << i) - 1);
+    }
+    for (unsigned int i = 0; i < WRITERS_RANDOM_NUM; i++)
+        checkHex((unsigned int)getTestRandomLong());
+
+    // formatUnsignedLongLong
+    for (unsigned long long i = 0; i < 100000; i++)
+        checkUnsignedLongLong(i);
+    for (unsigned long long powerOfTen = 10; powerOfTen; powerOfTen *= 10)
+    {
+        checkUnsignedLongLong(powerOfTen - 1);
+        checkUnsignedLongLong(powerOfTen);
+        checkUnsignedLongLong(powerOfTen + 1);
+
+        if (powerOfTen > ULLONG_MAX / 10)
+            break;
+    }
+    checkUnsignedLongLong(ULLONG_MAX);
+    for (unsigned int i = 0; i < WRITERS_RANDOM_NUM; i++)
+    {
+        unsigned long long value = getTestRandomLong();
+        checkUnsignedLongLong(value >> (value & 63));
+    }
+
+    // formatTime: every second of 1000 hours, and the hour digits
+    for (unsigned int i = 0; i < 3600000; i++)
+        checkTime(i);
+    for (unsigned long long hours = 1000; hours * 3600 <= UINT_MAX; hours *= 10)
+        for (int j = -3601; j <= 3601; j++)
+            checkTime((unsigned int)(hours * 3600 + j));
+    checkTime(UINT_MAX);
+
+    int result = endTest();
+    printf("\n");
+
+    static const char *const benchNames[] = {
+        "formatDigits",
+        "formatMantissa",
+        "formatUnsignedLongLong",
+        "formatTime",
+    };
+
+    printf("%-24s %12s %12s\n", "host time (ns)", "writer", "sprintf");
+    for (int i = 0; i < 4; i++)
+        printf("%-24s %12.1f %12.1f\n",
+               benchNames[i], benchWriter(i, false), benchWriter(i, true));
+
+    return result;
+}
@@ -0,0 +1,311 @@
+/*
+ * FS2011 Pro
+ * Tile diff benchmark
+ *
+ * (C) 2022 Gissio
+ *
+ * License: MIT
+ */
+
+#include "../cubeide/Core/fs2011pro/display.h"
+#include "../cubeide/Core/fs2011pro/events.h"
+#include "../cubeide/Core/fs2011pro/game.h"
+#include "../cubeide/Core/fs2011pro/keyboard.h"
+#include "../cubeide/Core/fs2011pro/logger.h"
+#include "../cubeide/Core/fs2011pro/measurements.h"
+#include "../cubeide/Core/fs2011pro/menus.h"
+#include "../cubeide/Core/fs2011pro/power.h"
+#include "../cubeide/Core/fs2011pro/settings.h"
+#include "../cubeide/Core/fs2011pro/sim.h"
+#include "../cubeide/Core/fs2011pro/trace.h"
+#include "../cubeide/Core/fs2011pro/ui.h"
+
+#include "u8g2.h"
+
+#include "headless/SDL.h"
+#include "headless/headless.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Replays view sequences and reports the LCD traffic per frame: before,
+// with every frame sent in full (8 tile rows of 128 bytes and 3 commands),
+// and after, with only the changed tiles sent:
+//
+//   fs2011pro-tilebench
+//
+// Bus cycles are estimated at TILEBENCH_BYTE_CYCLES per byte, counted from
+// the instructions of the CPU loop in onDisplayByte() (Cortex-M0, no wait
+// states). The benchmark fails if a change of up to three pixels leaves a
+// tile hash unchanged, or if a tile stays stale for longer than the
+// rolling refresh allows.
+
+#define TILEBENCH_WARMUP_TIME 600
+#define TILEBENCH_UI_TICKS 10
+#define TILEBENCH_KEY_TICKS 100
+
+#define TILEBENCH_BYTE_CYCLES 22
+#define TILEBENCH_FULL_FRAME_BYTES (DISPLAY_PAGES * (3 + 128))
+
+// A stale tile must be resent within this many frames
+#define TILEBENCH_STALE_FRAMES_MAX (DISPLAY_PAGES * 8)
+
+typedef struct
+{
+    const char *name;
+    unsigned char view;
+    // cps
+    float rate;
+    float rate2;
+    // s
+    unsigned int time;
+    int keyScancode;
+    unsigned int keyPeriod;
+} TileBenchSequence;
+
+static const TileBenchSequence tileBenchSequences[] = {
+    {"instantaneous", VIEW_INSTANTANEOUS_RATE, 0.5F, 0.5F, 120, -1, 0},
+    {"instantaneous-ramp", VIEW_INSTANTANEOUS_RATE, 0.5F, 500, 120, -1, 0},
+    {"average", VIEW_AVERAGE_RATE, 5, 5, 120, -1, 0},
+    {"dose", VIEW_DOSE, 5, 5, 120, -1, 0},
+    {"history", VIEW_HISTORY, 5, 50, 120, SDL_SCANCODE_RIGHT, 30},
+    {"menu", VIEW_MENU, 0.5F, 0.5F, 60, SDL_SCANCODE_DOWN, 2},
+    {"stats", VIEW_STATS, 0.5F, 0.5F, 60, -1, 0},
+    {"game", VIEW_GAME, 0.5F, 0.5F, 60, -1, 0},
+};
+
+struct
+{
+    unsigned int frameNum;
+    unsigned int staleSince[DISPLAY_PAGES][16];
+    unsigned int staleFrameMax;
+} tileBench;
+
+extern u8g2_t u8g2;
+
+void onSDLTick()
+{
+}
+
+// The hash before the tile diff was fixed, for comparison
+unsigned short getRotateXorTileHash(const uint8_t *tile)
+{
+    unsigned short hash = 0;
+
+    for (int i = 0; i < 8; i++)
+        hash = ((hash << 5) | (hash >> 11)) ^ tile[i];
+
+    return hash;
+}
+
+// Index 64 flips no pixel
+void flipTilePixel(uint8_t *tile, unsigned int index)
+{
+    if (index < 64)
+        tile[index / 8] ^= 1 << (index % 8);
+}
+
+// Returns the number of changes of 1 to maxPixels pixels that leave the
+// hash unchanged
+unsigned int countTileHashCollisions(unsigned short (*getHash)(const uint8_t *),
+                                     const uint8_t *tile, int maxPixels)
+{
+    uint8_t changedTile[8];
+    unsigned short hash = getHash(tile);
+    unsigned int collisionNum = 0;
+
+    for (unsigned int i = 0; i < 64; i++)
+        for (unsigned int j = (maxPixels >= 2) ? i + 1 : 64; j <= 64; j++)
+            for (unsigned int k = ((maxPixels >= 3) && (j < 64)) ? j + 1 : 64; k <= 64; k++)
+            {
+                memcpy(changedTile, tile, 8);
+                flipTilePixel(changedTile, i);
+                flipTilePixel(changedTile, j);
+                flipTilePixel(changedTile, k);
+
+                if (getHash(changedTile) == hash)
+                    collisionNum++;
+            }
+
+    return collisionNum;
+}
+
+// Tracks the tiles on the LCD that differ from the buffer
+void checkStaleTiles()
+{
+#if DISPLAY_BUFFER_PAGES == DISPLAY_PAGES
+    const uint8_t *buffer = u8g2_GetBufferPtr(&u8g2);
+    const uint8_t *frame = getHeadlessFrame();
+
+    for (int y = 0; y < DISPLAY_PAGES; y++)
+        for (int x = 0; x < 16; x++)
+        {
+            unsigned int offset = y * 128 + x * 8;
+
+            if (!memcmp(buffer + offset, frame + offset, 8))
+                tileBench.staleSince[y][x] = 0;
+            else if (!tileBench.staleSince[y][x])
+                tileBench.staleSince[y][x] = tileBench.frameNum;
+            else
+            {
+                unsigned int staleFrames = tileBench.frameNum - tileBench.staleSince[y][x];
+                if (staleFrames > tileBench.staleFrameMax)
+                    tileBench.staleFrameMax = staleFrames;
+            }
+        }
+#endif
+}
+
+void runTileBenchTicks(const TileBenchSequence *sequence, unsigned int ticks)
+{
+    unsigned int keyTicks = sequence->keyPeriod * TICK_FREQUENCY;
+
+    for (unsigned int i = 1; i <= ticks; i++)
+    {
+        setSimRate(sequence->rate +
+                   (sequence->rate2 - sequence->rate) * i / ticks);
+
+        if ((sequence->keyScancode >= 0) && keyTicks)
+        {
+            if (!(i % keyTicks))
+                setHeadlessKey(sequence->keyScancode, true);
+            else if ((i % keyTicks) == TILEBENCH_KEY_TICKS)
+                setHeadlessKey(sequence->keyScancode, false);
+        }
+
+        onSimTick();
+        addHeadlessTicks(1);
+        onEventsTick();
+
+        if (!(i % TILEBENCH_UI_TICKS))
+        {
+            updateUI();
+
+            unsigned int frameNum = getTraceCount(TRACE_FRAME_START);
+            if (frameNum != tileBench.frameNum)
+            {
+                tileBench.frameNum = frameNum;
+
+                checkStaleTiles();
+            }
+        }
+    }
+}
+
+void openTileBenchView(unsigned char view)
+{
+    switch (view)
+    {
+    case VIEW_MENU:
+        openSettingsMenu();
+        break;
+
+    case VIEW_GAME:
+        resetGame(0);
+        setView(view);
+        break;
+
+    default:
+        setView(view);
+        break;
+    }
+}
+
+int main()
+{
+    initSim(SIM_SEED);
+
+    initKeyboard();
+    initPower();
+    initDisplay();
+
+    readSettings();
+
+    initEvents();
+    initMeasurements();
+    initLogger();
+    initMenus();
+
+    static const TileBenchSequence warmupSequence = {
+        "warmup", VIEW_INSTANTANEOUS_RATE, 5, 5, TILEBENCH_WARMUP_TIME, -1, 0};
+    runTileBenchTicks(&warmupSequence, TILEBENCH_WARMUP_TIME * TICK_FREQUENCY);
+
+    printf("%-20s %8s %14s %14s %14s %14s\n",
+           "sequence", "frames",
+           "before (B)", "after (B)",
+           "before (cyc)", "after (cyc)");
+
+    unsigned int totalFrameNum = 0;
+    unsigned long long totalByteNum = 0;
+
+    for (unsigned int i = 0; i < sizeof(tileBenchSequences) / sizeof(TileBenchSequence); i++)
+    {
+        const TileBenchSequence *sequence = &tileBenchSequences[i];
+        HeadlessDisplayStats stats;
+
+        openTileBenchView(sequence->view);
+
+        unsigned int firstFrameNum = getTraceCount(TRACE_FRAME_START);
+        resetHeadlessDisplayStats();
+
+        runTileBenchTicks(sequence, sequence->time * TICK_FREQUENCY);
+
+        getHeadlessDisplayStats(&stats);
+        unsigned int frameNum = getTraceCount(TRACE_FRAME_START) - firstFrameNum;
+        unsigned int byteNum = stats.byteNum + 3 * stats.drawNum;
+
+        double afterBytes = frameNum ? (double)byteNum / frameNum : 0;
+
+        printf("%-20s %8u %14u %14.1f %14u %14.0f\n",
+               sequence->name, frameNum,
+               TILEBENCH_FULL_FRAME_BYTES, afterBytes,
+               TILEBENCH_FULL_FRAME_BYTES * TILEBENCH_BYTE_CYCLES,
+               afterBytes * TILEBENCH_BYTE_CYCLES);
+
+        totalFrameNum += frameNum;
+        totalByteNum += byteNum;
+    }
+
+    double afterBytes = totalFrameNum ? (double)totalByteNum / totalFrameNum : 0;
+    printf("%-20s %8u %14u %14.1f %14u %14.0f\n",
+           "all", totalFrameNum,
+           TILEBENCH_FULL_FRAME_BYTES, afterBytes,
+           TILEBENCH_FULL_FRAME_BYTES * TILEBENCH_BYTE_CYCLES,
+           afterBytes * TILEBENCH_BYTE_CYCLES);
+
+    // Hash collisions over the tiles of the last frame
+    const uint8_t *frame = getHeadlessFrame();
+    unsigned int rotateXorCollisionNum = 0;
+    unsigned int collisionNum = 0;
+
+    for (int i = 0; i < DISPLAY_PAGES * 16; i++)
+    {
+        rotateXorCollisionNum += countTileHashCollisions(getRotateXorTileHash, frame + 8 * i, 2);
+        collisionNum += countTileHashCollisions(getDisplayTileHash, frame + 8 * i, 3);
+    }
+
+    printf("\nundetected changes of up to 2 pixels, rotate-xor hash: %u\n",
+           rotateXorCollisionNum);
+    printf("undetected changes of up to 3 pixels, tile hash:       %u\n",
+           collisionNum);
+    printf("longest stale tile:                                   %u frames\n",
+           tileBench.staleFrameMax);
+
+    int result = 0;
+
+    if (collisionNum)
+    {
+        fprintf(stderr, "tile hash misses changes of up to 3 pixels\n");
+
+        result = 1;
+    }
+
+    if (tileBench.staleFrameMax > TILEBENCH_STALE_FRAMES_MAX)
+    {
+        fprintf(stderr, "stale tiles outlast the rolling refresh\n");
+
+        result = 1;
+    }
+
+    return result;
+}
@@ -0,0 +1,115 @@
+# FS2011 Pro
+# Trace decoder
+#
+# (C) 2022 Gissio
+#
+# License: MIT
+#
+# Decodes a trace dump (test/remote.py, or fs2011pro-trace.bin from the SDL
+# build) into a timeline and per-stage durations.
+
+import struct
+import sys
+
+TRACE_MAGIC = 0x45435254
+TRACE_HEADER_SIZE = 12
+TRACE_RECORD_SIZE = 4
+
+trace_types = [
+    'NONE',
+    'TIME',
+    'PULSES',
+    'KEY',
+    'ALARM',
+    'FRAME_START',
+    'FRAME_END',
+    'FLASH_ERASE_START',
+    'FLASH_ERASE_END',
+    'FLASH_PROGRAM_START',
+    'FLASH_PROGRAM_END',
+    'GAME_SEARCH_START',
+    'GAME_SEARCH_END',
+]
+
+def read_records(data):
+    magic, size, index, time_high = struct.unpack_from('<IHHI', data, 0)
+    if magic != TRACE_MAGIC:
+        raise ValueError('Not a trace dump')
+
+    records = []
+    for i in range(size):
+        offset = TRACE_HEADER_SIZE + TRACE_RECORD_SIZE * i
+        records.append(struct.unpack_from('<HBB', data, offset))
+
+    # Oldest record first: the ring is full once the slot at the index is used
+    index %= size
+    if records[index][1] != trace_types.index('NONE'):
+        records = records[index:] + records[:index]
+    else:
+        records = records[:index]
+
+    return time_high, records
+
+def decode_records(time_high, records):
+    # From the newest record back: TIME records give the increment of the
+    # high time bits, the 32-bit time wraps every 71 minutes
+    events = []
+    for time_low, type, data in reversed(records):
+        if type == trace_types.index('TIME'):
+            # Saturated increment: older times are unknown
+            if data == 0xff:
+                break
+            time_high -= data
+            continue
+
+        if type >= len(trace_types):
+            continue
+
+        events.append(((time_high << 16) | time_low, trace_types[type], data))
+
+    events.reverse()
+
+    return events
+
+def print_timeline(events):
+    start_time = events[0][0] if events else 0
+    last_time = start_time
+    for time, name, data in events:
+        print('%12.3f ms %+10.3f ms  %-20s %d' %
+              ((time - start_time) / 1000, (time - last_time) / 1000, name, data))
+        last_time = time
+
+def print_durations(events):
+    start_times = {}
+    durations = {}
+    pulse_count = 0
+    for time, name, data in events:
+        if name == 'PULSES':
+            pulse_count += data
+        elif name.endswith('_START'):
+            start_times[name[:-6]] = time
+        elif name.endswith('_END'):
+            stage = name[:-4]
+            if stage in start_times:
+                durations.setdefault(stage, []).append(time - start_times.pop(stage))
+
+    print()
+    print('%-16s %6s %12s %12s %12s' % ('Stage', 'Count', 'Mean (us)', 'Min (us)', 'Max (us)'))
+    for stage, values in sorted(durations.items()):
+        print('%-16s %6d %12.1f %12d %12d' %
+              (stage, len(values), sum(values) / len(values), min(values), max(values)))
+
+    if len(events) > 1:
+        span = (events[-1][0] - events[0][0]) / 1000000
+        print()
+        print('Span: %.3f s, pulses: %d (saturated at 255 per tick)' % (span, pulse_count))
+
+if len(sys.argv) < 2:
+    print('Usage: decode_trace.py trace.bin')
+    sys.exit(1)
+
+with open(sys.argv[1], 'rb') as f:
+    events = decode_records(*read_records(f.read()))
+
+print_timeline(events)
+print_durations(events)
@@ -5,11 +5,25 @@
 #
 # License: MIT
 #
-# Uses pyswd to contro lthe firmware remotely. Modify memory addresses acordingly.
+# Uses pyswd to control the firmware remotely. Modify the generator and key
+# memory addresses accordingly. The trace ring (build with TRACE) is found
+# by symbol in the firmware image (first argument) with pyelftools.
 
 import keyboard
+import sys
 import time
 import swd
+from elftools.elf.elffile import ELFFile
+
+elf_path = sys.argv[1] if len(sys.argv) > 1 else '../cubeide/Debug/FS2011 Pro.elf'
+
+def get_symbol(name):
+    with open(elf_path, 'rb') as f:
+        symtab = ELFFile(f).get_section_by_name('.symtab')
+        symbols = symtab.get_symbol_by_name(name)
+        if not symbols:
+            return None
+        return (symbols[0]['st_value'], symbols[0]['st_size'])
 
 dev = swd.Swd()
 
@@ -34,6 +48,20 @@ def show_cnt():
     value = dev.read_mem8(0x4000102c, 4)
     print("ARR: " + ' '.join(['%02x' % d for d in value]))
 
+def dump_trace():
+    global dev
+
+    symbol = get_symbol('trace')
+    if symbol is None:
+        print("No trace in firmware image")
+        return
+
+    address, size = symbol
+    data = bytes(dev.read_mem8(address, size))
+    with open('trace.bin', 'wb') as f:
+        f.write(data)
+    print("Trace written to trace.bin")
+
 def on_key(event):
     state = (event.event_type == keyboard.KEY_DOWN)
     if event.name == "space":
@@ -52,6 +80,8 @@ def on_key(event):
         set_generator(1)
     elif event.name == "3":
         show_cnt()
+    elif event.name == "4" and state:
+        dump_trace()
     print(event.name + ": " + event.event_type)
 
 keyboard.hook(on_key)
@@ -0,0 +1,104 @@
+# FS2011 Pro
+# Confidence interval table generator
+#
+# (C) 2022 Gissio
+#
+# License: MIT
+#
+# The rate is measured as n / t, where t is the time of n pulses. t has a
+# gamma distribution, so the measured rate is within
+#
+#   true rate * [2n / chi2(1 - alpha / 2, 2n), 2n / chi2(alpha / 2, 2n)]
+#
+# The device shows the lower and upper intervals of the true rate relative
+# to the measured one, in percent. This script writes their exact values
+# for small n, where the Wilson-Hilferty approximation in confidence.c is
+# not accurate enough, and the normal quantiles for that approximation.
+#
+# Usage: mkconfidence.py size output.h
+
+import math
+import sys
+
+# Name, two-sided confidence level
+levels = [
+    ('68%', math.erf(1 / math.sqrt(2))),
+    ('90%', 0.90),
+    ('95%', 0.95),
+    ('99%', 0.99),
+]
+
+CONFIDENCE_SHIFT = 30
+
+def get_gamma_cdf(n, x):
+    # Regularized lower incomplete gamma function, series expansion
+    if x <= 0:
+        return 0.0
+
+    term = 1.0
+    total = 1.0
+    k = 1
+    while term > 1E-17 * total:
+        term *= x / (n + k)
+        total += term
+        k += 1
+
+    return math.exp(n * math.log(x) - x - math.lgamma(n + 1)) * total
+
+def get_gamma_quantile(n, p):
+    left = 0.0
+    right = n + 20 * math.sqrt(n) + 50
+    for i in range(200):
+        mid = (left + right) / 2
+        if get_gamma_cdf(n, mid) < p:
+            left = mid
+        else:
+            right = mid
+
+    return (left + right) / 2
+
+def get_normal_quantile(p):
+    left = -10.0
+    right = 10.0
+    for i in range(200):
+        mid = (left + right) / 2
+        if (1 + math.erf(mid / math.sqrt(2))) / 2 < p:
+            left = mid
+        else:
+            right = mid
+
+    return (left + right) / 2
+
+def get_intervals(n, level):
+    alpha = 1 - level
+    lower = 1 - n / get_gamma_quantile(n, 1 - alpha / 2)
+    upper = n / get_gamma_quantile(n, alpha / 2) - 1
+
+    return round(100 * lower), round(100 * upper)
+
+def main():
+    size, output = int(sys.argv[1]), sys.argv[2]
+
+    with open(output, 'w') as f:
+        f.write('/*\n')
+        f.write('  Generated by mkconfidence.py\n')
+        f.write('  Levels: %s, counts 1-%d\n' % (', '.join(name for name, level in levels), size))
+        f.write('*/\n\n')
+        f.write('#define CONFIDENCE_TABLE_SIZE %d\n\n' % size)
+        f.write('// Normal quantiles of the upper tail, Q%d\n' % CONFIDENCE_SHIFT)
+        f.write('const unsigned int confidenceZ[%d] = {\n' % len(levels))
+        for name, level in levels:
+            z = get_normal_quantile(1 - (1 - level) / 2)
+            f.write('    %d,\n' % round(z * (1 << CONFIDENCE_SHIFT)))
+        f.write('};\n\n')
+        f.write('// Lower and upper intervals (%) by level and count\n')
+        f.write('const unsigned short confidenceTable[%d][%d][2] = {\n' % (len(levels), size))
+        for name, level in levels:
+            f.write('    {\n')
+            entries = ['{%d, %d},' % get_intervals(n, level) for n in range(1, size + 1)]
+            for i in range(0, size, 6):
+                f.write('        %s\n' % ' '.join(entries[i:i + 6]))
+            f.write('    },\n')
+        f.write('};\n')
+
+main()